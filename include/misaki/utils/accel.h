@@ -0,0 +1,6 @@
+#pragma once
+
+#include "accel/bvh.h"
+#include "accel/lbvh.h"
+#include "accel/refit.h"
+#include "accel/wide_bvh.h"
\ No newline at end of file
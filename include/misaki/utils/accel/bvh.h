@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "../math/bbox3.hpp"
+#include "../util/aligned.h"
+
+namespace misaki::accel {
+
+// 32 bytes. Siblings are stored next to each other from an even index, so
+// both children of a node share one cache line.
+struct alignas(32) BVHNode {
+  math::BoundingBox3f bbox;
+  // Interior nodes: index of the left child, the right one follows it.
+  // Leaves: first entry of the leaf in BVH::primitives().
+  uint32_t offset = 0;
+  // Number of primitives of a leaf, zero for interior nodes
+  uint32_t count = 0;
+
+  bool is_leaf() const { return count != 0; }
+};
+
+struct BVHBuildSettings {
+  uint32_t max_leaf_size = 8;
+  // Bins per axis of the SAH sweep, at most 64
+  uint32_t bins = 16;
+  float traversal_cost = 1.f;
+  float intersection_cost = 1.f;
+  bool parallel = true;
+};
+
+// Binary BVH over primitive bounds, built top-down with binned SAH. Large
+// ranges are binned and partitioned in parallel, and subtrees below that
+// are built as independent tasks, each appending to its own node arena.
+// The arenas are then concatenated into one cache-line aligned array:
+// node 0 is the root, node 1 is unused padding.
+class BVH {
+ public:
+  using NodeArray = std::vector<BVHNode, util::AlignedAllocator<BVHNode, 64>>;
+
+  BVH() = default;
+
+  // Throws std::runtime_error when count is zero or above 2^31, or the
+  // settings are out of range
+  BVH(const math::BoundingBox3f *bounds,
+      const math::TVector3<float> *centroids, size_t count,
+      const BVHBuildSettings &settings = {});
+
+  // Adopt nodes and primitive indices from another builder, in the same
+  // layout
+  BVH(NodeArray nodes, std::vector<uint32_t> primitives)
+      : m_nodes(std::move(nodes)), m_primitives(std::move(primitives)) {}
+
+  const NodeArray &nodes() const { return m_nodes; }
+  const BVHNode &root() const { return m_nodes[0]; }
+  // Primitive indices referenced by the leaves
+  const std::vector<uint32_t> &primitives() const { return m_primitives; }
+
+  // Expected cost of a random ray hitting the root box
+  float sah_cost(float traversal_cost = 1.f,
+                 float intersection_cost = 1.f) const;
+
+ private:
+  friend class BVHRefitter;
+
+  NodeArray m_nodes;
+  std::vector<uint32_t> m_primitives;
+};
+
+}  // namespace misaki::accel
\ No newline at end of file
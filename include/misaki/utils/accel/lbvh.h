@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "../math/curve_keys.hpp"
+#include "bvh.h"
+
+namespace misaki::accel {
+
+struct LBVHBuildSettings {
+  math::SpaceFillingCurve curve = math::SpaceFillingCurve::Morton;
+  // 63-bit keys (2^21 cells per axis) instead of 30-bit ones (2^10)
+  bool long_keys = false;
+  uint32_t max_leaf_size = 4;
+  // HLBVH: primitives sharing the first `cluster_bits` key bits form a
+  // cluster, and the levels above the clusters are built with binned SAH.
+  // Zero gives a plain LBVH.
+  uint32_t cluster_bits = 15;
+  bool parallel = true;
+};
+
+// Linear BVH: primitives are sorted by the curve keys of their centroids
+// with a parallel radix sort, and every node splits its range where the
+// keys start to differ. Much faster to build than BVH's SAH builder, at
+// some cost in tree quality; the output has the same layout. Throws
+// std::runtime_error when count is zero or above 2^31, or the settings are
+// out of range.
+extern BVH build_lbvh(const math::BoundingBox3f *bounds,
+                      const math::TVector3<float> *centroids, size_t count,
+                      const LBVHBuildSettings &settings = {});
+
+}  // namespace misaki::accel
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "bvh.h"
+
+namespace misaki::accel {
+
+// Keeps a BVH usable for deforming geometry without rebuilding it. The
+// topology is kept and only the boxes are recomputed from new primitive
+// bounds; tree rotations then recover part of the SAH quality lost to the
+// motion. Holds a reference to the BVH, which must outlive it.
+class BVHRefitter {
+ public:
+  explicit BVHRefitter(BVH &bvh);
+
+  // Recompute every box bottom-up from `bounds`, indexed like the bounds
+  // the BVH was built from. Leaves are refit in parallel chunks, and each
+  // parent is completed by whichever of its children finishes last.
+  void refit(const math::BoundingBox3f *bounds, bool parallel = true);
+
+  // One bottom-up pass of tree rotations after Kopta et al., "Fast,
+  // Effective BVH Updates for Animated Scenes": each interior node swaps a
+  // child with a grandchild on the other side when that shrinks the other
+  // child's box. Boxes must be up to date, e.g. right after refit(). Returns
+  // the number of rotations.
+  size_t optimize();
+
+ private:
+  bool rotate(uint32_t index);
+
+  BVH &m_bvh;
+  // Parent of every node, ~0u for the root and the padding node
+  std::vector<uint32_t> m_parents;
+  // Children that finished refitting, per interior node
+  std::unique_ptr<std::atomic<uint32_t>[]> m_visits;
+};
+
+}  // namespace misaki::accel
\ No newline at end of file
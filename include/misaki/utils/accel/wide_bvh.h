@@ -0,0 +1,170 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include "../math/bbox3.hpp"
+#include "../util/aligned.h"
+#include "bvh.h"
+
+namespace misaki::accel {
+
+namespace detail {
+
+// Quantized coordinates of N children as float lanes
+template <size_t N>
+MSK_INLINE math::Array<float, N> unpack_u8(const uint8_t *q) {
+  math::Array<float, N> ret;
+#if defined(MSK_X86_AVX)
+  if constexpr (N == 8) {
+    int32_t lo, hi;
+    std::memcpy(&lo, q, 4);
+    std::memcpy(&hi, q + 4, 4);
+    __m128 a = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(lo))),
+           b = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(hi)));
+    _mm256_store_ps(ret.data(),
+                    _mm256_insertf128_ps(_mm256_castps128_ps256(a), b, 1));
+    return ret;
+  }
+#endif
+#if defined(MSK_X86_SSE42)
+  if constexpr (N == 4) {
+    int32_t v;
+    std::memcpy(&v, q, 4);
+    _mm_store_ps(ret.data(),
+                 _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(v))));
+    return ret;
+  }
+#endif
+  for (size_t i = 0; i < N; ++i) ret.coeff(i) = float(q[i]);
+  return ret;
+}
+
+}  // namespace detail
+
+// Wide node with full precision child boxes. A child slot is a leaf when
+// its count is non-zero, empty when both count and child are zero (node 0
+// is the root, never a child), and an interior node otherwise.
+template <size_t Width>
+struct alignas(64) TWideBVHNode {
+  math::TBoundingBox3xN<float, Width> bbox;
+  // Node index of interior children, first entry in primitives() of leaves
+  uint32_t child[Width];
+  // Primitive count of leaf children
+  uint8_t count[Width];
+
+  const math::TBoundingBox3xN<float, Width> &child_bounds() const {
+    return bbox;
+  }
+};
+
+// Wide node whose child boxes are stored as 8-bit offsets from `origin`, the
+// lower corner of the node's own box, in power of two steps per axis. The
+// quantized boxes always contain the original ones. After Ylitie et al.,
+// "Efficient Incoherent Ray Traversal on GPUs Through Compressed Wide BVHs".
+// One cache line for 4 children, two for 8.
+template <size_t Width>
+struct alignas(64) TCompressedWideBVHNode {
+  float origin[3];
+  int8_t exponent[3];
+  uint8_t count[Width];
+  uint8_t lo[3][Width], hi[3][Width];
+  uint32_t child[Width];
+
+  float scale(int axis) const {
+    uint32_t bits = uint32_t(exponent[axis] + 127) << 23;
+    float s;
+    std::memcpy(&s, &bits, sizeof(float));
+    return s;
+  }
+
+  math::TBoundingBox3xN<float, Width> child_bounds() const {
+    math::TBoundingBox3xN<float, Width> ret;
+    for (int k = 0; k < 3; ++k) {
+      const float s = scale(k);
+      ret.pmin[k] = detail::unpack_u8<Width>(lo[k]) * s + origin[k];
+      ret.pmax[k] = detail::unpack_u8<Width>(hi[k]) * s + origin[k];
+    }
+    return ret;
+  }
+};
+
+// 4- or 8-wide BVH made by collapsing a binary one: each node pulls in the
+// largest interior descendants until it has Width children. Child boxes are
+// kept at full precision or quantized to 8 bits.
+template <size_t Width, bool Compressed = true>
+class TWideBVH {
+ public:
+  using Node = std::conditional_t<Compressed, TCompressedWideBVHNode<Width>,
+                                  TWideBVHNode<Width>>;
+  using NodeArray = std::vector<Node, util::AlignedAllocator<Node, 64>>;
+
+  TWideBVH() = default;
+
+  // Throws std::runtime_error for leaves of more than 255 primitives
+  explicit TWideBVH(const BVH &bvh);
+
+  const NodeArray &nodes() const { return m_nodes; }
+  const std::vector<uint32_t> &primitives() const { return m_primitives; }
+
+  // Closest hit traversal of o + t * d, t in [tmin, tmax]. Calls
+  // leaf(first, count, tmax) for the leaves whose boxes the ray enters, near
+  // to far within each node; it tests primitives()[first, first + count)
+  // and shrinks tmax on hits.
+  template <typename LeafFunc>
+  void traverse(const math::TVector3<float> &o, const math::TVector3<float> &d,
+                float tmin, float &tmax, LeafFunc &&leaf) const {
+    struct Entry {
+      uint32_t index, count;
+      float t;
+    };
+    constexpr size_t LocalStack = 256;
+    Entry local[LocalStack];
+    std::vector<Entry> heap;
+    Entry *stack = local;
+    if (m_stack_size > LocalStack) {
+      heap.resize(m_stack_size);
+      stack = heap.data();
+    }
+
+    const math::TVector3<float> inv_dir(1.f / d.x, 1.f / d.y, 1.f / d.z);
+    size_t size = 0;
+    stack[size++] = {0, 0, tmin};
+    while (size > 0) {
+      const Entry e = stack[--size];
+      if (e.t > tmax)
+        continue;
+      if (e.count) {
+        leaf(e.index, e.count, tmax);
+        continue;
+      }
+      const Node &node = m_nodes[e.index];
+      auto [bits, tnear] =
+          node.child_bounds().ray_intersect(o, inv_dir, tmin, tmax);
+      // Sorted far to near, so that the nearest child is popped first
+      const size_t first = size;
+      for (size_t i = 0; i < Width; ++i) {
+        if (!((bits >> i) & 1) || (!node.count[i] && !node.child[i]))
+          continue;
+        Entry c{node.child[i], node.count[i], tnear.coeff(i)};
+        size_t j = size++;
+        for (; j > first && stack[j - 1].t < c.t; --j) stack[j] = stack[j - 1];
+        stack[j] = c;
+      }
+    }
+  }
+
+ private:
+  NodeArray m_nodes;
+  std::vector<uint32_t> m_primitives;
+  // Bound on the traversal stack
+  size_t m_stack_size = 1;
+};
+
+using WideBVH4 = TWideBVH<4>;
+using WideBVH8 = TWideBVH<8>;
+
+}  // namespace misaki::accel
\ No newline at end of file
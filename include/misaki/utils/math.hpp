@@ -1,11 +1,25 @@
 #pragma once
 
+#include "math/affine_transform3.hpp"
+#include "math/animated_transform.hpp"
 #include "math/bbox2.hpp"
 #include "math/bbox3.hpp"
 #include "math/color3.hpp"
 #include "math/color4.hpp"
+#include "math/curve_keys.hpp"
+#include "math/distribution.hpp"
+#include "math/fastmath.hpp"
 #include "math/frame.hpp"
+#include "math/half.hpp"
+#include "math/halton.hpp"
+#include "math/lazy_transform4.hpp"
+#include "math/matrix.hpp"
+#include "math/octahedral.hpp"
+#include "math/quaternion.hpp"
+#include "math/sample_tables.hpp"
 #include "math/random.hpp"
+#include "math/sobol.hpp"
+#include "math/srgb.hpp"
 #include "math/transform3.hpp"
 #include "math/transform4.hpp"
 #include "math/vec2.hpp"
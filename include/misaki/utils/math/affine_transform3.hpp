@@ -0,0 +1,146 @@
+#pragma once
+
+#include "matrix3.hpp"
+#include "transform4.hpp"
+
+namespace misaki::math {
+
+// Affine transform stored as a 3x3 linear part plus translation, for both
+// the forward and the inverse mapping. Smaller than TTransform4 and never
+// performs a homogeneous divide.
+template <typename Value>
+class TAffineTransform3 {
+  using Matrix3 = TMatrix3<Value>;
+  using Matrix4 = TMatrix4<Value>;
+  using Vector3 = TVector3<Value>;
+  using Self = TAffineTransform3<Value>;
+  Matrix3 m_linear = Matrix3::identity();
+  Vector3 m_translation = Vector3(0);
+  Matrix3 m_inverse_linear = Matrix3::identity();
+  Vector3 m_inverse_translation = Vector3(0);
+
+ public:
+  MSK_XPU TAffineTransform3() = default;
+  MSK_XPU explicit TAffineTransform3(const Matrix3 &linear,
+                                     const Vector3 &translation = Vector3(0))
+      : m_linear(linear),
+        m_translation(translation),
+        m_inverse_linear(linear.inverse()),
+        m_inverse_translation(-(m_inverse_linear * translation)) {}
+  MSK_XPU TAffineTransform3(const Matrix3 &linear, const Vector3 &translation,
+                            const Matrix3 &inv_linear,
+                            const Vector3 &inv_translation)
+      : m_linear(linear),
+        m_translation(translation),
+        m_inverse_linear(inv_linear),
+        m_inverse_translation(inv_translation) {}
+  // Takes the upper 3x4 block of both matrices, the bottom row is assumed
+  // to be (0, 0, 0, 1)
+  MSK_XPU explicit TAffineTransform3(const TTransform4<Value> &t)
+      : m_linear(upper_linear(t.matrix())),
+        m_translation(upper_translation(t.matrix())),
+        m_inverse_linear(upper_linear(t.inverse_matrix())),
+        m_inverse_translation(upper_translation(t.inverse_matrix())) {}
+
+  // Component access
+  MSK_XPU const Matrix3 &linear() const { return m_linear; }
+  MSK_XPU const Vector3 &translation() const { return m_translation; }
+  MSK_XPU const Matrix3 &inverse_linear() const { return m_inverse_linear; }
+  MSK_XPU const Vector3 &inverse_translation() const {
+    return m_inverse_translation;
+  }
+
+  MSK_XPU Matrix4 matrix() const { return to_matrix4(m_linear, m_translation); }
+  MSK_XPU Matrix4 inverse_matrix() const {
+    return to_matrix4(m_inverse_linear, m_inverse_translation);
+  }
+  MSK_XPU TTransform4<Value> to_transform4() const {
+    return TTransform4<Value>(matrix(), inverse_matrix());
+  }
+
+  MSK_XPU Self inverse() const {
+    return Self(m_inverse_linear, m_inverse_translation, m_linear,
+                m_translation);
+  }
+
+  MSK_XPU Vector3 apply_point(const Vector3 &point) const noexcept {
+    return m_linear * point + m_translation;
+  }
+
+  MSK_XPU Vector3 apply_vector(const Vector3 &vec) const noexcept {
+    return m_linear * vec;
+  }
+
+  MSK_XPU Vector3 apply_normal(const Vector3 &normal) const noexcept {
+    const Matrix3 &m = m_inverse_linear;
+    return Vector3(m(0, 0) * normal.x + m(1, 0) * normal.y + m(2, 0) * normal.z,
+                   m(0, 1) * normal.x + m(1, 1) * normal.y + m(2, 1) * normal.z,
+                   m(0, 2) * normal.x + m(1, 2) * normal.y + m(2, 2) * normal.z)
+        .normalize();
+  }
+
+  MSK_XPU static Self translate(const Vector3 &delta) noexcept {
+    return Self(Matrix3::identity(), delta, Matrix3::identity(), -delta);
+  }
+
+  MSK_XPU static Self scale(const Vector3 &v) noexcept {
+    return Self(Matrix3::diag(v), Vector3(0), Matrix3::diag(Value(1) / v),
+                Vector3(0));
+  }
+
+  MSK_XPU static Self rotate(const Vector3 &axis, Value angle) noexcept {
+    return Self(TTransform4<Value>::rotate(axis, angle));
+  }
+
+  std::string to_string() const {
+    std::ostringstream os;
+    os << *this;
+    return os.str();
+  }
+
+ private:
+  MSK_XPU static Matrix3 upper_linear(const Matrix4 &m) {
+    return Matrix3(m(0, 0), m(0, 1), m(0, 2), m(1, 0), m(1, 1), m(1, 2),
+                   m(2, 0), m(2, 1), m(2, 2));
+  }
+
+  MSK_XPU static Vector3 upper_translation(const Matrix4 &m) {
+    return Vector3(m(0, 3), m(1, 3), m(2, 3));
+  }
+
+  MSK_XPU static Matrix4 to_matrix4(const Matrix3 &l, const Vector3 &t) {
+    return Matrix4(l(0, 0), l(0, 1), l(0, 2), t.x, l(1, 0), l(1, 1), l(1, 2),
+                   t.y, l(2, 0), l(2, 1), l(2, 2), t.z, 0, 0, 0, 1);
+  }
+};
+
+template <typename Value>
+std::ostream &operator<<(std::ostream &oss,
+                         const TAffineTransform3<Value> &t) {
+  oss << "AffineTransform[" << std::endl;
+  oss << "  matrix = " << string::indent(t.matrix().to_string(), 11) << ","
+      << std::endl;
+  oss << "  inverse_matrix = "
+      << string::indent(t.inverse_matrix().to_string(), 19) << "," << std::endl;
+  oss << "]";
+  return oss;
+}
+
+// Composition only needs 3x3 products, (A B)^-1 = B^-1 A^-1
+template <typename Value>
+MSK_XPU TAffineTransform3<Value> operator*(
+    const TAffineTransform3<Value> &lhs,
+    const TAffineTransform3<Value> &rhs) noexcept {
+  return TAffineTransform3<Value>(
+      lhs.linear() * rhs.linear(),
+      lhs.linear() * rhs.translation() + lhs.translation(),
+      rhs.inverse_linear() * lhs.inverse_linear(),
+      rhs.inverse_linear() * lhs.inverse_translation() +
+          rhs.inverse_translation());
+}
+
+// Type alias
+using AffineTransform3f = TAffineTransform3<float>;
+using AffineTransform3d = TAffineTransform3<double>;
+
+}  // namespace misaki::math
\ No newline at end of file
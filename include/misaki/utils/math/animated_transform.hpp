@@ -0,0 +1,207 @@
+#pragma once
+
+#include <stdexcept>
+#include <vector>
+
+#include "bbox3.hpp"
+#include "quaternion.hpp"
+#include "transform4.hpp"
+
+namespace misaki::math {
+
+// Transform interpolated between keyframes. Each keyframe is decomposed once
+// into translation, rotation and scale (M = T R S), so evaluation is a lerp,
+// a slerp and a few products. Times outside the keyframe range clamp to the
+// first or last keyframe.
+template <typename Value>
+class TAnimatedTransform {
+  using Matrix3 = TMatrix3<Value>;
+  using Matrix4 = TMatrix4<Value>;
+  using Vector3 = TVector3<Value>;
+  using Quaternion = TQuaternion<Value>;
+  using Transform4 = TTransform4<Value>;
+  using BoundingBox3 = TBoundingBox3<Value>;
+
+ public:
+  struct Keyframe {
+    Value time;
+    Vector3 translation;
+    Quaternion rotation;
+    Matrix3 scale;
+  };
+
+  TAnimatedTransform() = default;
+  explicit TAnimatedTransform(const Transform4 &t) { append(0, t); }
+  TAnimatedTransform(Value time0, const Transform4 &t0, Value time1,
+                     const Transform4 &t1) {
+    append(time0, t0);
+    append(time1, t1);
+  }
+
+  // Add a keyframe, times must be strictly increasing
+  void append(Value time, const Matrix4 &m) {
+    if (!m_keyframes.empty() && !(time > m_keyframes.back().time))
+      throw std::runtime_error(
+          "AnimatedTransform keyframes must have increasing times");
+    Keyframe key;
+    key.time = time;
+    decompose(m, &key.translation, &key.rotation, &key.scale);
+    // Keep consecutive rotations on the same hemisphere so interpolation
+    // takes the shorter arc
+    if (!m_keyframes.empty() &&
+        dot(m_keyframes.back().rotation, key.rotation) < 0)
+      key.rotation = Quaternion(-key.rotation.x, -key.rotation.y,
+                                -key.rotation.z, -key.rotation.w);
+    m_keyframes.push_back(key);
+  }
+  void append(Value time, const Transform4 &t) { append(time, t.matrix()); }
+
+  size_t size() const { return m_keyframes.size(); }
+  const Keyframe &keyframe(size_t i) const { return m_keyframes[i]; }
+  bool is_animated() const { return m_keyframes.size() > 1; }
+
+  Transform4 eval(Value time) const {
+    size_t hint = 0;
+    return eval(time, hint);
+  }
+
+  // Evaluate at many times. `hint` carries the last keyframe segment across
+  // calls, so sorted times avoid the binary search almost always.
+  void eval(const Value *times, Transform4 *out, size_t count) const {
+    size_t hint = 0;
+    for (size_t i = 0; i < count; ++i) out[i] = eval(times[i], hint);
+  }
+
+  // Conservative bound of `box` transformed over the whole time range
+  BoundingBox3 motion_bounds(const BoundingBox3 &box) const {
+    BoundingBox3 ret;
+    if (m_keyframes.empty())
+      return ret;
+    for (size_t c = 0; c < 8; ++c) {
+      Vector3 p((c & 1) ? box.pmax.x : box.pmin.x,
+                (c & 2) ? box.pmax.y : box.pmin.y,
+                (c & 4) ? box.pmax.z : box.pmin.z);
+      ret.expand(key_point(m_keyframes[0], p));
+      for (size_t k = 0; k + 1 < m_keyframes.size(); ++k)
+        ret.expand(segment_bounds(m_keyframes[k], m_keyframes[k + 1], p));
+    }
+    return ret;
+  }
+
+  // Split m into translation, rotation and scale/shear with a polar
+  // decomposition of its linear part
+  static void decompose(const Matrix4 &m, Vector3 *t, Quaternion *r,
+                        Matrix3 *s) {
+    *t = Vector3(m(0, 3), m(1, 3), m(2, 3));
+    Matrix3 a(m(0, 0), m(0, 1), m(0, 2), m(1, 0), m(1, 1), m(1, 2), m(2, 0),
+              m(2, 1), m(2, 2));
+    // R_{i+1} = (R_i + R_i^-T) / 2 converges to the rotation factor
+    Matrix3 rot = a;
+    for (int i = 0; i < 100; ++i) {
+      Matrix3 next = (rot + rot.transpose().inverse()) * Value(.5f);
+      Value diff = 0;
+      for (size_t j = 0; j < 3; ++j)
+        for (size_t k = 0; k < 3; ++k)
+          diff = std::max(diff, std::abs(next(j, k) - rot(j, k)));
+      rot = next;
+      if (diff < Value(1e-6f))
+        break;
+    }
+    // Fold reflections into the scale so the rotation stays proper
+    if (rot.determinant() < 0)
+      rot = rot * Value(-1);
+    *r = Quaternion::from_matrix(rot).normalize();
+    *s = rot.transpose() * a;
+  }
+
+ private:
+  Transform4 eval(Value time, size_t &hint) const {
+    if (m_keyframes.empty())
+      return Transform4();
+    if (m_keyframes.size() == 1 || time <= m_keyframes.front().time)
+      return compose(m_keyframes.front().translation,
+                     m_keyframes.front().rotation, m_keyframes.front().scale);
+    if (time >= m_keyframes.back().time)
+      return compose(m_keyframes.back().translation,
+                     m_keyframes.back().rotation, m_keyframes.back().scale);
+
+    if (hint + 1 >= m_keyframes.size() || time < m_keyframes[hint].time ||
+        time > m_keyframes[hint + 1].time) {
+      auto it = std::upper_bound(
+          m_keyframes.begin(), m_keyframes.end(), time,
+          [](Value t, const Keyframe &k) { return t < k.time; });
+      hint = size_t(it - m_keyframes.begin()) - 1;
+    }
+    const Keyframe &k0 = m_keyframes[hint], &k1 = m_keyframes[hint + 1];
+    Value u = (time - k0.time) / (k1.time - k0.time);
+    return compose(k0.translation * (1 - u) + k1.translation * u,
+                   slerp(k0.rotation, k1.rotation, u),
+                   k0.scale * (1 - u) + k1.scale * u);
+  }
+
+  // Builds T R S and its inverse S^-1 R^T T^-1 without a 4x4 inverse
+  static Transform4 compose(const Vector3 &t, const Quaternion &r,
+                            const Matrix3 &s) {
+    Matrix3 rot = r.to_matrix(), l = rot * s,
+            inv_l = s.inverse() * rot.transpose();
+    Vector3 inv_t = -(inv_l * t);
+    return Transform4(
+        Matrix4(l(0, 0), l(0, 1), l(0, 2), t.x, l(1, 0), l(1, 1), l(1, 2), t.y,
+                l(2, 0), l(2, 1), l(2, 2), t.z, 0, 0, 0, 1),
+        Matrix4(inv_l(0, 0), inv_l(0, 1), inv_l(0, 2), inv_t.x, inv_l(1, 0),
+                inv_l(1, 1), inv_l(1, 2), inv_t.y, inv_l(2, 0), inv_l(2, 1),
+                inv_l(2, 2), inv_t.z, 0, 0, 0, 1));
+  }
+
+  static Vector3 key_point(const Keyframe &k, const Vector3 &p) {
+    return k.rotation.rotate(k.scale * p) + k.translation;
+  }
+
+  // The point follows T(u) + R(u) S(u) p, whose path length over a step
+  // du is at most (|dT| + theta * max|S p| + |dS p|) du. Every point of a
+  // path of length L between a and b lies in the ellipsoid with foci a and
+  // b, which fits in their box grown by sqrt(L^2 - |b - a|^2) / 2. The
+  // segment is split into a few steps to keep the ellipsoids thin.
+  static BoundingBox3 segment_bounds(const Keyframe &k0, const Keyframe &k1,
+                                     const Vector3 &p) {
+    constexpr size_t Steps = 8;
+    Value cos_half =
+        std::min(std::abs(dot(k0.rotation, k1.rotation)), Value(1));
+    Value theta = 2 * std::acos(cos_half);
+    Value dt = (k1.translation - k0.translation).norm(),
+          ds = (k1.scale * p - k0.scale * p).norm();
+
+    BoundingBox3 ret;
+    Vector3 a = key_point(k0, p), sa = k0.scale * p;
+    for (size_t i = 1; i <= Steps; ++i) {
+      Value u = Value(i) / Steps;
+      Vector3 sb = k0.scale * p * (1 - u) + k1.scale * p * u;
+      Vector3 b = (i == Steps) ? key_point(k1, p)
+                               : slerp(k0.rotation, k1.rotation, u).rotate(sb) +
+                                     k0.translation * (1 - u) +
+                                     k1.translation * u;
+      Value length =
+          (dt + theta * std::max(sa.norm(), sb.norm()) + ds) / Steps;
+      // Rounding slack so the bound stays conservative
+      length = length * Value(1.001f) + Value(1e-5f) * (a.norm() + b.norm());
+      Value radius = Value(.5f) * std::sqrt(std::max(
+                                      length * length - (b - a).squared_norm(),
+                                      Value(0)));
+      ret.expand(a - radius);
+      ret.expand(a + radius);
+      ret.expand(b - radius);
+      ret.expand(b + radius);
+      a = b;
+      sa = sb;
+    }
+    return ret;
+  }
+
+  std::vector<Keyframe> m_keyframes;
+};
+
+// Type alias
+using AnimatedTransformf = TAnimatedTransform<float>;
+using AnimatedTransformd = TAnimatedTransform<double>;
+
+}  // namespace misaki::math
\ No newline at end of file
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <algorithm>
 #include <cmath>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <sstream>
 #include <type_traits>
 
@@ -9,6 +12,34 @@
 
 namespace misaki::math {
 
+namespace detail {
+// Native register backing of an array, specialized by the SSE/AVX headers
+template <typename Value, size_t Size>
+struct Packet {
+  static constexpr bool Enabled = false;
+  static constexpr size_t Alignment = alignof(Value);
+};
+}  // namespace detail
+
+}  // namespace misaki::math
+
+#if defined(MSK_X86_AVX)
+#include "array_avx.hpp"
+#elif defined(MSK_X86_SSE42)
+#include "array_sse.hpp"
+#endif
+
+namespace misaki::math {
+
+namespace detail {
+// Lane count of the widest register available for a value type, 1 if none
+template <typename Value>
+constexpr size_t native_width_v =
+    Packet<Value, 32 / sizeof(Value)>::Enabled   ? 32 / sizeof(Value)
+    : Packet<Value, 16 / sizeof(Value)>::Enabled ? 16 / sizeof(Value)
+                                                 : 1;
+}  // namespace detail
+
 // Predifinitoin math
 MSK_XPU inline float select(bool c, float a, float b) { return c ? a : b; }
 MSK_XPU inline int select(bool c, int a, int b) { return c ? a : b; }
@@ -19,12 +50,47 @@ MSK_XPU inline bool any(double a) { return a; }
 MSK_XPU inline bool all(bool a) { return a; }
 MSK_XPU inline bool all(float a) { return a; }
 MSK_XPU inline bool all(double a) { return a; }
+MSK_XPU inline bool none(bool a) { return !a; }
+MSK_XPU inline size_t count(bool a) { return a ? 1 : 0; }
 MSK_XPU inline auto min(float a, float b) { return std::min(a, b); }
 MSK_XPU inline auto min(double a, double b) { return std::min(a, b); }
 MSK_XPU inline auto min(int a, int b) { return std::min(a, b); }
 MSK_XPU inline auto max(float a, float b) { return std::max(a, b); }
 MSK_XPU inline auto max(double a, double b) { return std::max(a, b); }
 MSK_XPU inline auto max(int a, int b) { return std::max(a, b); }
+MSK_XPU inline auto min(uint32_t a, uint32_t b) { return std::min(a, b); }
+MSK_XPU inline auto max(uint32_t a, uint32_t b) { return std::max(a, b); }
+MSK_XPU inline float abs(float a) { return std::abs(a); }
+MSK_XPU inline double abs(double a) { return std::abs(a); }
+MSK_XPU inline int abs(int a) { return std::abs(a); }
+MSK_XPU inline float sqrt(float a) { return std::sqrt(a); }
+MSK_XPU inline double sqrt(double a) { return std::sqrt(a); }
+MSK_XPU inline float floor(float a) { return std::floor(a); }
+MSK_XPU inline double floor(double a) { return std::floor(a); }
+MSK_XPU inline float ceil(float a) { return std::ceil(a); }
+MSK_XPU inline double ceil(double a) { return std::ceil(a); }
+MSK_XPU inline float copysign(float a, float b) { return std::copysign(a, b); }
+MSK_XPU inline double copysign(double a, double b) { return std::copysign(a, b); }
+
+template <typename Value_, size_t Size_>
+class Mask;
+
+// Innermost scalar type of a (possibly nested) array
+template <typename T, typename = int>
+struct scalar {
+  using type = T;
+};
+
+template <typename T>
+struct scalar<T, decltype((void)T::Size, 0)> {
+  using type = typename scalar<typename T::Value>::type;
+};
+
+template <typename T>
+using scalar_t = typename scalar<T>::type;
+
+template <typename T>
+constexpr bool is_array_v = !std::is_same_v<scalar_t<T>, T>;
 
 template <typename Value_, size_t Size_, typename Derived_>
 class StaticArrayBase {
@@ -34,7 +100,8 @@ class StaticArrayBase {
 
   static constexpr size_t Size = Size_;
 
-  using MaskType = StaticArrayBase<bool, Size_, Derived_>;
+  using Packet = detail::Packet<Value_, Size_>;
+  using MaskType = Mask<Value_, Size_>;
 
   MSK_XPU Derived &derived() { return (Derived &)*this; }
   MSK_XPU const Derived &derived() const { return (Derived &)*this; }
@@ -77,32 +144,42 @@ class StaticArrayBase {
       (Value &)derived().coeff(i) = (const Value &)a.derived().coeff(i);
   }
 
-#define GEN_ARITH_OP(op, assign_op)                         \
-  MSK_XPU Derived operator op(const Derived &rhs) const {   \
-    Derived ret;                                            \
-    for (int i = 0; i < Size; ++i) {                        \
-      ret.coeff(i) = coeff(i) op rhs.coeff(i);              \
-    }                                                       \
-    return ret;                                             \
-  }                                                         \
-  MSK_XPU Derived operator op(const Value &rhs) const {     \
-    Derived ret;                                            \
-    for (int i = 0; i < Size; ++i) {                        \
-      ret.coeff(i) = coeff(i) op rhs;                       \
-    }                                                       \
-    return ret;                                             \
-  }                                                         \
-  MSK_XPU Derived &operator assign_op(const Derived &rhs) { \
-    *this = *this op rhs;                                   \
-  }                                                         \
-  MSK_XPU Derived &operator assign_op(const Value &rhs) {   \
-    *this = *this op rhs;                                   \
-  }
-
-  GEN_ARITH_OP(+, +=)
-  GEN_ARITH_OP(-, -=)
-  GEN_ARITH_OP(*, *=)
-  GEN_ARITH_OP(/, /=)
+#define GEN_ARITH_OP(op, assign_op, packet_op)                              \
+  MSK_XPU Derived operator op(const Derived &rhs) const {                   \
+    Derived ret;                                                            \
+    if constexpr (Packet::Enabled) {                                        \
+      Packet::store(ret.data(),                                             \
+                    Packet::packet_op(Packet::load(data()),                 \
+                                      Packet::load(rhs.data())));           \
+    } else {                                                                \
+      for (size_t i = 0; i < Size; ++i)                                     \
+        ret.coeff(i) = coeff(i) op rhs.coeff(i);                            \
+    }                                                                       \
+    return ret;                                                             \
+  }                                                                         \
+  MSK_XPU Derived operator op(const Value &rhs) const {                     \
+    Derived ret;                                                            \
+    if constexpr (Packet::Enabled) {                                        \
+      Packet::store(ret.data(), Packet::packet_op(Packet::load(data()),     \
+                                                  Packet::set1(rhs)));      \
+    } else {                                                                \
+      for (size_t i = 0; i < Size; ++i) ret.coeff(i) = coeff(i) op rhs;     \
+    }                                                                       \
+    return ret;                                                             \
+  }                                                                         \
+  MSK_XPU Derived &operator assign_op(const Derived &rhs) {                 \
+    *this = *this op rhs;                                                   \
+    return derived();                                                       \
+  }                                                                         \
+  MSK_XPU Derived &operator assign_op(const Value &rhs) {                   \
+    *this = *this op rhs;                                                   \
+    return derived();                                                       \
+  }
+
+  GEN_ARITH_OP(+, +=, add)
+  GEN_ARITH_OP(-, -=, sub)
+  GEN_ARITH_OP(*, *=, mul)
+  GEN_ARITH_OP(/, /=, div)
 #undef GEN_ARITH_OP
 
   MSK_XPU friend Derived operator+(const Value &v, const Derived &rhs) {
@@ -118,28 +195,41 @@ class StaticArrayBase {
     return Derived(v) / rhs;
   }
 
-#define GEN_CMP_OP(op)                                                      \
+#define GEN_CMP_OP(op, packet_op)                                           \
   MSK_XPU MaskType operator op(const Derived &rhs) const {                  \
     MaskType ret;                                                           \
-    for (int i = 0; i < Size; ++i) ret.coeff(i) = coeff(i) op rhs.coeff(i); \
+    if constexpr (Packet::Enabled) {                                        \
+      Packet::store(ret.data(),                                             \
+                    Packet::packet_op(Packet::load(data()),                 \
+                                      Packet::load(rhs.data())));           \
+    } else {                                                                \
+      for (size_t i = 0; i < Size; ++i)                                     \
+        ret.set(i, coeff(i) op rhs.coeff(i));                               \
+    }                                                                       \
     return ret;                                                             \
   }
-  GEN_CMP_OP(==)
-  GEN_CMP_OP(!=)
-  GEN_CMP_OP(<=)
-  GEN_CMP_OP(>=)
-  GEN_CMP_OP(<)
-  GEN_CMP_OP(>)
+  GEN_CMP_OP(==, eq)
+  GEN_CMP_OP(!=, neq)
+  GEN_CMP_OP(<=, le)
+  GEN_CMP_OP(>=, ge)
+  GEN_CMP_OP(<, lt)
+  GEN_CMP_OP(>, gt)
 #undef GEN_CMP_OP
 
   MSK_XPU Derived operator-() const {
     Derived self;
-    for (int i = 0; i < Size; i++) {
-      self.coeff(i) = -coeff(i);
+    if constexpr (Packet::Enabled) {
+      Packet::store(self.data(), Packet::neg(Packet::load(data())));
+    } else {
+      for (size_t i = 0; i < Size; i++) self.coeff(i) = -coeff(i);
     }
     return self;
   }
 
+  // Raw storage, aligned to the native register when one backs the array
+  MSK_XPU Value *data() { return m_data; }
+  MSK_XPU const Value *data() const { return m_data; }
+
   // Component acess
   MSK_XPU Value &coeff(size_t i) { return m_data[i]; }
   MSK_XPU const Value &coeff(size_t i) const { return m_data[i]; }
@@ -197,47 +287,249 @@ class StaticArrayBase {
   }
 
  private:
-  Value m_data[Size] = {0};
+  alignas(Packet::Alignment) Value m_data[Size] = {0};
+};
+
+// Comparison result of an array. When the array is backed by a register the
+// mask shares its layout (all-ones/all-zeros lanes), otherwise one bool per
+// entry is stored.
+template <typename Value_, size_t Size_>
+class Mask {
+ public:
+  using Value = Value_;
+  using Packet = detail::Packet<Value_, Size_>;
+  using Lane = std::conditional_t<Packet::Enabled, Value_, bool>;
+
+  static constexpr size_t Size = Size_;
+
+  Mask() = default;
+  MSK_XPU Mask(bool v) {
+    for (size_t i = 0; i < Size; ++i) set(i, v);
+  }
+
+  MSK_XPU bool coeff(size_t i) const {
+    if constexpr (Packet::Enabled)
+      return (Packet::movemask(Packet::load(m_data)) >> i) & 1;
+    else
+      return m_data[i];
+  }
+
+  MSK_XPU void set(size_t i, bool v) {
+    if constexpr (Packet::Enabled) {
+      using Bits = std::conditional_t<sizeof(Value) == 8, uint64_t, uint32_t>;
+      Bits bits = v ? ~Bits(0) : Bits(0);
+      std::memcpy(&m_data[i], &bits, sizeof(Value));
+    } else {
+      m_data[i] = v;
+    }
+  }
+
+  MSK_XPU bool operator[](size_t i) const { return coeff(i); }
+
+  // Lane bits packed into an integer, bit i is set when entry i is
+  MSK_XPU uint32_t bits() const {
+    static_assert(Size <= 32, "Mask::bits(): requires Size <= 32");
+    if constexpr (Packet::Enabled) {
+      return (uint32_t)Packet::movemask(Packet::load(m_data));
+    } else {
+      uint32_t r = 0;
+      for (size_t i = 0; i < Size; ++i) r |= uint32_t(m_data[i]) << i;
+      return r;
+    }
+  }
+
+#define GEN_MASK_OP(op, assign_op, packet_op)                               \
+  MSK_XPU Mask operator op(const Mask &rhs) const {                         \
+    Mask ret;                                                               \
+    if constexpr (Packet::Enabled) {                                        \
+      Packet::store(ret.m_data,                                             \
+                    Packet::packet_op(Packet::load(m_data),                 \
+                                      Packet::load(rhs.m_data)));           \
+    } else {                                                                \
+      for (size_t i = 0; i < Size; ++i)                                     \
+        ret.m_data[i] = m_data[i] op rhs.m_data[i];                         \
+    }                                                                       \
+    return ret;                                                             \
+  }                                                                         \
+  MSK_XPU Mask &operator assign_op(const Mask &rhs) {                       \
+    return *this = *this op rhs;                                            \
+  }
+
+  GEN_MASK_OP(&, &=, and_)
+  GEN_MASK_OP(|, |=, or_)
+  GEN_MASK_OP(^, ^=, xor_)
+#undef GEN_MASK_OP
+
+  MSK_XPU Mask operator~() const {
+    Mask ret;
+    if constexpr (Packet::Enabled) {
+      Packet::store(ret.m_data,
+                    Packet::xor_(Packet::load(m_data), Packet::ones()));
+    } else {
+      for (size_t i = 0; i < Size; ++i) ret.m_data[i] = !m_data[i];
+    }
+    return ret;
+  }
+
+  MSK_XPU Mask operator!() const { return ~*this; }
+  MSK_XPU Mask operator&&(const Mask &rhs) const { return *this & rhs; }
+  MSK_XPU Mask operator||(const Mask &rhs) const { return *this | rhs; }
+
+  MSK_XPU Lane *data() { return m_data; }
+  MSK_XPU const Lane *data() const { return m_data; }
+
+ private:
+  alignas(Packet::Alignment) Lane m_data[Size] = {};
 };
 
+// Reductions go through bits() for packets and loop over the lanes
+// otherwise, so that masks of any size work
+template <typename Value, size_t Size>
+MSK_XPU size_t count(const Mask<Value, Size> &m) {
+  size_t n = 0;
+  if constexpr (Mask<Value, Size>::Packet::Enabled) {
+    for (uint32_t bits = m.bits(); bits; bits &= bits - 1) ++n;
+  } else {
+    for (size_t i = 0; i < Size; ++i) n += m.data()[i];
+  }
+  return n;
+}
+
+template <typename Value, size_t Size>
+MSK_XPU bool any(const Mask<Value, Size> &m) {
+  if constexpr (Mask<Value, Size>::Packet::Enabled) {
+    return m.bits() != 0;
+  } else {
+    for (size_t i = 0; i < Size; ++i)
+      if (m.data()[i])
+        return true;
+    return false;
+  }
+}
+
+template <typename Value, size_t Size>
+MSK_XPU bool all(const Mask<Value, Size> &m) {
+  if constexpr (Mask<Value, Size>::Packet::Enabled) {
+    return m.bits() == ~uint32_t(0) >> (32 - Size);
+  } else {
+    for (size_t i = 0; i < Size; ++i)
+      if (!m.data()[i])
+        return false;
+    return true;
+  }
+}
+
+template <typename Value, size_t Size>
+MSK_XPU bool none(const Mask<Value, Size> &m) {
+  return !any(m);
+}
+
+template <typename Value, size_t Size>
+std::ostream &operator<<(std::ostream &oss, const Mask<Value, Size> &m) {
+  oss << "[";
+  for (size_t i = 0; i < Size; ++i) oss << (i > 0 ? ", " : "") << m.coeff(i);
+  oss << "]";
+  return oss;
+}
+
 // Array math
 template <typename Value, size_t Size, typename Derived>
 MSK_XPU Value dot(const StaticArrayBase<Value, Size, Derived> &a1,
                   const StaticArrayBase<Value, Size, Derived> &a2) {
-  Value s = a1.coeff(0) * a2.coeff(0);
-  for (int i = 1; i < Size; i++) {
-    s += a1.coeff(i) * a2.coeff(i);
+  using Packet = typename StaticArrayBase<Value, Size, Derived>::Packet;
+  if constexpr (Packet::Enabled) {
+    return Packet::hsum(
+        Packet::mul(Packet::load(a1.data()), Packet::load(a2.data())));
+  } else {
+    Value s = a1.coeff(0) * a2.coeff(0);
+    for (size_t i = 1; i < Size; i++) {
+      s += a1.coeff(i) * a2.coeff(i);
+    }
+    return s;
   }
-  return s;
 }
 
 template <typename Value, size_t Size, typename Derived, class F>
 MSK_XPU Value reduce(const StaticArrayBase<Value, Size, Derived> &a, F &&f) {
   Value acc = a.coeff(0);
-  for (int i = 1; i < Size; ++i) acc = f(acc, a.coeff(i));
+  for (size_t i = 1; i < Size; ++i) acc = f(acc, a.coeff(i));
   return acc;
 }
 
-template <typename Value, size_t Size, typename Derived>
-MSK_XPU Value hsum(const StaticArrayBase<Value, Size, Derived> &a) {
-  return reduce(a, [](const Value &acc, const Value &b) { return acc + b; });
-}
+#define GEN_HORIZONTAL_OP(name, expr)                                       \
+  template <typename Value, size_t Size, typename Derived>                  \
+  MSK_XPU Value name(const StaticArrayBase<Value, Size, Derived> &a) {      \
+    using Packet = typename StaticArrayBase<Value, Size, Derived>::Packet;  \
+    if constexpr (Packet::Enabled) {                                        \
+      return Packet::name(Packet::load(a.data()));                          \
+    } else {                                                                \
+      return reduce(a,                                                      \
+                    [](const Value &acc, const Value &b) { return expr; }); \
+    }                                                                       \
+  }
 
-template <typename Value, size_t Size, typename Derived>
-MSK_XPU Value hprod(const StaticArrayBase<Value, Size, Derived> &a) {
-  return reduce(a, [](const Value &acc, const Value &b) { return acc + b; });
-}
+GEN_HORIZONTAL_OP(hsum, acc + b)
+GEN_HORIZONTAL_OP(hprod, acc * b)
+GEN_HORIZONTAL_OP(hmin, min(acc, b))
+GEN_HORIZONTAL_OP(hmax, max(acc, b))
+#undef GEN_HORIZONTAL_OP
+
+#define GEN_UNARY_OP(name, expr)                                            \
+  template <typename Value, size_t Size, typename Derived>                  \
+  MSK_XPU Derived name(const StaticArrayBase<Value, Size, Derived> &a) {    \
+    using Packet = typename StaticArrayBase<Value, Size, Derived>::Packet;  \
+    Derived ret;                                                            \
+    if constexpr (Packet::Enabled) {                                        \
+      Packet::store(ret.data(), Packet::name(Packet::load(a.data())));      \
+    } else {                                                                \
+      for (size_t i = 0; i < Size; ++i) {                                   \
+        const Value &v = a.coeff(i);                                        \
+        ret.coeff(i) = expr;                                                \
+      }                                                                     \
+    }                                                                       \
+    return ret;                                                             \
+  }
+
+GEN_UNARY_OP(abs, std::abs(v))
+GEN_UNARY_OP(sqrt, std::sqrt(v))
+GEN_UNARY_OP(floor, std::floor(v))
+GEN_UNARY_OP(ceil, std::ceil(v))
+#undef GEN_UNARY_OP
+
+#define GEN_BINARY_OP(name, expr)                                           \
+  template <typename Value, size_t Size, typename Derived>                  \
+  MSK_XPU Derived name(const StaticArrayBase<Value, Size, Derived> &a1,     \
+                       const StaticArrayBase<Value, Size, Derived> &a2) {   \
+    using Packet = typename StaticArrayBase<Value, Size, Derived>::Packet;  \
+    Derived ret;                                                            \
+    if constexpr (Packet::Enabled) {                                        \
+      Packet::store(ret.data(), Packet::name(Packet::load(a1.data()),       \
+                                             Packet::load(a2.data())));     \
+    } else {                                                                \
+      for (size_t i = 0; i < Size; ++i) {                                   \
+        const Value &a = a1.coeff(i), &b = a2.coeff(i);                     \
+        ret.coeff(i) = expr;                                                \
+      }                                                                     \
+    }                                                                       \
+    return ret;                                                             \
+  }
+
+GEN_BINARY_OP(min, min(a, b))
+GEN_BINARY_OP(max, max(a, b))
+GEN_BINARY_OP(copysign, copysign(a, b))
+#undef GEN_BINARY_OP
 
 template <typename Value, size_t Size, typename Derived>
-MSK_XPU Value hmin(const StaticArrayBase<Value, Size, Derived> &a) {
-  return reduce(a,
-                [](const Value &acc, const Value &b) { return min(acc, b); });
+MSK_XPU Derived pow(const StaticArrayBase<Value, Size, Derived> &a,
+                    const Value &e) {
+  Derived ret;
+  for (size_t i = 0; i < Size; ++i) ret.coeff(i) = std::pow(a.coeff(i), e);
+  return ret;
 }
 
-template <typename Value, size_t Size, typename Derived>
-MSK_XPU Value hmax(const StaticArrayBase<Value, Size, Derived> &a) {
-  return reduce(a,
-                [](const Value &acc, const Value &b) { return max(acc, b); });
+template <typename T>
+MSK_XPU T clamp(const T &v, const T &lo, const T &hi) {
+  return min(max(v, lo), hi);
 }
 
 template <size_t Size, typename Derived>
@@ -253,12 +545,19 @@ MSK_XPU bool all(const StaticArrayBase<bool, Size, Derived> &a) {
 }
 
 template <typename Value, size_t Size, typename Derived>
-MSK_XPU Derived select(const StaticArrayBase<bool, Size, Derived> &x,
+MSK_XPU Derived select(const Mask<Value, Size> &m,
                        const StaticArrayBase<Value, Size, Derived> &a,
                        const StaticArrayBase<Value, Size, Derived> &b) {
+  using Packet = detail::Packet<Value, Size>;
   Derived ret;
-  for (int i = 0; i < Size; i++) {
-    ret.coeff(i) = select(x.coeff(i), a.coeff(i), b.coeff(i));
+  if constexpr (Packet::Enabled) {
+    Packet::store(ret.data(),
+                  Packet::select(Packet::load(m.data()), Packet::load(a.data()),
+                                 Packet::load(b.data())));
+  } else {
+    for (size_t i = 0; i < Size; i++) {
+      ret.coeff(i) = select(m.coeff(i), a.coeff(i), b.coeff(i));
+    }
   }
   return ret;
 }
@@ -295,4 +594,10 @@ class Array : public StaticArrayBase<Value_, Size_, Array<Value_, Size_>> {
   MSK_ARRAY_IMPORT(Base, Array)
 };
 
+// Packet types that map onto a single SSE/AVX register when available
+using Packet4f = Array<float, 4>;
+using Packet8f = Array<float, 8>;
+using Packet2d = Array<double, 2>;
+using Packet4d = Array<double, 4>;
+
 }  // namespace misaki::math
\ No newline at end of file
@@ -0,0 +1,190 @@
+#pragma once
+
+#include "array_sse.hpp"
+
+namespace misaki::math::detail {
+
+// 8 x float packet backed by an AVX register
+template <>
+struct Packet<float, 8> {
+  static constexpr bool Enabled = true;
+  static constexpr size_t Alignment = 32;
+  using Register = __m256;
+  using Half = Packet<float, 4>;
+
+  MSK_INLINE static Register load(const float *p) { return _mm256_load_ps(p); }
+  MSK_INLINE static void store(float *p, Register a) { _mm256_store_ps(p, a); }
+  MSK_INLINE static Register loadu(const float *p) { return _mm256_loadu_ps(p); }
+  MSK_INLINE static void storeu(float *p, Register a) { _mm256_storeu_ps(p, a); }
+  MSK_INLINE static Register gather(const float *p, size_t stride) {
+    return _mm256_setr_ps(p[0], p[stride], p[2 * stride], p[3 * stride],
+                          p[4 * stride], p[5 * stride], p[6 * stride],
+                          p[7 * stride]);
+  }
+  MSK_INLINE static Register set1(float v) { return _mm256_set1_ps(v); }
+
+  MSK_INLINE static Register add(Register a, Register b) { return _mm256_add_ps(a, b); }
+  MSK_INLINE static Register sub(Register a, Register b) { return _mm256_sub_ps(a, b); }
+  MSK_INLINE static Register mul(Register a, Register b) { return _mm256_mul_ps(a, b); }
+  MSK_INLINE static Register div(Register a, Register b) { return _mm256_div_ps(a, b); }
+  MSK_INLINE static Register min(Register a, Register b) { return _mm256_min_ps(a, b); }
+  MSK_INLINE static Register max(Register a, Register b) { return _mm256_max_ps(a, b); }
+  MSK_INLINE static Register neg(Register a) {
+    return _mm256_xor_ps(a, _mm256_set1_ps(-0.f));
+  }
+  MSK_INLINE static Register abs(Register a) {
+    return _mm256_andnot_ps(_mm256_set1_ps(-0.f), a);
+  }
+  MSK_INLINE static Register copysign(Register a, Register b) {
+    const Register sign = _mm256_set1_ps(-0.f);
+    return _mm256_or_ps(_mm256_andnot_ps(sign, a), _mm256_and_ps(sign, b));
+  }
+  MSK_INLINE static Register sqrt(Register a) { return _mm256_sqrt_ps(a); }
+  MSK_INLINE static Register floor(Register a) { return _mm256_floor_ps(a); }
+  MSK_INLINE static Register ceil(Register a) { return _mm256_ceil_ps(a); }
+
+  MSK_INLINE static Register eq(Register a, Register b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+  MSK_INLINE static Register neq(Register a, Register b) { return _mm256_cmp_ps(a, b, _CMP_NEQ_UQ); }
+  MSK_INLINE static Register le(Register a, Register b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+  MSK_INLINE static Register ge(Register a, Register b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+  MSK_INLINE static Register lt(Register a, Register b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+  MSK_INLINE static Register gt(Register a, Register b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+
+  MSK_INLINE static Register and_(Register a, Register b) { return _mm256_and_ps(a, b); }
+  MSK_INLINE static Register or_(Register a, Register b) { return _mm256_or_ps(a, b); }
+  MSK_INLINE static Register xor_(Register a, Register b) { return _mm256_xor_ps(a, b); }
+  MSK_INLINE static Register andnot(Register a, Register b) { return _mm256_andnot_ps(b, a); }
+  MSK_INLINE static Register ones() { return _mm256_castsi256_ps(_mm256_set1_epi32(-1)); }
+#if defined(MSK_X86_AVX2)
+  MSK_INLINE static Register sll(Register a, int n) {
+    return _mm256_castsi256_ps(_mm256_sll_epi32(_mm256_castps_si256(a), _mm_cvtsi32_si128(n)));
+  }
+  MSK_INLINE static Register srl(Register a, int n) {
+    return _mm256_castsi256_ps(_mm256_srl_epi32(_mm256_castps_si256(a), _mm_cvtsi32_si128(n)));
+  }
+#else
+  MSK_INLINE static Register sll(Register a, int n) {
+    return _mm256_set_m128(Half::sll(_mm256_extractf128_ps(a, 1), n),
+                           Half::sll(_mm256_castps256_ps128(a), n));
+  }
+  MSK_INLINE static Register srl(Register a, int n) {
+    return _mm256_set_m128(Half::srl(_mm256_extractf128_ps(a, 1), n),
+                           Half::srl(_mm256_castps256_ps128(a), n));
+  }
+#endif
+  MSK_INLINE static Register rsqrt(Register a) { return _mm256_rsqrt_ps(a); }
+
+  MSK_INLINE static Register select(Register m, Register t, Register f) {
+    return _mm256_blendv_ps(f, t, m);
+  }
+  MSK_INLINE static int movemask(Register m) { return _mm256_movemask_ps(m); }
+
+  MSK_INLINE static float hsum(Register a) {
+    return Half::hsum(_mm_add_ps(_mm256_castps256_ps128(a),
+                                 _mm256_extractf128_ps(a, 1)));
+  }
+  MSK_INLINE static float hprod(Register a) {
+    return Half::hprod(_mm_mul_ps(_mm256_castps256_ps128(a),
+                                  _mm256_extractf128_ps(a, 1)));
+  }
+  MSK_INLINE static float hmin(Register a) {
+    return Half::hmin(_mm_min_ps(_mm256_castps256_ps128(a),
+                                 _mm256_extractf128_ps(a, 1)));
+  }
+  MSK_INLINE static float hmax(Register a) {
+    return Half::hmax(_mm_max_ps(_mm256_castps256_ps128(a),
+                                 _mm256_extractf128_ps(a, 1)));
+  }
+};
+
+// 4 x double packet backed by an AVX register
+template <>
+struct Packet<double, 4> {
+  static constexpr bool Enabled = true;
+  static constexpr size_t Alignment = 32;
+  using Register = __m256d;
+  using Half = Packet<double, 2>;
+
+  MSK_INLINE static Register load(const double *p) { return _mm256_load_pd(p); }
+  MSK_INLINE static void store(double *p, Register a) { _mm256_store_pd(p, a); }
+  MSK_INLINE static Register loadu(const double *p) { return _mm256_loadu_pd(p); }
+  MSK_INLINE static void storeu(double *p, Register a) { _mm256_storeu_pd(p, a); }
+  MSK_INLINE static Register gather(const double *p, size_t stride) {
+    return _mm256_setr_pd(p[0], p[stride], p[2 * stride], p[3 * stride]);
+  }
+  MSK_INLINE static Register set1(double v) { return _mm256_set1_pd(v); }
+
+  MSK_INLINE static Register add(Register a, Register b) { return _mm256_add_pd(a, b); }
+  MSK_INLINE static Register sub(Register a, Register b) { return _mm256_sub_pd(a, b); }
+  MSK_INLINE static Register mul(Register a, Register b) { return _mm256_mul_pd(a, b); }
+  MSK_INLINE static Register div(Register a, Register b) { return _mm256_div_pd(a, b); }
+  MSK_INLINE static Register min(Register a, Register b) { return _mm256_min_pd(a, b); }
+  MSK_INLINE static Register max(Register a, Register b) { return _mm256_max_pd(a, b); }
+  MSK_INLINE static Register neg(Register a) {
+    return _mm256_xor_pd(a, _mm256_set1_pd(-0.0));
+  }
+  MSK_INLINE static Register abs(Register a) {
+    return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a);
+  }
+  MSK_INLINE static Register copysign(Register a, Register b) {
+    const Register sign = _mm256_set1_pd(-0.0);
+    return _mm256_or_pd(_mm256_andnot_pd(sign, a), _mm256_and_pd(sign, b));
+  }
+  MSK_INLINE static Register sqrt(Register a) { return _mm256_sqrt_pd(a); }
+  MSK_INLINE static Register floor(Register a) { return _mm256_floor_pd(a); }
+  MSK_INLINE static Register ceil(Register a) { return _mm256_ceil_pd(a); }
+
+  MSK_INLINE static Register eq(Register a, Register b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+  MSK_INLINE static Register neq(Register a, Register b) { return _mm256_cmp_pd(a, b, _CMP_NEQ_UQ); }
+  MSK_INLINE static Register le(Register a, Register b) { return _mm256_cmp_pd(a, b, _CMP_LE_OQ); }
+  MSK_INLINE static Register ge(Register a, Register b) { return _mm256_cmp_pd(a, b, _CMP_GE_OQ); }
+  MSK_INLINE static Register lt(Register a, Register b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+  MSK_INLINE static Register gt(Register a, Register b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+
+  MSK_INLINE static Register and_(Register a, Register b) { return _mm256_and_pd(a, b); }
+  MSK_INLINE static Register or_(Register a, Register b) { return _mm256_or_pd(a, b); }
+  MSK_INLINE static Register xor_(Register a, Register b) { return _mm256_xor_pd(a, b); }
+  MSK_INLINE static Register andnot(Register a, Register b) { return _mm256_andnot_pd(b, a); }
+  MSK_INLINE static Register ones() { return _mm256_castsi256_pd(_mm256_set1_epi32(-1)); }
+#if defined(MSK_X86_AVX2)
+  MSK_INLINE static Register sll(Register a, int n) {
+    return _mm256_castsi256_pd(_mm256_sll_epi64(_mm256_castpd_si256(a), _mm_cvtsi32_si128(n)));
+  }
+  MSK_INLINE static Register srl(Register a, int n) {
+    return _mm256_castsi256_pd(_mm256_srl_epi64(_mm256_castpd_si256(a), _mm_cvtsi32_si128(n)));
+  }
+#else
+  MSK_INLINE static Register sll(Register a, int n) {
+    return _mm256_set_m128d(Half::sll(_mm256_extractf128_pd(a, 1), n),
+                            Half::sll(_mm256_castpd256_pd128(a), n));
+  }
+  MSK_INLINE static Register srl(Register a, int n) {
+    return _mm256_set_m128d(Half::srl(_mm256_extractf128_pd(a, 1), n),
+                            Half::srl(_mm256_castpd256_pd128(a), n));
+  }
+#endif
+
+  MSK_INLINE static Register select(Register m, Register t, Register f) {
+    return _mm256_blendv_pd(f, t, m);
+  }
+  MSK_INLINE static int movemask(Register m) { return _mm256_movemask_pd(m); }
+
+  MSK_INLINE static double hsum(Register a) {
+    return Half::hsum(_mm_add_pd(_mm256_castpd256_pd128(a),
+                                 _mm256_extractf128_pd(a, 1)));
+  }
+  MSK_INLINE static double hprod(Register a) {
+    return Half::hprod(_mm_mul_pd(_mm256_castpd256_pd128(a),
+                                  _mm256_extractf128_pd(a, 1)));
+  }
+  MSK_INLINE static double hmin(Register a) {
+    return Half::hmin(_mm_min_pd(_mm256_castpd256_pd128(a),
+                                 _mm256_extractf128_pd(a, 1)));
+  }
+  MSK_INLINE static double hmax(Register a) {
+    return Half::hmax(_mm_max_pd(_mm256_castpd256_pd128(a),
+                                 _mm256_extractf128_pd(a, 1)));
+  }
+};
+
+}  // namespace misaki::math::detail
@@ -0,0 +1,234 @@
+#pragma once
+
+#include <utility>
+
+#include "array.hpp"
+
+namespace misaki::math {
+
+// Opt-in lazy evaluation for element-wise array arithmetic.
+//
+//   Array<float, 4> r = lazy(a) * b - c * d + e;
+//
+// builds an expression tree instead of one temporary per operator, and the
+// whole chain is evaluated in a single loop (or a single register pass for
+// arrays backed by SSE/AVX) when it is converted back to an Array. Leaves
+// reference their arrays, so expressions must be evaluated before the
+// arrays they were built from go out of scope (do not store them in auto).
+namespace expr {
+
+template <typename E>
+MSK_XPU Array<typename E::Value, E::Size> evaluate(const E &e);
+
+template <typename Value_, size_t Size_>
+struct Leaf {
+  using Value = Value_;
+  using Packet = detail::Packet<Value_, Size_>;
+  static constexpr size_t Size = Size_;
+
+  const Value *ptr;
+
+  MSK_XPU Value coeff(size_t i) const { return ptr[i]; }
+  // Lanes offset to offset + P's width, only the full array is aligned
+  template <typename P>
+  MSK_XPU auto reg(size_t offset) const {
+    if constexpr (std::is_same_v<P, Packet>)
+      return P::load(ptr);
+    else
+      return P::loadu(ptr + offset);
+  }
+
+  MSK_XPU operator Array<Value, Size>() const { return evaluate(*this); }
+};
+
+template <typename Value_, size_t Size_>
+struct Scalar {
+  using Value = Value_;
+  using Packet = detail::Packet<Value_, Size_>;
+  static constexpr size_t Size = Size_;
+
+  Value value;
+
+  MSK_XPU Value coeff(size_t) const { return value; }
+  template <typename P>
+  MSK_XPU auto reg(size_t) const {
+    return P::set1(value);
+  }
+
+  MSK_XPU operator Array<Value, Size>() const { return evaluate(*this); }
+};
+
+#define GEN_EXPR_OP_TAG(Name, expr, packet_op)                              \
+  struct Name {                                                             \
+    template <typename T>                                                   \
+    MSK_XPU static T apply(const T &a, const T &b) {                        \
+      return expr;                                                          \
+    }                                                                       \
+    template <typename Packet, typename Register>                           \
+    MSK_XPU static Register apply_packet(Register a, Register b) {          \
+      return Packet::packet_op(a, b);                                       \
+    }                                                                       \
+  };
+
+GEN_EXPR_OP_TAG(Add, a + b, add)
+GEN_EXPR_OP_TAG(Sub, a - b, sub)
+GEN_EXPR_OP_TAG(Mul, a * b, mul)
+GEN_EXPR_OP_TAG(Div, a / b, div)
+GEN_EXPR_OP_TAG(Min, math::min(a, b), min)
+GEN_EXPR_OP_TAG(Max, math::max(a, b), max)
+#undef GEN_EXPR_OP_TAG
+
+template <typename Op, typename L, typename R>
+struct Binary {
+  using Value = typename L::Value;
+  using Packet = typename L::Packet;
+  static constexpr size_t Size = L::Size;
+
+  L lhs;
+  R rhs;
+
+  MSK_XPU Value coeff(size_t i) const {
+    return Op::apply(lhs.coeff(i), rhs.coeff(i));
+  }
+  template <typename P>
+  MSK_XPU auto reg(size_t offset) const {
+    return Op::template apply_packet<P>(lhs.template reg<P>(offset),
+                                        rhs.template reg<P>(offset));
+  }
+
+  MSK_XPU operator Array<Value, Size>() const { return evaluate(*this); }
+};
+
+template <typename E>
+struct Neg {
+  using Value = typename E::Value;
+  using Packet = typename E::Packet;
+  static constexpr size_t Size = E::Size;
+
+  E arg;
+
+  MSK_XPU Value coeff(size_t i) const { return -arg.coeff(i); }
+  template <typename P>
+  MSK_XPU auto reg(size_t offset) const {
+    return P::neg(arg.template reg<P>(offset));
+  }
+
+  MSK_XPU operator Array<Value, Size>() const { return evaluate(*this); }
+};
+
+template <typename T>
+struct is_expr : std::false_type {};
+template <typename V, size_t S>
+struct is_expr<Leaf<V, S>> : std::true_type {};
+template <typename V, size_t S>
+struct is_expr<Scalar<V, S>> : std::true_type {};
+template <typename Op, typename L, typename R>
+struct is_expr<Binary<Op, L, R>> : std::true_type {};
+template <typename E>
+struct is_expr<Neg<E>> : std::true_type {};
+
+template <typename T>
+constexpr bool is_expr_v = is_expr<T>::value;
+
+// Lift an operand to an expression node of the given value type and size
+template <typename Value, size_t Size, typename T>
+MSK_XPU auto lift(const T &v) {
+  if constexpr (is_expr_v<T>)
+    return v;
+  else if constexpr (std::is_arithmetic_v<T>)
+    return Scalar<Value, Size>{Value(v)};
+  else
+    return Leaf<Value, Size>{v.data()};
+}
+
+template <size_t First, typename E, typename Out, size_t... I>
+MSK_XPU void evaluate_lanes(const E &e, Out &ret, std::index_sequence<I...>) {
+  ((ret.coeff(First + I) = e.coeff(First + I)), ...);
+}
+
+// One register pass for packet backed arrays. Other sizes are evaluated in
+// chunks of the widest register, e.g. Size 16 as two AVX passes, and the
+// remaining lanes are unrolled so that the result stays in registers.
+template <typename E>
+MSK_XPU Array<typename E::Value, E::Size> evaluate(const E &e) {
+  using Value = typename E::Value;
+  using Packet = typename E::Packet;
+  Array<Value, E::Size> ret;
+  if constexpr (Packet::Enabled) {
+    Packet::store(ret.data(), e.template reg<Packet>(0));
+  } else {
+    constexpr size_t Width = detail::native_width_v<Value>;
+    constexpr size_t Chunked = Width > 1 ? E::Size / Width * Width : 0;
+    if constexpr (Chunked > 0) {
+      using Chunk = detail::Packet<Value, Width>;
+      for (size_t i = 0; i < Chunked; i += Width)
+        Chunk::storeu(ret.data() + i, e.template reg<Chunk>(i));
+    }
+    evaluate_lanes<Chunked>(e, ret,
+                            std::make_index_sequence<E::Size - Chunked>());
+  }
+  return ret;
+}
+
+// Operators live next to the nodes, so that argument dependent lookup finds
+// them from any namespace
+#define GEN_EXPR_BINARY_OP(op, Name)                                        \
+  template <typename L, typename R,                                         \
+            std::enable_if_t<is_expr_v<L>, int> = 0>                        \
+  MSK_XPU auto operator op(const L &l, const R &r) {                        \
+    auto rhs = lift<typename L::Value, L::Size>(r);                         \
+    return Binary<Name, L, decltype(rhs)>{l, rhs};                          \
+  }                                                                         \
+  template <typename L, typename R,                                         \
+            std::enable_if_t<!is_expr_v<L> && is_expr_v<R>,                 \
+                             int> = 0>                                      \
+  MSK_XPU auto operator op(const L &l, const R &r) {                        \
+    auto lhs = lift<typename R::Value, R::Size>(l);                         \
+    return Binary<Name, decltype(lhs), R>{lhs, r};                          \
+  }
+
+GEN_EXPR_BINARY_OP(+, Add)
+GEN_EXPR_BINARY_OP(-, Sub)
+GEN_EXPR_BINARY_OP(*, Mul)
+GEN_EXPR_BINARY_OP(/, Div)
+#undef GEN_EXPR_BINARY_OP
+
+template <typename E, std::enable_if_t<is_expr_v<E>, int> = 0>
+MSK_XPU auto operator-(const E &e) {
+  return Neg<E>{e};
+}
+
+template <typename L, typename R,
+          std::enable_if_t<is_expr_v<L> || is_expr_v<R>, int> = 0>
+MSK_XPU auto min(const L &l, const R &r) {
+  using Info = std::conditional_t<is_expr_v<L>, L, R>;
+  auto lhs = lift<typename Info::Value, Info::Size>(l);
+  auto rhs = lift<typename Info::Value, Info::Size>(r);
+  return Binary<Min, decltype(lhs), decltype(rhs)>{lhs, rhs};
+}
+
+template <typename L, typename R,
+          std::enable_if_t<is_expr_v<L> || is_expr_v<R>, int> = 0>
+MSK_XPU auto max(const L &l, const R &r) {
+  using Info = std::conditional_t<is_expr_v<L>, L, R>;
+  auto lhs = lift<typename Info::Value, Info::Size>(l);
+  auto rhs = lift<typename Info::Value, Info::Size>(r);
+  return Binary<Max, decltype(lhs), decltype(rhs)>{lhs, rhs};
+}
+
+}  // namespace expr
+
+// Start a lazy expression from an array
+template <typename Value, size_t Size, typename Derived>
+MSK_XPU expr::Leaf<Value, Size> lazy(
+    const StaticArrayBase<Value, Size, Derived> &a) {
+  return {a.data()};
+}
+
+// Evaluated result of a lazy expression
+template <typename E, std::enable_if_t<expr::is_expr_v<E>, int> = 0>
+MSK_XPU auto eval(const E &e) {
+  return expr::evaluate(e);
+}
+
+}  // namespace misaki::math
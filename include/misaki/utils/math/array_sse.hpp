@@ -0,0 +1,164 @@
+#pragma once
+
+#include <immintrin.h>
+
+namespace misaki::math::detail {
+
+// 4 x float packet backed by an SSE register
+template <>
+struct Packet<float, 4> {
+  static constexpr bool Enabled = true;
+  static constexpr size_t Alignment = 16;
+  using Register = __m128;
+
+  MSK_INLINE static Register load(const float *p) { return _mm_load_ps(p); }
+  MSK_INLINE static void store(float *p, Register a) { _mm_store_ps(p, a); }
+  MSK_INLINE static Register loadu(const float *p) { return _mm_loadu_ps(p); }
+  MSK_INLINE static void storeu(float *p, Register a) { _mm_storeu_ps(p, a); }
+  // Lanes p[0], p[stride], p[2 * stride], ...
+  MSK_INLINE static Register gather(const float *p, size_t stride) {
+    return _mm_setr_ps(p[0], p[stride], p[2 * stride], p[3 * stride]);
+  }
+  MSK_INLINE static Register set1(float v) { return _mm_set1_ps(v); }
+
+  MSK_INLINE static Register add(Register a, Register b) { return _mm_add_ps(a, b); }
+  MSK_INLINE static Register sub(Register a, Register b) { return _mm_sub_ps(a, b); }
+  MSK_INLINE static Register mul(Register a, Register b) { return _mm_mul_ps(a, b); }
+  MSK_INLINE static Register div(Register a, Register b) { return _mm_div_ps(a, b); }
+  MSK_INLINE static Register min(Register a, Register b) { return _mm_min_ps(a, b); }
+  MSK_INLINE static Register max(Register a, Register b) { return _mm_max_ps(a, b); }
+  MSK_INLINE static Register neg(Register a) {
+    return _mm_xor_ps(a, _mm_set1_ps(-0.f));
+  }
+  MSK_INLINE static Register abs(Register a) {
+    return _mm_andnot_ps(_mm_set1_ps(-0.f), a);
+  }
+  MSK_INLINE static Register copysign(Register a, Register b) {
+    const Register sign = _mm_set1_ps(-0.f);
+    return _mm_or_ps(_mm_andnot_ps(sign, a), _mm_and_ps(sign, b));
+  }
+  MSK_INLINE static Register sqrt(Register a) { return _mm_sqrt_ps(a); }
+  MSK_INLINE static Register floor(Register a) { return _mm_floor_ps(a); }
+  MSK_INLINE static Register ceil(Register a) { return _mm_ceil_ps(a); }
+
+  MSK_INLINE static Register eq(Register a, Register b) { return _mm_cmpeq_ps(a, b); }
+  MSK_INLINE static Register neq(Register a, Register b) { return _mm_cmpneq_ps(a, b); }
+  MSK_INLINE static Register le(Register a, Register b) { return _mm_cmple_ps(a, b); }
+  MSK_INLINE static Register ge(Register a, Register b) { return _mm_cmpge_ps(a, b); }
+  MSK_INLINE static Register lt(Register a, Register b) { return _mm_cmplt_ps(a, b); }
+  MSK_INLINE static Register gt(Register a, Register b) { return _mm_cmpgt_ps(a, b); }
+
+  MSK_INLINE static Register and_(Register a, Register b) { return _mm_and_ps(a, b); }
+  MSK_INLINE static Register or_(Register a, Register b) { return _mm_or_ps(a, b); }
+  MSK_INLINE static Register xor_(Register a, Register b) { return _mm_xor_ps(a, b); }
+  MSK_INLINE static Register andnot(Register a, Register b) { return _mm_andnot_ps(b, a); }
+  MSK_INLINE static Register ones() { return _mm_castsi128_ps(_mm_set1_epi32(-1)); }
+  // Shift the bit pattern of every lane
+  MSK_INLINE static Register sll(Register a, int n) {
+    return _mm_castsi128_ps(_mm_sll_epi32(_mm_castps_si128(a), _mm_cvtsi32_si128(n)));
+  }
+  MSK_INLINE static Register srl(Register a, int n) {
+    return _mm_castsi128_ps(_mm_srl_epi32(_mm_castps_si128(a), _mm_cvtsi32_si128(n)));
+  }
+  // About 12 bits of precision
+  MSK_INLINE static Register rsqrt(Register a) { return _mm_rsqrt_ps(a); }
+
+  // Lanes of m must be all-ones or all-zeros
+  MSK_INLINE static Register select(Register m, Register t, Register f) {
+    return _mm_blendv_ps(f, t, m);
+  }
+  MSK_INLINE static int movemask(Register m) { return _mm_movemask_ps(m); }
+
+  MSK_INLINE static float hsum(Register a) {
+    __m128 t = _mm_add_ps(a, _mm_movehl_ps(a, a));
+    return _mm_cvtss_f32(_mm_add_ss(t, _mm_shuffle_ps(t, t, 1)));
+  }
+  MSK_INLINE static float hprod(Register a) {
+    __m128 t = _mm_mul_ps(a, _mm_movehl_ps(a, a));
+    return _mm_cvtss_f32(_mm_mul_ss(t, _mm_shuffle_ps(t, t, 1)));
+  }
+  MSK_INLINE static float hmin(Register a) {
+    __m128 t = _mm_min_ps(a, _mm_movehl_ps(a, a));
+    return _mm_cvtss_f32(_mm_min_ss(t, _mm_shuffle_ps(t, t, 1)));
+  }
+  MSK_INLINE static float hmax(Register a) {
+    __m128 t = _mm_max_ps(a, _mm_movehl_ps(a, a));
+    return _mm_cvtss_f32(_mm_max_ss(t, _mm_shuffle_ps(t, t, 1)));
+  }
+};
+
+// 2 x double packet backed by an SSE register
+template <>
+struct Packet<double, 2> {
+  static constexpr bool Enabled = true;
+  static constexpr size_t Alignment = 16;
+  using Register = __m128d;
+
+  MSK_INLINE static Register load(const double *p) { return _mm_load_pd(p); }
+  MSK_INLINE static void store(double *p, Register a) { _mm_store_pd(p, a); }
+  MSK_INLINE static Register loadu(const double *p) { return _mm_loadu_pd(p); }
+  MSK_INLINE static void storeu(double *p, Register a) { _mm_storeu_pd(p, a); }
+  MSK_INLINE static Register gather(const double *p, size_t stride) {
+    return _mm_setr_pd(p[0], p[stride]);
+  }
+  MSK_INLINE static Register set1(double v) { return _mm_set1_pd(v); }
+
+  MSK_INLINE static Register add(Register a, Register b) { return _mm_add_pd(a, b); }
+  MSK_INLINE static Register sub(Register a, Register b) { return _mm_sub_pd(a, b); }
+  MSK_INLINE static Register mul(Register a, Register b) { return _mm_mul_pd(a, b); }
+  MSK_INLINE static Register div(Register a, Register b) { return _mm_div_pd(a, b); }
+  MSK_INLINE static Register min(Register a, Register b) { return _mm_min_pd(a, b); }
+  MSK_INLINE static Register max(Register a, Register b) { return _mm_max_pd(a, b); }
+  MSK_INLINE static Register neg(Register a) {
+    return _mm_xor_pd(a, _mm_set1_pd(-0.0));
+  }
+  MSK_INLINE static Register abs(Register a) {
+    return _mm_andnot_pd(_mm_set1_pd(-0.0), a);
+  }
+  MSK_INLINE static Register copysign(Register a, Register b) {
+    const Register sign = _mm_set1_pd(-0.0);
+    return _mm_or_pd(_mm_andnot_pd(sign, a), _mm_and_pd(sign, b));
+  }
+  MSK_INLINE static Register sqrt(Register a) { return _mm_sqrt_pd(a); }
+  MSK_INLINE static Register floor(Register a) { return _mm_floor_pd(a); }
+  MSK_INLINE static Register ceil(Register a) { return _mm_ceil_pd(a); }
+
+  MSK_INLINE static Register eq(Register a, Register b) { return _mm_cmpeq_pd(a, b); }
+  MSK_INLINE static Register neq(Register a, Register b) { return _mm_cmpneq_pd(a, b); }
+  MSK_INLINE static Register le(Register a, Register b) { return _mm_cmple_pd(a, b); }
+  MSK_INLINE static Register ge(Register a, Register b) { return _mm_cmpge_pd(a, b); }
+  MSK_INLINE static Register lt(Register a, Register b) { return _mm_cmplt_pd(a, b); }
+  MSK_INLINE static Register gt(Register a, Register b) { return _mm_cmpgt_pd(a, b); }
+
+  MSK_INLINE static Register and_(Register a, Register b) { return _mm_and_pd(a, b); }
+  MSK_INLINE static Register or_(Register a, Register b) { return _mm_or_pd(a, b); }
+  MSK_INLINE static Register xor_(Register a, Register b) { return _mm_xor_pd(a, b); }
+  MSK_INLINE static Register andnot(Register a, Register b) { return _mm_andnot_pd(b, a); }
+  MSK_INLINE static Register ones() { return _mm_castsi128_pd(_mm_set1_epi32(-1)); }
+  MSK_INLINE static Register sll(Register a, int n) {
+    return _mm_castsi128_pd(_mm_sll_epi64(_mm_castpd_si128(a), _mm_cvtsi32_si128(n)));
+  }
+  MSK_INLINE static Register srl(Register a, int n) {
+    return _mm_castsi128_pd(_mm_srl_epi64(_mm_castpd_si128(a), _mm_cvtsi32_si128(n)));
+  }
+
+  MSK_INLINE static Register select(Register m, Register t, Register f) {
+    return _mm_blendv_pd(f, t, m);
+  }
+  MSK_INLINE static int movemask(Register m) { return _mm_movemask_pd(m); }
+
+  MSK_INLINE static double hsum(Register a) {
+    return _mm_cvtsd_f64(_mm_add_sd(a, _mm_unpackhi_pd(a, a)));
+  }
+  MSK_INLINE static double hprod(Register a) {
+    return _mm_cvtsd_f64(_mm_mul_sd(a, _mm_unpackhi_pd(a, a)));
+  }
+  MSK_INLINE static double hmin(Register a) {
+    return _mm_cvtsd_f64(_mm_min_sd(a, _mm_unpackhi_pd(a, a)));
+  }
+  MSK_INLINE static double hmax(Register a) {
+    return _mm_cvtsd_f64(_mm_max_sd(a, _mm_unpackhi_pd(a, a)));
+  }
+};
+
+}  // namespace misaki::math::detail
@@ -25,20 +25,20 @@ struct TBoundingBox2 {
 
   template <typename T>
   MSK_XPU void clip(const TBoundingBox2<T> &bbox) {
-    pmin = cwise_max(pmin, bbox.pmin);
-    pmax = cwise_min(pmax, bbox.pmax);
+    pmin = max(pmin, bbox.pmin);
+    pmax = min(pmax, bbox.pmax);
   }
 
   template <typename T>
   MSK_XPU void expand(const TVector2<T> &p) {
-    pmin = cwise_min(pmin, p);
-    pmax = cwise_max(pmax, p);
+    pmin = min(pmin, p);
+    pmax = max(pmax, p);
   }
 
   template <typename T>
   MSK_XPU void expand(const TBoundingBox2<T> &bbox) {
-    pmin = cwise_min(pmin, bbox.pmin);
-    pmax = cwise_max(pmax, bbox.pmax);
+    pmin = min(pmin, bbox.pmin);
+    pmax = max(pmax, bbox.pmax);
   }
 
   MSK_XPU PointType center() const {
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <tuple>
+
 #include "vec3.hpp"
 
 namespace misaki::math {
@@ -25,26 +27,55 @@ struct TBoundingBox3 {
 
   template <typename T>
   MSK_XPU void clip(const TBoundingBox3<T> &bbox) {
-    pmin = cwise_max(pmin, bbox.pmin);
-    pmax = cwise_min(pmax, bbox.pmax);
+    pmin = max(pmin, bbox.pmin);
+    pmax = min(pmax, bbox.pmax);
   }
 
   template <typename T>
   MSK_XPU void expand(const TVector3<T> &p) {
-    pmin = cwise_min(pmin, p);
-    pmax = cwise_max(pmax, p);
+    pmin = min(pmin, p);
+    pmax = max(pmax, p);
   }
 
   template <typename T>
   MSK_XPU void expand(const TBoundingBox3<T> &bbox) {
-    pmin = cwise_min(pmin, bbox.pmin);
-    pmax = cwise_max(pmax, bbox.pmax);
+    pmin = min(pmin, bbox.pmin);
+    pmax = max(pmax, bbox.pmax);
   }
 
   MSK_XPU PointType center() const {
     return (pmin + pmax) * Value(.5f);
   }
 
+  MSK_XPU PointType extent() const { return pmax - pmin; }
+
+  MSK_XPU Value surface_area() const {
+    PointType d = extent();
+    return Value(2) * (d.x * d.y + d.y * d.z + d.z * d.x);
+  }
+
+  // Slab test of the ray o + t * d, t in [tmin, tmax], given inv_dir = 1 / d
+  // (infinite components allowed). Returns {hit, entry, exit}. The exit
+  // distance is scaled up by the rounding bound of the slab computation
+  // (Ize, "Robust BVH Ray Traversal"), so hits are never missed, and NaNs
+  // from a ray running inside a slab plane leave that slab unconstrained.
+  // Near and far planes are picked by direction sign, so empty boxes miss.
+  MSK_XPU auto ray_intersect(const PointType &o, const PointType &inv_dir,
+                             Value tmin, Value tmax) const {
+    using Scalar = scalar_t<Value>;
+    constexpr Scalar FarScale = 1 + 2 * error_gamma<Scalar>(3);
+    Value tnear = tmin, tfar = tmax;
+    for (size_t i = 0; i < 3; ++i) {
+      auto positive = inv_dir[i] >= Value(Scalar(0));
+      Value t0 = (select(positive, pmin[i], pmax[i]) - o[i]) * inv_dir[i],
+            t1 = (select(positive, pmax[i], pmin[i]) - o[i]) *
+                 (inv_dir[i] * FarScale);
+      tnear = select(t0 > tnear, t0, tnear);
+      tfar = select(t1 < tfar, t1, tfar);
+    }
+    return std::make_tuple(tnear <= tfar, tnear, tfar);
+  }
+
   PointType pmin, pmax;
 
   std::string to_string() const {
@@ -68,4 +99,55 @@ std::ostream &operator<<(
 using BoundingBox3f = TBoundingBox3<float>;
 using BoundingBox3d = TBoundingBox3<double>;
 
+// N boxes in SoA layout, one packet per bound coordinate, for testing a ray
+// against all children of a wide BVH node at once
+template <typename Value, size_t N>
+struct TBoundingBox3xN {
+  using Packet = Array<Value, N>;
+  using PointType = TVector3<Value>;
+
+  // All slots empty, so they never report hits
+  MSK_XPU TBoundingBox3xN()
+      : pmin(Packet(std::numeric_limits<Value>::infinity())),
+        pmax(Packet(-std::numeric_limits<Value>::infinity())) {}
+
+  MSK_XPU void set(size_t i, const TBoundingBox3<Value> &bbox) {
+    for (size_t k = 0; k < 3; ++k) {
+      pmin[k].coeff(i) = bbox.pmin[k];
+      pmax[k].coeff(i) = bbox.pmax[k];
+    }
+  }
+
+  MSK_XPU TBoundingBox3<Value> get(size_t i) const {
+    return {{pmin.x.coeff(i), pmin.y.coeff(i), pmin.z.coeff(i)},
+            {pmax.x.coeff(i), pmax.y.coeff(i), pmax.z.coeff(i)}};
+  }
+
+  // Slab test of one ray against the N boxes, with the same guarantees as
+  // TBoundingBox3::ray_intersect(). Returns the hit bits (bit i for box i)
+  // and the entry distances.
+  MSK_XPU std::pair<uint32_t, Packet> ray_intersect(const PointType &o,
+                                                    const PointType &inv_dir,
+                                                    Value tmin,
+                                                    Value tmax) const {
+    constexpr Value FarScale = 1 + 2 * error_gamma<Value>(3);
+    Packet tnear(tmin), tfar(tmax);
+    for (size_t i = 0; i < 3; ++i) {
+      bool positive = inv_dir[i] >= Value(0);
+      const Packet &near_plane = positive ? pmin[i] : pmax[i],
+                   &far_plane = positive ? pmax[i] : pmin[i];
+      Packet t0 = (near_plane - o[i]) * inv_dir[i],
+             t1 = (far_plane - o[i]) * (inv_dir[i] * FarScale);
+      tnear = select(t0 > tnear, t0, tnear);
+      tfar = select(t1 < tfar, t1, tfar);
+    }
+    return {(tnear <= tfar).bits(), tnear};
+  }
+
+  TVector3<Packet> pmin, pmax;
+};
+
+using BoundingBox3x4f = TBoundingBox3xN<float, 4>;
+using BoundingBox3x8f = TBoundingBox3xN<float, 8>;
+
 }  // namespace misaki::math
\ No newline at end of file
@@ -18,7 +18,9 @@ class TColor3 {
 
   MSK_XPU constexpr TColor3(const TVector3<Value> &vec) noexcept : r(vec.x), g(vec.y), b(vec.z) {}
 
-  template <typename T, std::enable_if_t<std::is_arithmetic_v<T>, int> = 0>
+  template <typename T, std::enable_if_t<!std::is_same_v<T, Value> &&
+                                             std::is_constructible_v<Value, T>,
+                                         int> = 0>
   MSK_XPU constexpr TColor3(const TColor3<T> &col) noexcept : r(Value(col.r)), g(Value(col.g)), b(Value(col.b)) {}
 
   // Component access operation
@@ -32,9 +34,9 @@ class TColor3 {
 
   // Inline math functions
   MSK_XPU Self clamp(Value min_v, Value max_v) const noexcept {
-    return Self(std::clamp(r, min_v, max_v),
-                std::clamp(g, min_v, max_v),
-                std::clamp(b, min_v, max_v));
+    return Self(math::clamp(r, min_v, max_v),
+                math::clamp(g, min_v, max_v),
+                math::clamp(b, min_v, max_v));
   }
 
   MSK_XPU auto hsum() const noexcept {
@@ -50,25 +52,38 @@ class TColor3 {
   }
 
   MSK_XPU Self to_srgb() const {
+    using Scalar = scalar_t<Value>;
     Self result;
     for (int i = 0; i < 3; ++i) {
       Value value = this->operator[](i);
-      if (value <= 0.0031308f)
+      if constexpr (is_array_v<Value>) {
+        result[i] = select(value <= Value(Scalar(0.0031308f)),
+                           Scalar(12.92f) * value,
+                           Scalar(1.055f) * pow(value, Scalar(1.0f / 2.4f)) -
+                               Scalar(0.055f));
+      } else if (value <= 0.0031308f) {
         result[i] = 12.92f * value;
-      else
+      } else {
         result[i] = (1.0f + 0.055f) * std::pow(value, 1.0f / 2.4f) - 0.055f;
+      }
     }
     return result;
   }
 
   MSK_XPU Self to_linear() const {
+    using Scalar = scalar_t<Value>;
     Self result;
     for (int i = 0; i < 3; ++i) {
       Value value = this->operator[](i);
-      if (value <= 0.04045f)
+      if constexpr (is_array_v<Value>) {
+        result[i] = select(
+            value <= Value(Scalar(0.04045f)), value * Scalar(1.0f / 12.92f),
+            pow((value + Scalar(0.055f)) * Scalar(1.0f / 1.055f), Scalar(2.4f)));
+      } else if (value <= 0.04045f) {
         result[i] = value * (1.0f / 12.92f);
-      else
+      } else {
         result[i] = std::pow((value + 0.055f) * (1.0f / 1.055f), 2.4f);
+      }
     }
     return result;
   }
@@ -187,6 +202,22 @@ MSK_XPU TColor3<Value> operator/(const TColor3<Value> &lhs, T rhs) noexcept {
   return TColor3<Value>(lhs.r / rhs, lhs.g / rhs, lhs.b / rhs);
 }
 
+// Operations with a packet of scalars, e.g. TColor3<Packet8f> * Packet8f
+template <typename Value, std::enable_if_t<is_array_v<Value>, int> = 0>
+MSK_XPU TColor3<Value> operator*(const TColor3<Value> &lhs, const Value &rhs) noexcept {
+  return TColor3<Value>(lhs.r * rhs, lhs.g * rhs, lhs.b * rhs);
+}
+
+template <typename Value, std::enable_if_t<is_array_v<Value>, int> = 0>
+MSK_XPU TColor3<Value> operator/(const TColor3<Value> &lhs, const Value &rhs) noexcept {
+  return TColor3<Value>(lhs.r / rhs, lhs.g / rhs, lhs.b / rhs);
+}
+
+template <typename Value, std::enable_if_t<is_array_v<Value>, int> = 0>
+MSK_XPU TColor3<Value> operator*(const Value &lhs, const TColor3<Value> &rhs) noexcept {
+  return TColor3<Value>(lhs * rhs.r, lhs * rhs.g, lhs * rhs.b);
+}
+
 // Stream
 template <typename Value>
 std::ostream &operator<<(
@@ -203,5 +234,7 @@ std::ostream &operator<<(
 using Color3f = TColor3<float>;
 using Color3d = TColor3<double>;
 using Color3b = TColor3<unsigned char>;
+using Color3f4 = TColor3<Packet4f>;
+using Color3f8 = TColor3<Packet8f>;
 
 }  // namespace misaki::math
\ No newline at end of file
@@ -20,7 +20,9 @@ class TColor4 {
 
   MSK_XPU constexpr TColor4(const TVector4<Value> &vec) noexcept : r(vec.x), g(vec.y), b(vec.z), a(vec.w) {}
 
-  template <typename T, std::enable_if_t<std::is_arithmetic_v<T>, int> = 0>
+  template <typename T, std::enable_if_t<!std::is_same_v<T, Value> &&
+                                             std::is_constructible_v<Value, T>,
+                                         int> = 0>
   MSK_XPU constexpr TColor4(const TColor4<T> &col) noexcept : r(Value(col.r)), g(Value(col.g)), b(Value(col.b)), a(Value(col.a)) {}
 
   // Component access operation
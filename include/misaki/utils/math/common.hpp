@@ -9,6 +9,7 @@
 #include <type_traits>
 
 #include "../system.h"
+#include "array.hpp"
 
 namespace misaki::math {
 
@@ -35,6 +36,15 @@ template <typename T, std::enable_if_t<std::is_floating_point_v<T>, int> = 0>
 constexpr auto Infinity = std::numeric_limits<T>::infinity();
 template <typename T, std::enable_if_t<std::is_floating_point_v<T>, int> = 0>
 constexpr auto Epsilon = std::numeric_limits<T>::epsilon() / 2;
+template <typename T, std::enable_if_t<std::is_floating_point_v<T>, int> = 0>
+constexpr auto OneMinusEpsilon = T(1) - Epsilon<T>;
+
+// Relative error bound of n chained floating point operations, gamma_n in
+// Higham's notation
+template <typename T, std::enable_if_t<std::is_floating_point_v<T>, int> = 0>
+constexpr T error_gamma(int n) {
+  return (n * Epsilon<T>) / (1 - n * Epsilon<T>);
+}
 
 template <int N, typename T>
 T power(const T &x) {
@@ -71,12 +81,12 @@ MSK_INLINE T sqr(const T &a) {
 
 template <typename T>
 MSK_INLINE auto safe_sqrt(const T &a) {
-  return std::sqrt(std::max(a, T(0)));
+  return sqrt(max(a, T(0)));
 }
 
 template <typename T>
 MSK_INLINE auto safe_rsqrt(const T &a) {
-  return T(1) / std::sqrt(std::max(a, T(0)));
+  return T(1) / sqrt(max(a, T(0)));
 }
 
 template <typename T>
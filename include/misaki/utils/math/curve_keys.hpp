@@ -0,0 +1,164 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "bbox3.hpp"
+
+namespace misaki::math {
+
+// Keys along a space filling curve through a 3D grid. A key type of uint32_t
+// gives 30-bit keys over 2^10 cells per axis, uint64_t 63-bit keys over 2^21.
+enum class SpaceFillingCurve { Morton, Hilbert };
+
+namespace detail {
+
+template <typename Key>
+constexpr int curve_bits = sizeof(Key) == 4 ? 10 : 21;
+
+// Insert two zero bits above each of the low 10 (21) bits
+MSK_XPU inline uint32_t spread_bits(uint32_t x) {
+  x &= 0x3ffu;
+  x = (x | (x << 16)) & 0x030000ffu;
+  x = (x | (x << 8)) & 0x0300f00fu;
+  x = (x | (x << 4)) & 0x030c30c3u;
+  x = (x | (x << 2)) & 0x09249249u;
+  return x;
+}
+
+MSK_XPU inline uint64_t spread_bits(uint64_t x) {
+  x &= 0x1fffffull;
+  x = (x | (x << 32)) & 0x001f00000000ffffull;
+  x = (x | (x << 16)) & 0x001f0000ff0000ffull;
+  x = (x | (x << 8)) & 0x100f00f00f00f00full;
+  x = (x | (x << 4)) & 0x10c30c30c30c30c3ull;
+  x = (x | (x << 2)) & 0x1249249249249249ull;
+  return x;
+}
+
+// Skilling, "Programming the Hilbert curve": turns grid coordinates into the
+// transposed Hilbert index, whose interleaved bits are the key. Split into
+// branch-free rounds, so that batches of points vectorize lane by lane.
+MSK_XPU inline void hilbert_round(uint32_t &x, uint32_t &y, uint32_t &z,
+                                  uint32_t q) {
+  const uint32_t p = q - 1;
+  x ^= p & (0u - ((x & q) != 0));
+  auto exchange = [&](uint32_t &v) {
+    uint32_t set = 0u - ((v & q) != 0), t = (x ^ v) & p & ~set;
+    x ^= (p & set) | t;
+    v ^= t;
+  };
+  exchange(y);
+  exchange(z);
+}
+
+template <int Bits>
+MSK_XPU inline void hilbert_gray(uint32_t &x, uint32_t &y, uint32_t &z) {
+  y ^= x;
+  z ^= y;
+  uint32_t t = 0;
+  for (uint32_t q = 1u << (Bits - 1); q > 1; q >>= 1)
+    t ^= (q - 1) & (0u - ((z & q) != 0));
+  x ^= t;
+  y ^= t;
+  z ^= t;
+}
+
+template <int Bits>
+MSK_XPU inline void hilbert_transpose(uint32_t &x, uint32_t &y, uint32_t &z) {
+  for (uint32_t q = 1u << (Bits - 1); q > 1; q >>= 1) hilbert_round(x, y, z, q);
+  hilbert_gray<Bits>(x, y, z);
+}
+
+// Maps coordinates inside `bounds` to grid cells, clamping outside ones
+template <typename Key, typename Float>
+struct CurveGrid {
+  MSK_XPU CurveGrid(const TBoundingBox3<Float> &bounds) {
+    constexpr Float Cells = Float(1u << curve_bits<Key>);
+    for (int k = 0; k < 3; ++k) {
+      Float extent = bounds.pmax[k] - bounds.pmin[k];
+      base[k] = bounds.pmin[k];
+      scale[k] = extent > 0 ? Cells / extent : Float(0);
+    }
+  }
+
+  MSK_XPU uint32_t cell(Float v, int axis) const {
+    constexpr uint32_t MaxCell = (1u << curve_bits<Key>) - 1;
+    Float c = (v - base[axis]) * scale[axis];
+    // Clamp before converting, the conversion is undefined past 2^32
+    return c > 0 ? uint32_t(std::min(c, Float(MaxCell))) : 0u;
+  }
+
+  Float base[3], scale[3];
+};
+
+}  // namespace detail
+
+template <typename Key>
+MSK_XPU Key morton_encode(uint32_t x, uint32_t y, uint32_t z) {
+  return (detail::spread_bits(Key(x)) << 2) |
+         (detail::spread_bits(Key(y)) << 1) | detail::spread_bits(Key(z));
+}
+
+template <typename Key>
+MSK_XPU Key hilbert_encode(uint32_t x, uint32_t y, uint32_t z) {
+  detail::hilbert_transpose<detail::curve_bits<Key>>(x, y, z);
+  return morton_encode<Key>(x, y, z);
+}
+
+template <typename Key, typename Float>
+MSK_XPU Key curve_key(SpaceFillingCurve curve, const TVector3<Float> &p,
+                      const TBoundingBox3<Float> &bounds) {
+  detail::CurveGrid<Key, Float> grid(bounds);
+  uint32_t x = grid.cell(p.x, 0), y = grid.cell(p.y, 1), z = grid.cell(p.z, 2);
+  return curve == SpaceFillingCurve::Hilbert ? hilbert_encode<Key>(x, y, z)
+                                             : morton_encode<Key>(x, y, z);
+}
+
+template <typename Key, typename Float>
+MSK_XPU Key morton_key(const TVector3<Float> &p,
+                       const TBoundingBox3<Float> &bounds) {
+  return curve_key<Key>(SpaceFillingCurve::Morton, p, bounds);
+}
+
+template <typename Key, typename Float>
+MSK_XPU Key hilbert_key(const TVector3<Float> &p,
+                        const TBoundingBox3<Float> &bounds) {
+  return curve_key<Key>(SpaceFillingCurve::Hilbert, p, bounds);
+}
+
+// Keys of N points at once, one lane each
+template <typename Key, typename Float, size_t N>
+MSK_XPU Array<Key, N> curve_key(SpaceFillingCurve curve,
+                                const TVector3<Array<Float, N>> &p,
+                                const TBoundingBox3<Float> &bounds) {
+  detail::CurveGrid<Key, Float> grid(bounds);
+  uint32_t x[N], y[N], z[N];
+  for (size_t i = 0; i < N; ++i) {
+    x[i] = grid.cell(p.x.coeff(i), 0);
+    y[i] = grid.cell(p.y.coeff(i), 1);
+    z[i] = grid.cell(p.z.coeff(i), 2);
+  }
+  if (curve == SpaceFillingCurve::Hilbert) {
+    constexpr int Bits = detail::curve_bits<Key>;
+    for (uint32_t q = 1u << (Bits - 1); q > 1; q >>= 1)
+      for (size_t i = 0; i < N; ++i)
+        detail::hilbert_round(x[i], y[i], z[i], q);
+    for (size_t i = 0; i < N; ++i)
+      detail::hilbert_gray<Bits>(x[i], y[i], z[i]);
+  }
+  Array<Key, N> ret;
+  for (size_t i = 0; i < N; ++i)
+    ret.coeff(i) = morton_encode<Key>(x[i], y[i], z[i]);
+  return ret;
+}
+
+// Keys of `count` points, computed in batches and in parallel
+extern void curve_keys(SpaceFillingCurve curve, const TVector3<float> *points,
+                       size_t count, const TBoundingBox3<float> &bounds,
+                       uint32_t *keys, bool parallel = true);
+extern void curve_keys(SpaceFillingCurve curve, const TVector3<float> *points,
+                       size_t count, const TBoundingBox3<float> &bounds,
+                       uint64_t *keys, bool parallel = true);
+
+}  // namespace misaki::math
\ No newline at end of file
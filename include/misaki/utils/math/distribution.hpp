@@ -0,0 +1,159 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "common.hpp"
+
+namespace misaki::math {
+
+// Discrete distribution over weighted entries, sampled in O(1) from an alias
+// table (Walker). The table is built with the closed form of the sweeping
+// construction from Hübschle-Schneider and Sanders, "Parallel Weighted Random
+// Sampling", where every bucket is found from prefix sums alone, so it builds
+// in parallel. One draw touches a single 8-byte table entry.
+class DiscreteDistribution {
+ public:
+  DiscreteDistribution() = default;
+
+  // Weights must be finite and non-negative with a positive sum, otherwise
+  // std::runtime_error is thrown. With `parallel` large inputs are split
+  // across the thread pool.
+  DiscreteDistribution(const float *weights, size_t size,
+                       bool parallel = false);
+  explicit DiscreteDistribution(const std::vector<float> &weights,
+                                bool parallel = false)
+      : DiscreteDistribution(weights.data(), weights.size(), parallel) {}
+
+  size_t size() const { return m_pmf.size(); }
+  bool empty() const { return m_pmf.empty(); }
+  // Sum of the weights
+  double sum() const { return m_sum; }
+  // Probability of entry `index`
+  float eval_pmf(uint32_t index) const { return m_pmf[index]; }
+
+  // Entry for a uniform 32-bit `u`, e.g. from PCG32::next_uint32(). The high
+  // bits of u * size() pick the bucket and the low 32 bits decide against its
+  // alias, so each decision is resolved to size() / 2^32.
+  uint32_t sample(uint32_t u) const {
+    uint64_t x = uint64_t(u) * m_table.size();
+    const Entry &e = m_table[size_t(x >> 32)];
+    return uint32_t(x) < e.threshold ? uint32_t(x >> 32) : e.alias;
+  }
+
+  // Entry for two uniform `u`, `v` in [0, 1): `u` picks the bucket and `v`
+  // decides against its alias
+  uint32_t sample(float u, float v) const {
+    uint32_t i = std::min(uint32_t(u * float(m_table.size())),
+                          uint32_t(m_table.size() - 1));
+    const Entry &e = m_table[i];
+    return double(v) * 4294967296.0 < double(e.threshold) ? i : e.alias;
+  }
+
+  // A single float leaves too few bits for the alias decision of large
+  // tables, use one of the overloads above
+  template <typename T>
+  uint32_t sample(T u) const = delete;
+
+  // Entry and its probability
+  std::pair<uint32_t, float> sample_pmf(uint32_t u) const {
+    uint32_t index = sample(u);
+    return {index, m_pmf[index]};
+  }
+
+  template <size_t N>
+  Array<uint32_t, N> sample(const Array<uint32_t, N> &u) const {
+    Array<uint32_t, N> ret;
+    for (size_t i = 0; i < N; ++i) ret.coeff(i) = sample(u.coeff(i));
+    return ret;
+  }
+
+  void sample(const uint32_t *u, uint32_t *out, size_t count) const;
+
+ private:
+  // Keep the bucket when the 32-bit fraction within it is below `threshold`,
+  // the probability of keeping it in fixed point, else take `alias`
+  struct Entry {
+    uint32_t threshold;
+    uint32_t alias;
+  };
+
+  std::vector<Entry> m_table;
+  std::vector<float> m_pmf;
+  double m_sum = 0.0;
+};
+
+// Discrete distribution sampled by inverting its CDF. A guide table of one
+// slot per entry (Chen and Asau's cutpoint method) narrows each search to the
+// entries between two slots, so draws take O(1) expected steps while the
+// mapping from `u` to entries stays monotonic: samples can be reused and
+// stratified inputs give stratified outputs.
+class DiscreteCDF {
+ public:
+  DiscreteCDF() = default;
+
+  // Same requirements as for DiscreteDistribution
+  DiscreteCDF(const float *weights, size_t size, bool parallel = false);
+  explicit DiscreteCDF(const std::vector<float> &weights,
+                       bool parallel = false)
+      : DiscreteCDF(weights.data(), weights.size(), parallel) {}
+
+  size_t size() const { return m_cdf.size(); }
+  bool empty() const { return m_cdf.empty(); }
+  double sum() const { return m_sum; }
+
+  float eval_pmf(uint32_t index) const {
+    return index == 0 ? m_cdf[0] : m_cdf[index] - m_cdf[index - 1];
+  }
+
+  // Probability of the entries up to and including `index`
+  float eval_cdf(uint32_t index) const { return m_cdf[index]; }
+
+  // First entry whose CDF exceeds `u`, zero-probability entries are skipped
+  uint32_t sample(float u) const {
+    size_t slots = m_guide.size() - 1;
+    size_t slot = std::min(size_t(u * float(slots)), slots - 1);
+    uint32_t lo = m_guide[slot], hi = m_guide[slot + 1];
+    while (lo < hi) {
+      uint32_t mid = (lo + hi) >> 1;
+      if (m_cdf[mid] > u)
+        hi = mid;
+      else
+        lo = mid + 1;
+    }
+    return std::min(lo, uint32_t(m_cdf.size() - 1));
+  }
+
+  // Entry and its probability
+  std::pair<uint32_t, float> sample_pmf(float u) const {
+    uint32_t index = sample(u);
+    return {index, eval_pmf(index)};
+  }
+
+  // Entry and `u` rescaled to [0, 1) within that entry
+  std::pair<uint32_t, float> sample_reuse(float u) const {
+    uint32_t index = sample(u);
+    float lo = index == 0 ? 0.f : m_cdf[index - 1];
+    return {index, std::min((u - lo) / (m_cdf[index] - lo),
+                            OneMinusEpsilon<float>)};
+  }
+
+  template <size_t N>
+  Array<uint32_t, N> sample(const Array<float, N> &u) const {
+    Array<uint32_t, N> ret;
+    for (size_t i = 0; i < N; ++i) ret.coeff(i) = sample(u.coeff(i));
+    return ret;
+  }
+
+  void sample(const float *u, uint32_t *out, size_t count) const;
+
+ private:
+  std::vector<float> m_cdf;
+  // m_guide[k] is the first entry whose CDF exceeds k / slots
+  std::vector<uint32_t> m_guide;
+  double m_sum = 0.0;
+};
+
+}  // namespace misaki::math
\ No newline at end of file
@@ -0,0 +1,264 @@
+#pragma once
+
+#include <limits>
+#include <utility>
+
+#include "array.hpp"
+
+namespace misaki::math {
+
+// Branch-free approximations of common transcendental functions that
+// work on float/double scalars and on Arrays, where they run on SSE/AVX
+// registers when the array is packet backed. The polynomials are the
+// single precision Cephes ones, so double inputs get float-level accuracy.
+// Max errors for float against libm, asserted by `msk-bench fastmath`:
+//   exp, log, sin, cos 1 ulp; atan2 3 ulp; rsqrt 4 ulp; pow 8 ulp
+// over the domains given for each function. Without packet registers the
+// lanes are evaluated one by one, which is slower than libm. Denormal
+// inputs and outputs are not supported.
+
+namespace detail {
+
+template <typename Scalar>
+struct FloatBits;
+
+template <>
+struct FloatBits<float> {
+  using UInt = uint32_t;
+  static constexpr int MantissaBits = 23;
+  static constexpr UInt ExponentBias = 127;
+  static constexpr UInt MantissaMask = 0x007fffffu;
+  static constexpr UInt Half = 0x3f000000u;  // 0.5f
+  static constexpr float ExpMin = -87.3365478515625f;
+  static constexpr float ExpMax = 88.3762626647949f;
+};
+
+template <>
+struct FloatBits<double> {
+  using UInt = uint64_t;
+  static constexpr int MantissaBits = 52;
+  static constexpr UInt ExponentBias = 1023;
+  static constexpr UInt MantissaMask = 0x000fffffffffffffull;
+  static constexpr UInt Half = 0x3fe0000000000000ull;  // 0.5
+  static constexpr double ExpMin = -708.3964185322641;
+  static constexpr double ExpMax = 709.436139303102;
+};
+
+template <typename Scalar>
+MSK_INLINE Scalar from_bits(typename FloatBits<Scalar>::UInt u) {
+  Scalar s;
+  std::memcpy(&s, &u, sizeof(s));
+  return s;
+}
+
+template <typename Scalar>
+MSK_INLINE typename FloatBits<Scalar>::UInt to_bits(Scalar s) {
+  typename FloatBits<Scalar>::UInt u;
+  std::memcpy(&u, &s, sizeof(s));
+  return u;
+}
+
+// Lane-wise operations on the bit patterns of floating point values
+#define GEN_BITS_OP(name, scalar_expr, packet_expr)                         \
+  template <typename T, typename UInt>                                      \
+  MSK_INLINE T name(const T &a, UInt b) {                                   \
+    using Scalar = scalar_t<T>;                                             \
+    if constexpr (!is_array_v<T>) {                                         \
+      auto u = to_bits<Scalar>(a);                                          \
+      return from_bits<Scalar>(scalar_expr);                                \
+    } else {                                                                \
+      using Packet = typename T::Packet;                                    \
+      T ret;                                                                \
+      if constexpr (Packet::Enabled) {                                      \
+        Packet::store(ret.data(), packet_expr);                             \
+      } else {                                                              \
+        for (size_t i = 0; i < T::Size; ++i)                                \
+          ret.coeff(i) = name(a.coeff(i), b);                               \
+      }                                                                     \
+      return ret;                                                           \
+    }                                                                       \
+  }
+
+GEN_BITS_OP(bits_and, u & b,
+            Packet::and_(Packet::load(a.data()),
+                         Packet::set1(from_bits<Scalar>(b))))
+GEN_BITS_OP(bits_or, u | b,
+            Packet::or_(Packet::load(a.data()),
+                        Packet::set1(from_bits<Scalar>(b))))
+GEN_BITS_OP(bits_sll, decltype(u)(u << b),
+            Packet::sll(Packet::load(a.data()), int(b)))
+GEN_BITS_OP(bits_srl, decltype(u)(u >> b),
+            Packet::srl(Packet::load(a.data()), int(b)))
+#undef GEN_BITS_OP
+
+// 2^n for integral n within the normal exponent range
+template <typename T>
+MSK_INLINE T pow2i(const T &n) {
+  using Scalar = scalar_t<T>;
+  using Bits = FloatBits<Scalar>;
+  // The low mantissa bits of 2^M + bias + n hold the biased exponent
+  const Scalar magic = Scalar(typename Bits::UInt(1) << Bits::MantissaBits) +
+                       Scalar(Bits::ExponentBias);
+  return bits_sll(n + magic, Bits::MantissaBits);
+}
+
+// Split a positive normal value into m * 2^e with m in [0.5, 1)
+template <typename T>
+MSK_INLINE std::pair<T, T> frexp(const T &x) {
+  using Scalar = scalar_t<T>;
+  using Bits = FloatBits<Scalar>;
+  using UInt = typename Bits::UInt;
+  const Scalar two_m = Scalar(UInt(1) << Bits::MantissaBits);
+  T e = bits_or(bits_srl(x, Bits::MantissaBits), to_bits(two_m)) -
+        T(two_m + Scalar(Bits::ExponentBias - 1));
+  T m = bits_or(bits_and(x, Bits::MantissaMask), Bits::Half);
+  return {m, e};
+}
+
+// Horner evaluation, coefficients from the highest degree down
+template <typename T, typename... Ts>
+MSK_INLINE T horner(const T &x, scalar_t<T> c, Ts... cs) {
+  T r(c);
+  ((r = r * x + T(scalar_t<T>(cs))), ...);
+  return r;
+}
+
+}  // namespace detail
+
+// e^x, max error 1 ulp over [-87, 88]. Saturates outside [-87.33, 88.37]
+// (float) or [-708.39, 709.43] (double) instead of returning 0 or inf.
+template <typename T>
+MSK_XPU T fast_exp(const T &x_) {
+  using Scalar = scalar_t<T>;
+  using Bits = detail::FloatBits<Scalar>;
+  T x = clamp(x_, T(Bits::ExpMin), T(Bits::ExpMax));
+  T n = floor(x * Scalar(1.44269504088896341) + Scalar(.5f));
+  x = x - n * Scalar(0.693359375) - n * Scalar(-2.12194440e-4);
+  T y = detail::horner(x, Scalar(1.9875691500e-4), Scalar(1.3981999507e-3),
+                       Scalar(8.3334519073e-3), Scalar(4.1665795894e-2),
+                       Scalar(1.6666665459e-1), Scalar(5.0000001201e-1));
+  y = y * x * x + x + Scalar(1);
+  return y * detail::pow2i(n);
+}
+
+// Natural logarithm, max error 1 ulp for positive normal inputs. Returns
+// -inf for 0 and NaN for negative values.
+template <typename T>
+MSK_XPU T fast_log(const T &x) {
+  using Scalar = scalar_t<T>;
+  auto [m, e] = detail::frexp(x);
+  auto small = m < T(Scalar(0.707106781186547524));
+  e = select(small, e - Scalar(1), e);
+  m = select(small, m + m - Scalar(1), m - Scalar(1));
+  T z = m * m;
+  T y = detail::horner(m, Scalar(7.0376836292e-2), Scalar(-1.1514610310e-1),
+                       Scalar(1.1676998740e-1), Scalar(-1.2420140846e-1),
+                       Scalar(1.4249322787e-1), Scalar(-1.6668057665e-1),
+                       Scalar(2.0000714765e-1), Scalar(-2.4999993993e-1),
+                       Scalar(3.3333331174e-1)) *
+        m * z;
+  y = y + e * Scalar(-2.12194440e-4) - z * Scalar(.5f);
+  T r = m + y + e * Scalar(0.693359375);
+  return select(x > T(Scalar(0)), r,
+                select(x < T(Scalar(0)),
+                       T(std::numeric_limits<Scalar>::quiet_NaN()),
+                       T(-std::numeric_limits<Scalar>::infinity())));
+}
+
+// x^y through exp(y log(x)) for x >= 0. The error grows with |y log(x)|,
+// max 8 ulp for x in [0.1, 10] and y = 2.2.
+template <typename T>
+MSK_XPU T fast_pow(const T &x, const T &y) {
+  using Scalar = scalar_t<T>;
+  return select(x == T(Scalar(0)), T(Scalar(0)), fast_exp(y * fast_log(x)));
+}
+
+// Sine and cosine, max error 1 ulp for |x| <= pi. Up to |x| < 8192 the
+// absolute error stays below 8e-8, beyond that the range reduction loses
+// precision.
+template <typename T>
+MSK_XPU std::pair<T, T> fast_sincos(const T &x) {
+  using Scalar = scalar_t<T>;
+  T ax = abs(x);
+  T j = floor(ax * Scalar(1.27323954473516));
+  // Round j up to even so the reduced argument is within [-pi/4, pi/4]
+  j = j + (j - floor(j * Scalar(.5f)) * Scalar(2));
+  T r = ((ax - j * Scalar(0.78515625)) - j * Scalar(2.4187564849853515625e-4)) -
+        j * Scalar(3.77489497744594108e-8);
+  T octant = j - floor(j * Scalar(.125f)) * Scalar(8);
+
+  T z = r * r;
+  T s = detail::horner(z, Scalar(-1.9515295891e-4), Scalar(8.3321608736e-3),
+                       Scalar(-1.6666654611e-1)) *
+            z * r +
+        r;
+  T c = detail::horner(z, Scalar(2.443315711809948e-5),
+                       Scalar(-1.388731625493765e-3),
+                       Scalar(4.166664568298827e-2)) *
+            z * z -
+        z * Scalar(.5f) + Scalar(1);
+
+  auto swap = (octant == T(Scalar(2))) || (octant == T(Scalar(6)));
+  T sin_r = select(swap, c, s), cos_r = select(swap, s, c);
+  T sin_x = select(octant >= T(Scalar(4)), -sin_r, sin_r);
+  T cos_x = select((octant == T(Scalar(2))) || (octant == T(Scalar(4))),
+                   -cos_r, cos_r);
+  return {select(x < T(Scalar(0)), -sin_x, sin_x), cos_x};
+}
+
+template <typename T>
+MSK_XPU T fast_sin(const T &x) {
+  return fast_sincos(x).first;
+}
+
+template <typename T>
+MSK_XPU T fast_cos(const T &x) {
+  return fast_sincos(x).second;
+}
+
+// Four quadrant arctangent, max error 3 ulp for x, y in [-10, 10].
+// atan2(0, 0) is 0.
+template <typename T>
+MSK_XPU T fast_atan2(const T &y, const T &x) {
+  using Scalar = scalar_t<T>;
+  T ax = abs(x), ay = abs(y);
+  T hi = max(ax, ay), lo = min(ax, ay);
+  T t = select(hi > T(Scalar(0)), lo / hi, T(Scalar(0)));
+  // Reduce t > tan(pi/8) with atan(t) = pi/4 + atan((t - 1) / (t + 1))
+  auto big = t > T(Scalar(0.4142135623730950));
+  T offset = select(big, T(Scalar(0.785398163397448)), T(Scalar(0)));
+  t = select(big, (t - Scalar(1)) / (t + Scalar(1)), t);
+  T z = t * t;
+  T a = detail::horner(z, Scalar(8.05374449538e-2), Scalar(-1.38776856032e-1),
+                       Scalar(1.99777106478e-1), Scalar(-3.33329491539e-1)) *
+            z * t +
+        t + offset;
+  a = select(ay > ax, T(Scalar(1.57079632679490)) - a, a);
+  a = select(x < T(Scalar(0)), T(Scalar(3.14159265358979)) - a, a);
+  return copysign(a, y);
+}
+
+// 1 / sqrt(x). Float uses the hardware estimate refined by one Newton
+// step, max error 4 ulp for positive normal inputs. Double falls back to an exact division.
+template <typename T>
+MSK_XPU T fast_rsqrt(const T &x) {
+  using Scalar = scalar_t<T>;
+  if constexpr (std::is_same_v<Scalar, float>) {
+    if constexpr (is_array_v<T>) {
+      using Packet = typename T::Packet;
+      if constexpr (Packet::Enabled) {
+        T y;
+        Packet::store(y.data(), Packet::rsqrt(Packet::load(x.data())));
+        return y * (Scalar(1.5f) - Scalar(.5f) * x * y * y);
+      }
+    } else {
+#if defined(MSK_X86_SSE42)
+      float y = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x)));
+      return y * (1.5f - .5f * x * y * y);
+#endif
+    }
+  }
+  return Scalar(1) / sqrt(x);
+}
+
+}  // namespace misaki::math
\ No newline at end of file
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <tuple>
+
 #include "../misc/string.h"
 #include "vec2.hpp"
 #include "vec3.hpp"
@@ -10,13 +12,19 @@ template <typename Float>
 struct TFrame {
   using Vector3 = TVector3<Float>;
   using Vector2 = TVector2<Float>;
+  using Scalar = scalar_t<Float>;
 
   Vector3 s, t, n;
 
+  MSK_XPU TFrame() = default;
+
   MSK_XPU TFrame(const Vector3 &v) : n(v) {
-    std::tie(s, t) = coordinate_system<Float>(v);
+    std::tie(s, t) = coordinate_system(v);
   }
 
+  MSK_XPU TFrame(const Vector3 &s, const Vector3 &t, const Vector3 &n)
+      : s(s), t(t), n(n) {}
+
   MSK_XPU Vector3 to_local(const Vector3 &v) const {
     return {dot(v, s), dot(v, t), dot(v, n)};
   }
@@ -34,36 +42,35 @@ struct TFrame {
     return math::sqr(v.x) + math::sqr(v.y);
   }
   MSK_XPU static Float tan_theta(const Vector3 &v) {
-    return math::safe_sqrt(1.f - math::sqr(v.z)) / v.z;
+    return math::safe_sqrt(Scalar(1) - math::sqr(v.z)) / v.z;
   }
   MSK_XPU static Float tan_theta_2(const Vector3 &v) {
-    return std::max(0.f, 1.f - math::sqr(v.z)) / math::sqr(v.z);
+    return max(Float(Scalar(0)), Scalar(1) - math::sqr(v.z)) / math::sqr(v.z);
   }
   MSK_XPU static Float sin_phi(const Vector3 &v) {
     Float sin_theta_2 = TFrame::sin_theta_2(v),
           inv_sin_theta = math::safe_rsqrt(TFrame::sin_theta_2(v));
-    return std::abs(sin_theta_2) <= 4.f * Epsilon<Float>
-               ? 0.f
-               : std::clamp(v.y * inv_sin_theta, -1.f, 1.f);
+    return select(abs(sin_theta_2) <= Float(Scalar(4) * Epsilon<Scalar>),
+                  Float(Scalar(0)),
+                  clamp(v.y * inv_sin_theta, Float(Scalar(-1)), Float(Scalar(1))));
   }
   MSK_XPU static Float cos_phi(const Vector3 &v) {
     Float sin_theta_2 = TFrame::sin_theta_2(v),
           inv_sin_theta = math::safe_rsqrt(TFrame::sin_theta_2(v));
-    return std::abs(sin_theta_2) <= 4.f * Epsilon<Float>
-               ? 1.f
-               : std::clamp(v.x * inv_sin_theta, -1.f, 1.f);
+    return select(abs(sin_theta_2) <= Float(Scalar(4) * Epsilon<Scalar>),
+                  Float(Scalar(1)),
+                  clamp(v.x * inv_sin_theta, Float(Scalar(-1)), Float(Scalar(1))));
   }
   static std::pair<Float, Float> sincos_phi(const Vector3 &v) {
     Float sin_theta_2 = TFrame::sin_theta_2(v),
           inv_sin_theta = math::safe_rsqrt(TFrame::sin_theta_2(v));
+    auto degenerate = abs(sin_theta_2) <= Float(Scalar(4) * Epsilon<Scalar>);
 
-    Vector2 result = {v.x * inv_sin_theta, v.y * inv_sin_theta};
-
-    result = std::abs(sin_theta_2) <= 4.f * Epsilon<Float>
-                 ? Vector2(1.f, 0.f)
-                 : std::clamp(result, -1.f, 1.f);
+    Float cos_phi = clamp(v.x * inv_sin_theta, Float(Scalar(-1)), Float(Scalar(1))),
+          sin_phi = clamp(v.y * inv_sin_theta, Float(Scalar(-1)), Float(Scalar(1)));
 
-    return {result.y, result.x};
+    return {select(degenerate, Float(Scalar(0)), sin_phi),
+            select(degenerate, Float(Scalar(1)), cos_phi)};
   }
 };
 
@@ -80,5 +87,7 @@ std::ostream &operator<<(std::ostream &os, const TFrame<Float> &f) {
 // Type alias
 using Frame3f = TFrame<float>;
 using Frame3d = TFrame<double>;
+using Frame3f4 = TFrame<Packet4f>;
+using Frame3f8 = TFrame<Packet8f>;
 
 }  // namespace misaki::math
\ No newline at end of file
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstring>
+
+#if defined(MSK_X86_F16C)
+#include <immintrin.h>
+#endif
+
+#include "color3.hpp"
+#include "color4.hpp"
+
+namespace misaki::math {
+
+namespace detail {
+// half to float for every bit pattern, used when F16C is not available
+extern const float *half_to_float_table();
+
+// Round to nearest even float to binary16 conversion, after Marat
+// Dukhan's FP16 library. Handles denormals, infinities and NaN.
+inline uint16_t float_to_half_bits(float f) {
+  const float scale_to_inf = 0x1.0p+112f, scale_to_zero = 0x1.0p-110f;
+  float base = (std::abs(f) * scale_to_inf) * scale_to_zero;
+  uint32_t w;
+  std::memcpy(&w, &f, sizeof(w));
+  uint32_t shl1_w = w + w, sign = w & 0x80000000u;
+  uint32_t bias = shl1_w & 0xff000000u;
+  if (bias < 0x71000000u)
+    bias = 0x71000000u;
+  uint32_t bias_bits = (bias >> 1) + 0x07800000u;
+  float bias_value;
+  std::memcpy(&bias_value, &bias_bits, sizeof(bias_value));
+  base = bias_value + base;
+  uint32_t bits;
+  std::memcpy(&bits, &base, sizeof(bits));
+  uint32_t nonsign = ((bits >> 13) & 0x00007c00u) + (bits & 0x00000fffu);
+  return uint16_t((sign >> 16) | (shl1_w > 0xff000000u ? 0x7e00u : nonsign));
+}
+}  // namespace detail
+
+// IEEE 754 binary16 storage type. Arithmetic goes through float, so
+// `half + half` yields a float and results are rounded when stored back.
+class half {
+ public:
+  half() = default;
+  half(float f) { m_bits = from_float(f); }
+
+  operator float() const { return to_float(m_bits); }
+
+  static half from_bits(uint16_t bits) {
+    half h;
+    h.m_bits = bits;
+    return h;
+  }
+  uint16_t bits() const { return m_bits; }
+
+  static uint16_t from_float(float f) {
+#if defined(MSK_X86_F16C)
+    return uint16_t(_cvtss_sh(f, _MM_FROUND_TO_NEAREST_INT));
+#else
+    return detail::float_to_half_bits(f);
+#endif
+  }
+
+  static float to_float(uint16_t bits) {
+#if defined(MSK_X86_F16C)
+    return _cvtsh_ss(bits);
+#else
+    return detail::half_to_float_table()[bits];
+#endif
+  }
+
+ private:
+  uint16_t m_bits = 0;
+};
+
+// Bulk conversions, 8 values per instruction with F16C
+extern void float_to_half(const float *in, half *out, size_t count,
+                          bool parallel = false);
+extern void half_to_float(const half *in, float *out, size_t count,
+                          bool parallel = false);
+
+inline void float_to_half(const TColor3<float> *in, TColor3<half> *out,
+                          size_t count, bool parallel = false) {
+  float_to_half(&in->r, &out->r, count * 3, parallel);
+}
+
+inline void half_to_float(const TColor3<half> *in, TColor3<float> *out,
+                          size_t count, bool parallel = false) {
+  half_to_float(&in->r, &out->r, count * 3, parallel);
+}
+
+inline void float_to_half(const TColor4<float> *in, TColor4<half> *out,
+                          size_t count, bool parallel = false) {
+  float_to_half(&in->r, &out->r, count * 4, parallel);
+}
+
+inline void half_to_float(const TColor4<half> *in, TColor4<float> *out,
+                          size_t count, bool parallel = false) {
+  half_to_float(&in->r, &out->r, count * 4, parallel);
+}
+
+// Type alias
+using Color3h = TColor3<half>;
+using Color4h = TColor4<half>;
+
+}  // namespace misaki::math
\ No newline at end of file
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "../util/check.h"
+#include "common.hpp"
+
+namespace misaki::math {
+
+constexpr uint32_t HaltonMaxDimension = 1024;
+
+// The first HaltonMaxDimension primes, the base of each Halton dimension
+extern const uint32_t *halton_bases();
+
+// Halton sequence over 2^32 indices, optionally scrambled with one random
+// digit permutation per dimension (Kocis and Whiten). The permutation tables
+// take 2 bytes per digit value of each base, ~7 MB for all 1024 dimensions,
+// so only the requested number of dimensions is built.
+class HaltonSampler {
+ public:
+  enum class Scramble { None, Permutation };
+
+  explicit HaltonSampler(uint32_t dimensions = HaltonMaxDimension,
+                         uint32_t seed = 0,
+                         Scramble scramble = Scramble::Permutation);
+
+  uint32_t dimensions() const { return m_dimensions; }
+  Scramble scramble() const { return m_scramble; }
+
+  // Sample in [0, 1)
+  float sample(uint32_t index, uint32_t dim) const {
+    DCHECK_LT(dim, m_dimensions);
+    return to_float(radical_inverse(index, dim));
+  }
+
+  // Samples first, first + 1, ..., first + N - 1 of `dim`
+  template <size_t N>
+  Array<float, N> sample(uint32_t first, uint32_t dim) const {
+    DCHECK_LT(dim, m_dimensions);
+    Array<float, N> ret;
+    for (size_t i = 0; i < N; ++i)
+      ret.coeff(i) = sample(uint32_t(first + i), dim);
+    return ret;
+  }
+
+  // Samples first to first + count - 1 of `dim`. The lowest digits are read
+  // from a table and the remaining ones evaluated once per table period.
+  void sample(uint32_t first, size_t count, uint32_t dim, float *out) const;
+
+ private:
+  const uint16_t *permutation(uint32_t dim) const {
+    return m_permutations.empty() ? nullptr
+                                  : m_permutations.data() + m_offsets[dim];
+  }
+
+  static float to_float(double v) {
+    return std::min(float(v), OneMinusEpsilon<float>);
+  }
+
+  // Digits of `a` mirrored around the radix point. Permuted digits include
+  // the infinite run of permuted leading zeros, summed in closed form.
+  double radical_inverse(uint32_t a, uint32_t dim) const {
+    const uint32_t base = halton_bases()[dim];
+    const uint16_t *perm = permutation(dim);
+    const double inv_base = 1.0 / base;
+    double inv_base_n = 1.0;
+    uint64_t reversed = 0;
+    while (a) {
+      uint32_t next = a / base, digit = a - next * base;
+      reversed = reversed * base + (perm ? perm[digit] : digit);
+      inv_base_n *= inv_base;
+      a = next;
+    }
+    double tail = perm ? perm[0] / (base - 1.0) : 0.0;
+    return inv_base_n * (double(reversed) + tail);
+  }
+
+  uint32_t m_dimensions;
+  Scramble m_scramble;
+  std::vector<uint32_t> m_offsets;
+  std::vector<uint16_t> m_permutations;
+};
+
+}  // namespace misaki::math
\ No newline at end of file
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include "transform4.hpp"
+
+namespace misaki::math {
+
+// Transform whose inverse is only computed the first time it is needed.
+// Composition multiplies the forward matrices only, so chains built during
+// scene construction never pay for inverses nobody reads. Reading the
+// inverse from several threads at once is safe, one of them computes it
+// while the others wait.
+template <typename Value>
+class TLazyTransform4 {
+  using Matrix4 = TMatrix4<Value>;
+  using Vector3 = TVector3<Value>;
+  using Self = TLazyTransform4<Value>;
+
+  enum State : uint8_t { Empty, Busy, Ready };
+
+  Matrix4 m_matrix = Matrix4::identity();
+  mutable Matrix4 m_inverse_matrix = Matrix4::identity();
+  mutable std::atomic<uint8_t> m_state{Ready};
+
+ public:
+  TLazyTransform4() = default;
+  explicit TLazyTransform4(const Matrix4 &m) : m_matrix(m), m_state(Empty) {}
+  TLazyTransform4(const Matrix4 &m, const Matrix4 &inv_m)
+      : m_matrix(m), m_inverse_matrix(inv_m) {}
+  explicit TLazyTransform4(const TTransform4<Value> &t)
+      : m_matrix(t.matrix()), m_inverse_matrix(t.inverse_matrix()) {}
+
+  TLazyTransform4(const Self &other) { *this = other; }
+
+  Self &operator=(const Self &other) {
+    m_matrix = other.m_matrix;
+    if (other.has_inverse()) {
+      m_inverse_matrix = other.m_inverse_matrix;
+      m_state.store(Ready, std::memory_order_release);
+    } else {
+      m_state.store(Empty, std::memory_order_release);
+    }
+    return *this;
+  }
+
+  // Component access
+  const Matrix4 &matrix() const { return m_matrix; }
+  const Matrix4 &inverse_matrix() const {
+    uint8_t state = m_state.load(std::memory_order_acquire);
+    if (state != Ready) {
+      state = Empty;
+      if (m_state.compare_exchange_strong(state, Busy,
+                                          std::memory_order_acquire)) {
+        m_inverse_matrix = m_matrix.inverse();
+        m_state.store(Ready, std::memory_order_release);
+      } else {
+        while (m_state.load(std::memory_order_acquire) != Ready)
+          std::this_thread::yield();
+      }
+    }
+    return m_inverse_matrix;
+  }
+
+  // Whether the inverse has already been computed
+  bool has_inverse() const {
+    return m_state.load(std::memory_order_acquire) == Ready;
+  }
+
+  Self inverse() const { return Self(inverse_matrix(), m_matrix); }
+
+  TTransform4<Value> to_transform4() const {
+    return TTransform4<Value>(m_matrix, inverse_matrix());
+  }
+
+  Vector3 apply_point(const Vector3 &point) const noexcept {
+    using Vector4 = TVector4<Value>;
+    const auto p = m_matrix * Vector4(point.x, point.y, point.z, 1);
+    return Vector3(p.x, p.y, p.z) / p.w;
+  }
+
+  Vector3 apply_vector(const Vector3 &vec) const noexcept {
+    using Vector4 = TVector4<Value>;
+    const auto p = m_matrix * Vector4(vec.x, vec.y, vec.z, 0);
+    return Vector3(p.x, p.y, p.z);
+  }
+
+  Vector3 apply_normal(const Vector3 &normal) const {
+    using Vector4 = TVector4<Value>;
+    const auto p = (inverse_matrix().transpose() *
+                    Vector4(normal.x, normal.y, normal.z, 0));
+    return Vector3(p.x, p.y, p.z).normalize();
+  }
+
+  std::string to_string() const {
+    std::ostringstream os;
+    os << *this;
+    return os.str();
+  }
+};
+
+template <typename Value>
+std::ostream &operator<<(std::ostream &oss, const TLazyTransform4<Value> &t) {
+  oss << "LazyTransform[" << std::endl;
+  oss << "  matrix = " << string::indent(t.matrix().to_string(), 11) << ","
+      << std::endl;
+  oss << "  inverse_matrix = "
+      << string::indent(t.inverse_matrix().to_string(), 19) << "," << std::endl;
+  oss << "]";
+  return oss;
+}
+
+// Only the forward matrices are multiplied, the inverse follows on demand
+template <typename Value>
+TLazyTransform4<Value> operator*(const TLazyTransform4<Value> &lhs,
+                                 const TLazyTransform4<Value> &rhs) {
+  return TLazyTransform4<Value>(lhs.matrix() * rhs.matrix());
+}
+
+// Type alias
+using LazyTransform4f = TLazyTransform4<float>;
+using LazyTransform4d = TLazyTransform4<double>;
+
+}  // namespace misaki::math
\ No newline at end of file
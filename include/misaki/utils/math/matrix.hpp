@@ -1,6 +1,7 @@
 #pragma once
 
 #include "array.hpp"
+#include "array_expr.hpp"
 
 namespace misaki::math {
 
@@ -240,10 +241,10 @@ MSK_XPU auto determinant(const Matrix<Value, 4> &m) {
   Vector vec2(m(1, 2), m(0, 2), m(0, 2), m(0, 2));
   Vector vec3(m(1, 3), m(0, 3), m(0, 3), m(0, 3));
 
-  Vector inv0(vec1 * cofac0 - vec2 * cofac1 + vec3 * cofac2);
-  Vector inv1(vec0 * cofac0 - vec2 * cofac3 + vec3 * cofac4);
-  Vector inv2(vec0 * cofac1 - vec1 * cofac3 + vec3 * cofac5);
-  Vector inv3(vec0 * cofac2 - vec1 * cofac4 + vec2 * cofac5);
+  Vector inv0 = lazy(vec1) * cofac0 - lazy(vec2) * cofac1 + lazy(vec3) * cofac2;
+  Vector inv1 = lazy(vec0) * cofac0 - lazy(vec2) * cofac3 + lazy(vec3) * cofac4;
+  Vector inv2 = lazy(vec0) * cofac1 - lazy(vec1) * cofac3 + lazy(vec3) * cofac5;
+  Vector inv3 = lazy(vec0) * cofac2 - lazy(vec1) * cofac4 + lazy(vec2) * cofac5;
 
   Vector sign_a(+1, -1, +1, -1);
   Vector sign_b(-1, +1, -1, +1);
@@ -340,10 +341,10 @@ MSK_XPU Matrix<Value, 4> inverse(const Matrix<Value, 4> &m) {
   Vector vec2(m(1, 2), m(0, 2), m(0, 2), m(0, 2));
   Vector vec3(m(1, 3), m(0, 3), m(0, 3), m(0, 3));
 
-  Vector inv0(vec1 * cofac0 - vec2 * cofac1 + vec3 * cofac2);
-  Vector inv1(vec0 * cofac0 - vec2 * cofac3 + vec3 * cofac4);
-  Vector inv2(vec0 * cofac1 - vec1 * cofac3 + vec3 * cofac5);
-  Vector inv3(vec0 * cofac2 - vec1 * cofac4 + vec2 * cofac5);
+  Vector inv0 = lazy(vec1) * cofac0 - lazy(vec2) * cofac1 + lazy(vec3) * cofac2;
+  Vector inv1 = lazy(vec0) * cofac0 - lazy(vec2) * cofac3 + lazy(vec3) * cofac4;
+  Vector inv2 = lazy(vec0) * cofac1 - lazy(vec1) * cofac3 + lazy(vec3) * cofac5;
+  Vector inv3 = lazy(vec0) * cofac2 - lazy(vec1) * cofac4 + lazy(vec2) * cofac5;
 
   Vector sign_a(+1, -1, +1, -1);
   Vector sign_b(-1, +1, -1, +1);
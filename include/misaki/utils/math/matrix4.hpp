@@ -1,9 +1,118 @@
 #pragma once
 
+#include "../util/parallel.h"
 #include "vec4.hpp"
 
 namespace misaki::math {
 
+namespace detail {
+
+#if defined(MSK_X86_SSE42)
+// Inverse of a row major float matrix through 2x2 block adjugates, after
+// Eric Zhang's "Fast 4x4 Matrix Inverse with SSE SIMD, Explained"
+#define MSK_SHUFFLE_MASK(x, y, z, w) ((x) | ((y) << 2) | ((z) << 4) | ((w) << 6))
+#define MSK_SWIZZLE(v, x, y, z, w) \
+  _mm_castsi128_ps(                \
+      _mm_shuffle_epi32(_mm_castps_si128(v), MSK_SHUFFLE_MASK(x, y, z, w)))
+#define MSK_SHUFFLE(a, b, x, y, z, w) \
+  _mm_shuffle_ps(a, b, MSK_SHUFFLE_MASK(x, y, z, w))
+
+// 2x2 row major products A B, adj(A) B and A adj(B)
+MSK_INLINE __m128 mat2_mul(__m128 a, __m128 b) {
+  return _mm_add_ps(_mm_mul_ps(a, MSK_SWIZZLE(b, 0, 3, 0, 3)),
+                    _mm_mul_ps(MSK_SWIZZLE(a, 1, 0, 3, 2),
+                               MSK_SWIZZLE(b, 2, 1, 2, 1)));
+}
+MSK_INLINE __m128 mat2_adj_mul(__m128 a, __m128 b) {
+  return _mm_sub_ps(_mm_mul_ps(MSK_SWIZZLE(a, 3, 3, 0, 0), b),
+                    _mm_mul_ps(MSK_SWIZZLE(a, 1, 1, 2, 2),
+                               MSK_SWIZZLE(b, 2, 3, 0, 1)));
+}
+MSK_INLINE __m128 mat2_mul_adj(__m128 a, __m128 b) {
+  return _mm_sub_ps(_mm_mul_ps(a, MSK_SWIZZLE(b, 3, 0, 3, 0)),
+                    _mm_mul_ps(MSK_SWIZZLE(a, 1, 0, 3, 2),
+                               MSK_SWIZZLE(b, 2, 1, 2, 1)));
+}
+
+MSK_INLINE void matrix4_inverse(const float *in, float *out) {
+  __m128 r0 = _mm_loadu_ps(in), r1 = _mm_loadu_ps(in + 4),
+         r2 = _mm_loadu_ps(in + 8), r3 = _mm_loadu_ps(in + 12);
+  __m128 a = _mm_movelh_ps(r0, r1), b = _mm_movehl_ps(r1, r0),
+         c = _mm_movelh_ps(r2, r3), d = _mm_movehl_ps(r3, r2);
+
+  // (|A|, |B|, |C|, |D|)
+  __m128 det_sub =
+      _mm_sub_ps(_mm_mul_ps(MSK_SHUFFLE(r0, r2, 0, 2, 0, 2),
+                            MSK_SHUFFLE(r1, r3, 1, 3, 1, 3)),
+                 _mm_mul_ps(MSK_SHUFFLE(r0, r2, 1, 3, 1, 3),
+                            MSK_SHUFFLE(r1, r3, 0, 2, 0, 2)));
+  __m128 det_a = MSK_SWIZZLE(det_sub, 0, 0, 0, 0),
+         det_b = MSK_SWIZZLE(det_sub, 1, 1, 1, 1),
+         det_c = MSK_SWIZZLE(det_sub, 2, 2, 2, 2),
+         det_d = MSK_SWIZZLE(det_sub, 3, 3, 3, 3);
+
+  __m128 d_c = mat2_adj_mul(d, c), a_b = mat2_adj_mul(a, b);
+  __m128 x = _mm_sub_ps(_mm_mul_ps(det_d, a), mat2_mul(b, d_c));
+  __m128 w = _mm_sub_ps(_mm_mul_ps(det_a, d), mat2_mul(c, a_b));
+  __m128 y = _mm_sub_ps(_mm_mul_ps(det_b, c), mat2_mul_adj(d, a_b));
+  __m128 z = _mm_sub_ps(_mm_mul_ps(det_c, b), mat2_mul_adj(a, d_c));
+
+  // |M| = |A| |D| + |B| |C| - tr(adj(A) B adj(D) C)
+  __m128 tr = _mm_mul_ps(a_b, MSK_SWIZZLE(d_c, 0, 2, 1, 3));
+  tr = _mm_hadd_ps(tr, tr);
+  tr = _mm_hadd_ps(tr, tr);
+  __m128 det = _mm_sub_ps(
+      _mm_add_ps(_mm_mul_ps(det_a, det_d), _mm_mul_ps(det_b, det_c)), tr);
+  __m128 rcp_det = _mm_div_ps(_mm_setr_ps(1.f, -1.f, -1.f, 1.f), det);
+  x = _mm_mul_ps(x, rcp_det);
+  y = _mm_mul_ps(y, rcp_det);
+  z = _mm_mul_ps(z, rcp_det);
+  w = _mm_mul_ps(w, rcp_det);
+
+  _mm_storeu_ps(out, MSK_SHUFFLE(x, y, 3, 1, 3, 1));
+  _mm_storeu_ps(out + 4, MSK_SHUFFLE(x, y, 2, 0, 2, 0));
+  _mm_storeu_ps(out + 8, MSK_SHUFFLE(z, w, 3, 1, 3, 1));
+  _mm_storeu_ps(out + 12, MSK_SHUFFLE(z, w, 2, 0, 2, 0));
+}
+
+#undef MSK_SHUFFLE
+#undef MSK_SWIZZLE
+#undef MSK_SHUFFLE_MASK
+#endif
+
+// Inverse of row major 4x4 matrices stored as 16 separate entries. T is a
+// scalar, or an Array holding the same entry of several matrices.
+template <typename T>
+MSK_XPU void matrix4_inverse_soa(const T *m, T *out) {
+  T s0 = m[0] * m[5] - m[4] * m[1], s1 = m[0] * m[6] - m[4] * m[2],
+    s2 = m[0] * m[7] - m[4] * m[3], s3 = m[1] * m[6] - m[5] * m[2],
+    s4 = m[1] * m[7] - m[5] * m[3], s5 = m[2] * m[7] - m[6] * m[3];
+  T c0 = m[8] * m[13] - m[12] * m[9], c1 = m[8] * m[14] - m[12] * m[10],
+    c2 = m[8] * m[15] - m[12] * m[11], c3 = m[9] * m[14] - m[13] * m[10],
+    c4 = m[9] * m[15] - m[13] * m[11], c5 = m[10] * m[15] - m[14] * m[11];
+  T inv_det =
+      T(1) / (s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0);
+
+  out[0] = (m[5] * c5 - m[6] * c4 + m[7] * c3) * inv_det;
+  out[1] = (m[2] * c4 - m[1] * c5 - m[3] * c3) * inv_det;
+  out[2] = (m[13] * s5 - m[14] * s4 + m[15] * s3) * inv_det;
+  out[3] = (m[10] * s4 - m[9] * s5 - m[11] * s3) * inv_det;
+  out[4] = (m[6] * c2 - m[4] * c5 - m[7] * c1) * inv_det;
+  out[5] = (m[0] * c5 - m[2] * c2 + m[3] * c1) * inv_det;
+  out[6] = (m[14] * s2 - m[12] * s5 - m[15] * s1) * inv_det;
+  out[7] = (m[8] * s5 - m[10] * s2 + m[11] * s1) * inv_det;
+  out[8] = (m[4] * c4 - m[5] * c2 + m[7] * c0) * inv_det;
+  out[9] = (m[1] * c2 - m[0] * c4 - m[3] * c0) * inv_det;
+  out[10] = (m[12] * s4 - m[13] * s2 + m[15] * s0) * inv_det;
+  out[11] = (m[9] * s2 - m[8] * s4 - m[11] * s0) * inv_det;
+  out[12] = (m[5] * c1 - m[4] * c3 - m[6] * c0) * inv_det;
+  out[13] = (m[0] * c3 - m[1] * c1 + m[2] * c0) * inv_det;
+  out[14] = (m[13] * s1 - m[12] * s3 - m[14] * s0) * inv_det;
+  out[15] = (m[8] * s3 - m[9] * s1 + m[10] * s0) * inv_det;
+}
+
+}  // namespace detail
+
 // Row major matrix
 template <typename Value>
 struct TMatrix4 {
@@ -209,108 +318,117 @@ struct TMatrix4 {
   }
 
   MSK_XPU Self inverse() const noexcept {
-    // This function is adopted from GLM
-    /*
-    ================================================================================
-    OpenGL Mathematics (GLM)
-    --------------------------------------------------------------------------------
-    GLM is licensed under The Happy Bunny License and MIT License
-    ================================================================================
-    The Happy Bunny License (Modified MIT License)
-    --------------------------------------------------------------------------------
-    Copyright (c) 2005 - 2014 G-Truc Creation
-    Permission is hereby granted, free of charge, to any person obtaining a copy
-    of this software and associated documentation files (the "Software"), to deal
-    in the Software without restriction, including without limitation the rights
-    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
-    copies of the Software, and to permit persons to whom the Software is
-    furnished to do so, subject to the following conditions:
-    The above copyright notice and this permission notice shall be included in
-    all copies or substantial portions of the Software.
-    Restrictions:
-    By making use of the Software for military purposes, you choose to make a
-    Bunny unhappy.
-    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
-    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
-    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
-    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
-    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
-    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
-    THE SOFTWARE.
-    ================================================================================
-    The MIT License
-    --------------------------------------------------------------------------------
-    Copyright (c) 2005 - 2014 G-Truc Creation
-    Permission is hereby granted, free of charge, to any person obtaining a copy
-    of this software and associated documentation files (the "Software"), to deal
-    in the Software without restriction, including without limitation the rights
-    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
-    copies of the Software, and to permit persons to whom the Software is
-    furnished to do so, subject to the following conditions:
-    The above copyright notice and this permission notice shall be included in
-    all copies or substantial portions of the Software.
-    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
-    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
-    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
-    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
-    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
-    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
-    THE SOFTWARE.
-    */
-    Value coef00 = data[2][2] * data[3][3] - data[3][2] * data[2][3];
-    Value coef02 = data[1][2] * data[3][3] - data[3][2] * data[1][3];
-    Value coef03 = data[1][2] * data[2][3] - data[2][2] * data[1][3];
-
-    Value coef04 = data[2][1] * data[3][3] - data[3][1] * data[2][3];
-    Value coef06 = data[1][1] * data[3][3] - data[3][1] * data[1][3];
-    Value coef07 = data[1][1] * data[2][3] - data[2][1] * data[1][3];
-
-    Value coef08 = data[2][1] * data[3][2] - data[3][1] * data[2][2];
-    Value coef10 = data[1][1] * data[3][2] - data[3][1] * data[1][2];
-    Value coef11 = data[1][1] * data[2][2] - data[2][1] * data[1][2];
-
-    Value coef12 = data[2][0] * data[3][3] - data[3][0] * data[2][3];
-    Value coef14 = data[1][0] * data[3][3] - data[3][0] * data[1][3];
-    Value coef15 = data[1][0] * data[2][3] - data[2][0] * data[1][3];
-
-    Value coef16 = data[2][0] * data[3][2] - data[3][0] * data[2][2];
-    Value coef18 = data[1][0] * data[3][2] - data[3][0] * data[1][2];
-    Value coef19 = data[1][0] * data[2][2] - data[2][0] * data[1][2];
-
-    Value coef20 = data[2][0] * data[3][1] - data[3][0] * data[2][1];
-    Value coef22 = data[1][0] * data[3][1] - data[3][0] * data[1][1];
-    Value coef23 = data[1][0] * data[2][1] - data[2][0] * data[1][1];
-
-    using Vector = TVector4<Value>;
-
-    Vector cofac0(coef00, coef00, coef02, coef03);
-    Vector cofac1(coef04, coef04, coef06, coef07);
-    Vector cofac2(coef08, coef08, coef10, coef11);
-    Vector cofac3(coef12, coef12, coef14, coef15);
-    Vector cofac4(coef16, coef16, coef18, coef19);
-    Vector cofac5(coef20, coef20, coef22, coef23);
-
-    Vector vec0(data[1][0], data[0][0], data[0][0], data[0][0]);
-    Vector vec1(data[1][1], data[0][1], data[0][1], data[0][1]);
-    Vector vec2(data[1][2], data[0][2], data[0][2], data[0][2]);
-    Vector vec3(data[1][3], data[0][3], data[0][3], data[0][3]);
-
-    Vector inv0(vec1 * cofac0 - vec2 * cofac1 + vec3 * cofac2);
-    Vector inv1(vec0 * cofac0 - vec2 * cofac3 + vec3 * cofac4);
-    Vector inv2(vec0 * cofac1 - vec1 * cofac3 + vec3 * cofac5);
-    Vector inv3(vec0 * cofac2 - vec1 * cofac4 + vec2 * cofac5);
-
-    Vector sign_a(+1, -1, +1, -1);
-    Vector sign_b(-1, +1, -1, +1);
-    Self inversed(inv0 * sign_a, inv1 * sign_b, inv2 * sign_a,
-                  inv3 * sign_b);
-
-    Vector row0(inversed[0][0], inversed[1][0], inversed[2][0], inversed[3][0]);
-
-    Vector dot0(data[0] * row0);
-    Value dot1 = (dot0.x + dot0.y) + (dot0.z + dot0.w);
-    Value one_over_det = static_cast<Value>(1) / dot1;
-    return inversed * one_over_det;
+#if defined(MSK_X86_SSE42)
+    if constexpr (std::is_same_v<Value, float>) {
+      Self ret;
+      detail::matrix4_inverse(&data[0].x, &ret.data[0].x);
+      return ret;
+    } else
+#endif
+    {
+      // This function is adopted from GLM
+      /*
+      ================================================================================
+      OpenGL Mathematics (GLM)
+      --------------------------------------------------------------------------------
+      GLM is licensed under The Happy Bunny License and MIT License
+      ================================================================================
+      The Happy Bunny License (Modified MIT License)
+      --------------------------------------------------------------------------------
+      Copyright (c) 2005 - 2014 G-Truc Creation
+      Permission is hereby granted, free of charge, to any person obtaining a copy
+      of this software and associated documentation files (the "Software"), to deal
+      in the Software without restriction, including without limitation the rights
+      to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+      copies of the Software, and to permit persons to whom the Software is
+      furnished to do so, subject to the following conditions:
+      The above copyright notice and this permission notice shall be included in
+      all copies or substantial portions of the Software.
+      Restrictions:
+      By making use of the Software for military purposes, you choose to make a
+      Bunny unhappy.
+      THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+      IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+      FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+      AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+      LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+      OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+      THE SOFTWARE.
+      ================================================================================
+      The MIT License
+      --------------------------------------------------------------------------------
+      Copyright (c) 2005 - 2014 G-Truc Creation
+      Permission is hereby granted, free of charge, to any person obtaining a copy
+      of this software and associated documentation files (the "Software"), to deal
+      in the Software without restriction, including without limitation the rights
+      to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+      copies of the Software, and to permit persons to whom the Software is
+      furnished to do so, subject to the following conditions:
+      The above copyright notice and this permission notice shall be included in
+      all copies or substantial portions of the Software.
+      THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+      IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+      FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+      AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+      LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+      OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+      THE SOFTWARE.
+      */
+      Value coef00 = data[2][2] * data[3][3] - data[3][2] * data[2][3];
+      Value coef02 = data[1][2] * data[3][3] - data[3][2] * data[1][3];
+      Value coef03 = data[1][2] * data[2][3] - data[2][2] * data[1][3];
+
+      Value coef04 = data[2][1] * data[3][3] - data[3][1] * data[2][3];
+      Value coef06 = data[1][1] * data[3][3] - data[3][1] * data[1][3];
+      Value coef07 = data[1][1] * data[2][3] - data[2][1] * data[1][3];
+
+      Value coef08 = data[2][1] * data[3][2] - data[3][1] * data[2][2];
+      Value coef10 = data[1][1] * data[3][2] - data[3][1] * data[1][2];
+      Value coef11 = data[1][1] * data[2][2] - data[2][1] * data[1][2];
+
+      Value coef12 = data[2][0] * data[3][3] - data[3][0] * data[2][3];
+      Value coef14 = data[1][0] * data[3][3] - data[3][0] * data[1][3];
+      Value coef15 = data[1][0] * data[2][3] - data[2][0] * data[1][3];
+
+      Value coef16 = data[2][0] * data[3][2] - data[3][0] * data[2][2];
+      Value coef18 = data[1][0] * data[3][2] - data[3][0] * data[1][2];
+      Value coef19 = data[1][0] * data[2][2] - data[2][0] * data[1][2];
+
+      Value coef20 = data[2][0] * data[3][1] - data[3][0] * data[2][1];
+      Value coef22 = data[1][0] * data[3][1] - data[3][0] * data[1][1];
+      Value coef23 = data[1][0] * data[2][1] - data[2][0] * data[1][1];
+
+      using Vector = TVector4<Value>;
+
+      Vector cofac0(coef00, coef00, coef02, coef03);
+      Vector cofac1(coef04, coef04, coef06, coef07);
+      Vector cofac2(coef08, coef08, coef10, coef11);
+      Vector cofac3(coef12, coef12, coef14, coef15);
+      Vector cofac4(coef16, coef16, coef18, coef19);
+      Vector cofac5(coef20, coef20, coef22, coef23);
+
+      Vector vec0(data[1][0], data[0][0], data[0][0], data[0][0]);
+      Vector vec1(data[1][1], data[0][1], data[0][1], data[0][1]);
+      Vector vec2(data[1][2], data[0][2], data[0][2], data[0][2]);
+      Vector vec3(data[1][3], data[0][3], data[0][3], data[0][3]);
+
+      Vector inv0(vec1 * cofac0 - vec2 * cofac1 + vec3 * cofac2);
+      Vector inv1(vec0 * cofac0 - vec2 * cofac3 + vec3 * cofac4);
+      Vector inv2(vec0 * cofac1 - vec1 * cofac3 + vec3 * cofac5);
+      Vector inv3(vec0 * cofac2 - vec1 * cofac4 + vec2 * cofac5);
+
+      Vector sign_a(+1, -1, +1, -1);
+      Vector sign_b(-1, +1, -1, +1);
+      Self inversed(inv0 * sign_a, inv1 * sign_b, inv2 * sign_a,
+                    inv3 * sign_b);
+
+      Vector row0(inversed[0][0], inversed[1][0], inversed[2][0], inversed[3][0]);
+
+      Vector dot0(data[0] * row0);
+      Value dot1 = (dot0.x + dot0.y) + (dot0.z + dot0.w);
+      Value one_over_det = static_cast<Value>(1) / dot1;
+      return inversed * one_over_det;
+    }
   }
 
   MSK_XPU Self transpose() const noexcept {
@@ -366,10 +484,24 @@ MSK_XPU TMatrix4<Value> operator-(const TMatrix4<Value> &lhs, const TMatrix4<Val
 template <typename Value>
 MSK_XPU TMatrix4<Value> operator*(const TMatrix4<Value> &lhs, const TMatrix4<Value> &rhs) noexcept {
   TMatrix4<Value> ret;
-  for (int r = 0; r < 4; ++r) {
-    for (int c = 0; c < 4; ++c) {
-      ret(r, c) = dot(lhs.row(r), rhs.col(c));
+  using Packet = detail::Packet<Value, 4>;
+  if constexpr (Packet::Enabled) {
+    // Each result row is a combination of the rows of rhs
+    auto b0 = Packet::loadu(&rhs[0].x), b1 = Packet::loadu(&rhs[1].x),
+         b2 = Packet::loadu(&rhs[2].x), b3 = Packet::loadu(&rhs[3].x);
+    for (int r = 0; r < 4; ++r) {
+      auto row = Packet::add(
+          Packet::add(Packet::mul(Packet::set1(lhs(r, 0)), b0),
+                      Packet::mul(Packet::set1(lhs(r, 1)), b1)),
+          Packet::add(Packet::mul(Packet::set1(lhs(r, 2)), b2),
+                      Packet::mul(Packet::set1(lhs(r, 3)), b3)));
+      Packet::storeu(&ret[r].x, row);
     }
+  } else {
+    for (int r = 0; r < 4; ++r)
+      for (int c = 0; c < 4; ++c)
+        ret(r, c) = lhs(r, 0) * rhs(0, c) + lhs(r, 1) * rhs(1, c) +
+                    lhs(r, 2) * rhs(2, c) + lhs(r, 3) * rhs(3, c);
   }
   return ret;
 }
@@ -421,6 +553,44 @@ std::ostream &operator<<(
   return oss;
 }
 
+// Invert `count` matrices. Groups of native register width are transposed
+// into structure-of-arrays form and inverted together, the rest one by one.
+template <typename Value>
+void batch_inverse(const TMatrix4<Value> *in, TMatrix4<Value> *out,
+                   size_t count, bool parallel = false) {
+  auto run = [&](size_t begin, size_t end) {
+    constexpr size_t Width = detail::native_width_v<Value>;
+    size_t i = begin;
+    if constexpr (Width > 1) {
+      using Lanes = Array<Value, Width>;
+      Lanes m[16], inv[16];
+      size_t simd_end = begin + (end - begin) / Width * Width;
+      for (; i < simd_end; i += Width) {
+        const Value *src = &in[i][0].x;
+        for (size_t e = 0; e < 16; ++e)
+          Lanes::Packet::store(m[e].data(), Lanes::Packet::gather(src + e, 16));
+        detail::matrix4_inverse_soa(m, inv);
+        // Lane l of inv[4 r .. 4 r + 3] is row r of matrix l
+        using Row = detail::Packet<Value, 4>;
+        for (size_t l = 0; l < Width; ++l) {
+          Value *dst = &out[i + l][0].x;
+          if constexpr (Row::Enabled) {
+            for (size_t r = 0; r < 4; ++r)
+              Row::storeu(dst + 4 * r, Row::gather(inv[4 * r].data() + l, Width));
+          } else {
+            for (size_t e = 0; e < 16; ++e) dst[e] = inv[e].coeff(l);
+          }
+        }
+      }
+    }
+    for (; i < end; ++i) out[i] = in[i].inverse();
+  };
+  if (parallel)
+    util::parallel_for(0, count, 4096, run);
+  else
+    run(0, count);
+}
+
 // Type alias
 using Matrix4f = TMatrix4<float>;
 using Matrix4d = TMatrix4<double>;
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "fastmath.hpp"
+#include "frame.hpp"
+#include "vec4.hpp"
+
+namespace misaki::math {
+
+// Compact unit vector storage through the octahedral mapping: the sphere is
+// projected onto the octahedron |x| + |y| + |z| = 1 and the lower half is
+// folded over the upper one, giving a square in [-1, 1]^2 that is quantized
+// with snorm steps (the axes are exactly representable). Max angular errors,
+// measured over 10^7 random directions and checked by `msk-bench octahedral`:
+//   oct32 (2 x 16 bits, rounded)            0.0037 deg
+//   oct16 (2 x 8 bits, best of 4 neighbors) 0.64 deg
+//   frame32                                 normal 0.08 deg, tangent 0.36 deg
+
+// Map a unit vector to the octahedral square
+template <typename Float>
+MSK_XPU TVector2<Float> oct_encode(const TVector3<Float> &v) {
+  using Scalar = scalar_t<Float>;
+  Float inv = Scalar(1) / (abs(v.x) + abs(v.y) + abs(v.z));
+  Float px = v.x * inv, py = v.y * inv;
+  Float fx = (Scalar(1) - abs(py)) * copysign(Float(Scalar(1)), px),
+        fy = (Scalar(1) - abs(px)) * copysign(Float(Scalar(1)), py);
+  auto lower = v.z < Float(Scalar(0));
+  return {select(lower, fx, px), select(lower, fy, py)};
+}
+
+// Unit vector for a point of the octahedral square
+template <typename Float>
+MSK_XPU TVector3<Float> oct_decode(const TVector2<Float> &p) {
+  using Scalar = scalar_t<Float>;
+  Float z = Scalar(1) - abs(p.x) - abs(p.y);
+  Float t = max(-z, Float(Scalar(0)));
+  TVector3<Float> v(p.x - copysign(t, p.x), p.y - copysign(t, p.y), z);
+  return v * (Float(Scalar(1)) / v.norm());
+}
+
+namespace detail {
+
+// Biased snorm codes in [0, 2 * (2^(Bits - 1) - 1)], carried as floats so the
+// same code runs on scalars and on packets
+template <int Bits, typename Float>
+MSK_XPU Float snorm_quantize(const Float &v) {
+  using Scalar = scalar_t<Float>;
+  constexpr Scalar Steps = Scalar((1 << (Bits - 1)) - 1);
+  return floor(clamp(v, Float(Scalar(-1)), Float(Scalar(1))) * Steps + Steps +
+               Scalar(.5f));
+}
+
+template <int Bits, typename Float>
+MSK_XPU Float snorm_dequantize(const Float &q) {
+  using Scalar = scalar_t<Float>;
+  constexpr Scalar Steps = Scalar((1 << (Bits - 1)) - 1);
+  return (q - Steps) * (Scalar(1) / Steps);
+}
+
+template <int Bits, typename Float>
+MSK_XPU TVector3<Float> oct_dequantize(const TVector2<Float> &q) {
+  return oct_decode(TVector2<Float>(snorm_dequantize<Bits>(q.x),
+                                    snorm_dequantize<Bits>(q.y)));
+}
+
+// Octahedral codes of `v`. With `Precise` the four codes around the exact
+// position are decoded and the one closest to `v` is kept, which matters for
+// low bit counts where rounding each coordinate separately is far from
+// optimal.
+template <int Bits, bool Precise, typename Float>
+MSK_XPU TVector2<Float> oct_quantize(const TVector3<Float> &v) {
+  using Scalar = scalar_t<Float>;
+  TVector2<Float> p = oct_encode(v);
+  if constexpr (!Precise) {
+    return {snorm_quantize<Bits>(p.x), snorm_quantize<Bits>(p.y)};
+  } else {
+    constexpr Scalar Steps = Scalar((1 << (Bits - 1)) - 1);
+    Float bx = floor((p.x + Scalar(1)) * Steps),
+          by = floor((p.y + Scalar(1)) * Steps);
+    TVector2<Float> best(bx, by);
+    Float best_dist(Scalar(8));
+    for (int i = 0; i < 4; ++i) {
+      TVector2<Float> q(min(bx + Scalar(i & 1), Float(Steps * 2)),
+                        min(by + Scalar(i >> 1), Float(Steps * 2)));
+      // Distances keep their precision where cosines would all round to 1
+      Float dist = (oct_dequantize<Bits>(q) - v).squared_norm();
+      auto better = dist < best_dist;
+      best = {select(better, q.x, best.x), select(better, q.y, best.y)};
+      best_dist = select(better, dist, best_dist);
+    }
+    return best;
+  }
+}
+
+// Layout of the 32-bit frame encoding, from the low bits up: 11 + 11 bits
+// octahedral normal, 9 bits tangent angle, 1 bit handedness
+constexpr int FrameNormalBits = 11;
+constexpr int FrameAngleBits = 9;
+
+// Quantized frame as float codes {u, v, angle, flipped}. The tangent angle is
+// measured in the coordinate_system() basis of the *decoded* normal, so the
+// decoder sees exactly the same reference as the encoder even where that basis
+// jumps (n.z changing sign).
+template <typename Float>
+MSK_XPU TVector4<Float> frame_quantize(const TFrame<Float> &f) {
+  using Scalar = scalar_t<Float>;
+  constexpr Scalar Angles = Scalar(1 << FrameAngleBits);
+  TVector2<Float> q = oct_quantize<FrameNormalBits, true>(f.n);
+  auto [s0, t0] = coordinate_system(oct_dequantize<FrameNormalBits>(q));
+  Float a = fast_atan2(dot(f.s, t0), dot(f.s, s0)) *
+            Scalar(Angles / (2 * Pi<double>));
+  a = floor(a + Scalar(.5f));
+  a = select(a < Float(Scalar(0)), a + Angles, a);
+  a = select(a >= Float(Angles), a - Angles, a);
+  Float flip = select(dot(cross(f.n, f.s), f.t) < Float(Scalar(0)),
+                      Float(Scalar(1)), Float(Scalar(0)));
+  return {q.x, q.y, a, flip};
+}
+
+template <typename Float>
+MSK_XPU TFrame<Float> frame_dequantize(const TVector4<Float> &q) {
+  using Scalar = scalar_t<Float>;
+  constexpr Scalar Angles = Scalar(1 << FrameAngleBits);
+  TVector3<Float> n =
+      oct_dequantize<FrameNormalBits>(TVector2<Float>(q.x, q.y));
+  auto [s0, t0] = coordinate_system(n);
+  auto [sin_a, cos_a] = fast_sincos(q.z * Scalar(2 * Pi<double> / Angles));
+  TVector3<Float> s = cos_a * s0 + sin_a * t0;
+  TVector3<Float> t = cross(n, s) * (Scalar(1) - q.w * Scalar(2));
+  return TFrame<Float>(s, t, n);
+}
+
+}  // namespace detail
+
+// 32-bit encoding, 16 bits per coordinate
+MSK_XPU inline uint32_t oct32_encode(const TVector3<float> &v) {
+  TVector2<float> q = detail::oct_quantize<16, false>(v);
+  return uint32_t(q.x) | uint32_t(q.y) << 16;
+}
+
+MSK_XPU inline TVector3<float> oct32_decode(uint32_t code) {
+  return detail::oct_dequantize<16>(
+      TVector2<float>(float(code & 0xffffu), float(code >> 16)));
+}
+
+// 16-bit encoding, 8 bits per coordinate
+MSK_XPU inline uint16_t oct16_encode(const TVector3<float> &v) {
+  TVector2<float> q = detail::oct_quantize<8, true>(v);
+  return uint16_t(uint32_t(q.x) | uint32_t(q.y) << 8);
+}
+
+MSK_XPU inline TVector3<float> oct16_decode(uint16_t code) {
+  return detail::oct_dequantize<8>(
+      TVector2<float>(float(code & 0xffu), float(code >> 8)));
+}
+
+// 32-bit encoding of an orthonormal frame. The bitangent is rebuilt as
+// +-cross(n, s), so mirrored (left-handed) tangent frames survive the round
+// trip.
+MSK_XPU inline uint32_t frame32_encode(const TFrame<float> &f) {
+  TVector4<float> q = detail::frame_quantize(f);
+  return uint32_t(q.x) | uint32_t(q.y) << detail::FrameNormalBits |
+         uint32_t(q.z) << (2 * detail::FrameNormalBits) |
+         uint32_t(q.w) << 31;
+}
+
+MSK_XPU inline TFrame<float> frame32_decode(uint32_t code) {
+  constexpr uint32_t NormalMask = (1u << detail::FrameNormalBits) - 1,
+                     AngleMask = (1u << detail::FrameAngleBits) - 1;
+  return detail::frame_dequantize(TVector4<float>(
+      float(code & NormalMask),
+      float((code >> detail::FrameNormalBits) & NormalMask),
+      float((code >> (2 * detail::FrameNormalBits)) & AngleMask),
+      float(code >> 31)));
+}
+
+// Batch versions over arrays, evaluated a register at a time. With `parallel`
+// large arrays are split across the thread pool.
+extern void oct32_encode(const TVector3<float> *in, uint32_t *out,
+                         size_t count, bool parallel = false);
+extern void oct32_decode(const uint32_t *in, TVector3<float> *out,
+                         size_t count, bool parallel = false);
+extern void oct16_encode(const TVector3<float> *in, uint16_t *out,
+                         size_t count, bool parallel = false);
+extern void oct16_decode(const uint16_t *in, TVector3<float> *out,
+                         size_t count, bool parallel = false);
+extern void frame32_encode(const TFrame<float> *in, uint32_t *out,
+                           size_t count, bool parallel = false);
+extern void frame32_decode(const uint32_t *in, TFrame<float> *out,
+                           size_t count, bool parallel = false);
+
+}  // namespace misaki::math
\ No newline at end of file
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "matrix3.hpp"
+
+namespace misaki::math {
+
+// Rotation quaternion, (x, y, z) is the imaginary part and w the real one
+template <typename Value>
+struct TQuaternion {
+  using Vector3 = TVector3<Value>;
+  using Matrix3 = TMatrix3<Value>;
+  using Self = TQuaternion<Value>;
+
+  Value x = 0, y = 0, z = 0, w = 1;
+
+  MSK_XPU constexpr TQuaternion() noexcept = default;
+  MSK_XPU constexpr TQuaternion(Value x, Value y, Value z, Value w) noexcept
+      : x(x), y(y), z(z), w(w) {}
+  MSK_XPU constexpr TQuaternion(const Vector3 &v, Value w) noexcept
+      : x(v.x), y(v.y), z(v.z), w(w) {}
+
+  // Rotation of `angle` degrees around `axis`
+  MSK_XPU static Self from_axis_angle(const Vector3 &axis, Value angle) {
+    Value half = deg_to_rag(angle) * Value(.5f);
+    return Self(axis.normalize() * std::sin(half), std::cos(half));
+  }
+
+  // Quaternion of a rotation matrix (Shepperd's method)
+  MSK_XPU static Self from_matrix(const Matrix3 &m) {
+    Value trace = m(0, 0) + m(1, 1) + m(2, 2);
+    if (trace > 0) {
+      Value s = std::sqrt(trace + 1), inv = Value(.5f) / s;
+      return Self((m(2, 1) - m(1, 2)) * inv, (m(0, 2) - m(2, 0)) * inv,
+                  (m(1, 0) - m(0, 1)) * inv, s * Value(.5f));
+    }
+    size_t i = 0;
+    if (m(1, 1) > m(0, 0)) i = 1;
+    if (m(2, 2) > m(i, i)) i = 2;
+    size_t j = (i + 1) % 3, k = (i + 2) % 3;
+    Value s = std::sqrt(m(i, i) - m(j, j) - m(k, k) + 1), inv = Value(.5f) / s;
+    Value q[3];
+    q[i] = s * Value(.5f);
+    q[j] = (m(j, i) + m(i, j)) * inv;
+    q[k] = (m(k, i) + m(i, k)) * inv;
+    return Self(q[0], q[1], q[2], (m(k, j) - m(j, k)) * inv);
+  }
+
+  MSK_XPU Vector3 imag() const noexcept { return Vector3(x, y, z); }
+
+  MSK_XPU auto squared_norm() const noexcept {
+    return x * x + y * y + z * z + w * w;
+  }
+  MSK_XPU auto norm() const noexcept { return std::sqrt(squared_norm()); }
+  MSK_XPU Self normalize() const noexcept {
+    Value inv = 1 / norm();
+    return Self(x * inv, y * inv, z * inv, w * inv);
+  }
+  MSK_XPU Self conjugate() const noexcept { return Self(-x, -y, -z, w); }
+
+  MSK_XPU Matrix3 to_matrix() const noexcept {
+    Value xx = x * x, yy = y * y, zz = z * z, xy = x * y, xz = x * z,
+          yz = y * z, wx = w * x, wy = w * y, wz = w * z;
+    return Matrix3(1 - 2 * (yy + zz), 2 * (xy - wz), 2 * (xz + wy),
+                   2 * (xy + wz), 1 - 2 * (xx + zz), 2 * (yz - wx),
+                   2 * (xz - wy), 2 * (yz + wx), 1 - 2 * (xx + yy));
+  }
+
+  // Rotate a vector by a unit quaternion
+  MSK_XPU Vector3 rotate(const Vector3 &v) const noexcept {
+    Vector3 u = imag(), t = cross(u, v) * Value(2);
+    return v + t * w + cross(u, t);
+  }
+
+  std::string to_string() const {
+    std::ostringstream os;
+    os << *this;
+    return os.str();
+  }
+};
+
+template <typename Value>
+MSK_XPU TQuaternion<Value> operator*(const TQuaternion<Value> &a,
+                                     const TQuaternion<Value> &b) noexcept {
+  return TQuaternion<Value>(a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+                            a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+                            a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+                            a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z);
+}
+
+template <typename Value>
+MSK_XPU auto dot(const TQuaternion<Value> &a,
+                 const TQuaternion<Value> &b) noexcept {
+  return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+}
+
+// Normalized linear interpolation along the shorter arc. Cheaper than slerp
+// but not constant speed.
+template <typename Value>
+MSK_XPU TQuaternion<Value> nlerp(const TQuaternion<Value> &a,
+                                 const TQuaternion<Value> &b, Value t) {
+  Value s = dot(a, b) < 0 ? -t : t, r = 1 - t;
+  return TQuaternion<Value>(r * a.x + s * b.x, r * a.y + s * b.y,
+                            r * a.z + s * b.z, r * a.w + s * b.w)
+      .normalize();
+}
+
+// Constant speed spherical interpolation along the shorter arc
+template <typename Value>
+MSK_XPU TQuaternion<Value> slerp(const TQuaternion<Value> &a,
+                                 const TQuaternion<Value> &b, Value t) {
+  Value cos_theta = dot(a, b), sign = 1;
+  if (cos_theta < 0) {
+    cos_theta = -cos_theta;
+    sign = -1;
+  }
+  // Nearly parallel, fall back to nlerp to avoid dividing by sin(theta) ~ 0
+  if (cos_theta > Value(0.9995f))
+    return nlerp(a, b, t);
+  Value theta = std::acos(cos_theta), inv_sin = 1 / std::sin(theta);
+  Value wa = std::sin((1 - t) * theta) * inv_sin,
+        wb = sign * std::sin(t * theta) * inv_sin;
+  return TQuaternion<Value>(wa * a.x + wb * b.x, wa * a.y + wb * b.y,
+                            wa * a.z + wb * b.z, wa * a.w + wb * b.w);
+}
+
+template <typename Value>
+std::ostream &operator<<(std::ostream &oss, const TQuaternion<Value> &q) {
+  oss << "[" << q.x << ", " << q.y << ", " << q.z << ", " << q.w << "]";
+  return oss;
+}
+
+// Type alias
+using Quaternionf = TQuaternion<float>;
+using Quaterniond = TQuaternion<double>;
+
+}  // namespace misaki::math
\ No newline at end of file
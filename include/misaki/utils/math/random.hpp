@@ -2,6 +2,10 @@
 
 #include <stdint.h>
 
+#include <algorithm>
+#include <array>
+#include <cstring>
+
 #include "common.hpp"
 
 namespace misaki::math {
@@ -10,6 +14,151 @@ namespace misaki::math {
 #define PCG32_DEFAULT_STREAM 0xda3e39cb94b95bdbULL
 #define PCG32_MULT 0x5851f42d4c957f2dULL
 
+namespace detail {
+
+// Affine map state -> mult * state + plus equal to `delta` steps of the
+// stream `inc`, by repeated squaring (Brown, "Random Number Generation with
+// Arbitrary Stride"). Negative strides wrap around the 2^64 period.
+MSK_XPU inline void pcg32_jump(uint64_t delta, uint64_t inc, uint64_t *mult,
+                               uint64_t *plus) {
+  uint64_t cur_mult = PCG32_MULT, cur_plus = inc, acc_mult = 1u, acc_plus = 0u;
+  while (delta > 0) {
+    if (delta & 1) {
+      acc_mult *= cur_mult;
+      acc_plus = acc_plus * cur_mult + cur_plus;
+    }
+    cur_plus = (cur_mult + 1) * cur_plus;
+    cur_mult *= cur_mult;
+    delta >>= 1;
+  }
+  *mult = acc_mult;
+  *plus = acc_plus;
+}
+
+// Number of steps from `from` to `to` along the stream `inc`, found one bit
+// at a time from the lowest
+MSK_XPU inline uint64_t pcg32_distance(uint64_t from, uint64_t to,
+                                       uint64_t inc) {
+  uint64_t cur_mult = PCG32_MULT, cur_plus = inc, bit = 1u, distance = 0u;
+  while (from != to) {
+    if ((from & bit) != (to & bit)) {
+      from = from * cur_mult + cur_plus;
+      distance |= bit;
+    }
+    bit <<= 1;
+    cur_plus = (cur_mult + 1) * cur_plus;
+    cur_mult *= cur_mult;
+  }
+  return distance;
+}
+
+MSK_XPU inline uint32_t pcg32_output(uint64_t state) {
+  uint32_t xorshifted = (uint32_t)(((state >> 18u) ^ state) >> 27u);
+  uint32_t rot = (uint32_t)(state >> 59u);
+  return (xorshifted >> rot) | (xorshifted << ((~rot + 1u) & 31));
+}
+
+// Same values as the MTGP [1, 2) - 1 trick used by PCG32, as a plain integer
+// conversion that vectorizes
+MSK_XPU inline float u32_to_float32(uint32_t u) {
+  return float(int32_t(u >> 9)) * (1.f / 8388608.f);
+}
+
+MSK_XPU inline double u64_to_float64(uint64_t u) {
+  return double(int64_t(u >> 12)) * (1.0 / 4503599627370496.0);
+}
+
+#if defined(MSK_X86_AVX2)
+MSK_INLINE __m256i mul_epi64(__m256i a, __m256i b) {
+  __m256i lo = _mm256_mul_epu32(a, b),
+          cross = _mm256_add_epi64(
+              _mm256_mul_epu32(_mm256_srli_epi64(a, 32), b),
+              _mm256_mul_epu32(a, _mm256_srli_epi64(b, 32)));
+  return _mm256_add_epi64(lo, _mm256_slli_epi64(cross, 32));
+}
+
+// PCG32 output of eight states (two registers) as eight 32-bit words
+MSK_INLINE __m256i pcg32_output(__m256i s0, __m256i s1) {
+  const __m256i even = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+  auto low_words = [&](__m256i v) {
+    return _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(v, even));
+  };
+  auto xorshifted = [](__m256i s) {
+    return _mm256_srli_epi64(_mm256_xor_si256(_mm256_srli_epi64(s, 18), s),
+                             27);
+  };
+  __m256i x = _mm256_inserti128_si256(
+      _mm256_castsi128_si256(low_words(xorshifted(s0))),
+      low_words(xorshifted(s1)), 1);
+  __m256i rot = _mm256_inserti128_si256(
+      _mm256_castsi128_si256(low_words(_mm256_srli_epi64(s0, 59))),
+      low_words(_mm256_srli_epi64(s1, 59)), 1);
+  __m256i left = _mm256_and_si256(
+      _mm256_sub_epi32(_mm256_setzero_si256(), rot), _mm256_set1_epi32(31));
+  return _mm256_or_si256(_mm256_srlv_epi32(x, rot), _mm256_sllv_epi32(x, left));
+}
+
+// Output `count` (a multiple of 16) steps of 16 interleaved sub-streams that
+// each jump 16 steps at a time through (mult, plus)
+template <typename T, typename Convert>
+inline void pcg32_fill_avx2(uint64_t *s, uint64_t mult, uint64_t plus, T *out,
+                            size_t count, Convert convert) {
+  __m256i st[4];
+  for (int k = 0; k < 4; ++k)
+    st[k] = _mm256_load_si256((const __m256i *)(s + 4 * k));
+  const __m256i m = _mm256_set1_epi64x(int64_t(mult)),
+                p = _mm256_set1_epi64x(int64_t(plus));
+  for (size_t i = 0; i < count; i += 16) {
+    convert.store(out + i, pcg32_output(st[0], st[1]));
+    convert.store(out + i + 8, pcg32_output(st[2], st[3]));
+    for (int k = 0; k < 4; ++k)
+      st[k] = _mm256_add_epi64(mul_epi64(st[k], m), p);
+  }
+  for (int k = 0; k < 4; ++k) _mm256_store_si256((__m256i *)(s + 4 * k), st[k]);
+}
+#endif
+
+// Output conversions of PCG32::fill(), for one word and for eight
+struct PCG32ToUInt32 {
+  MSK_XPU uint32_t operator()(uint32_t u) const { return u; }
+#if defined(MSK_X86_AVX2)
+  void store(uint32_t *out, __m256i u) const {
+    _mm256_storeu_si256((__m256i *)out, u);
+  }
+#endif
+};
+
+struct PCG32ToFloat32 {
+  MSK_XPU float operator()(uint32_t u) const { return u32_to_float32(u); }
+#if defined(MSK_X86_AVX2)
+  void store(float *out, __m256i u) const {
+    __m256 f = _mm256_castsi256_ps(_mm256_or_si256(
+        _mm256_srli_epi32(u, 9), _mm256_set1_epi32(0x3f800000)));
+    _mm256_storeu_ps(out, _mm256_sub_ps(f, _mm256_set1_ps(1.f)));
+  }
+#endif
+};
+
+struct PCG32ToFloat64 {
+  MSK_XPU double operator()(uint32_t u) const {
+    return u64_to_float64(uint64_t(u) << 32);
+  }
+#if defined(MSK_X86_AVX2)
+  void store(double *out, __m256i u) const {
+    __m128i half[2] = {_mm256_castsi256_si128(u),
+                       _mm256_extracti128_si256(u, 1)};
+    for (int h = 0; h < 2; ++h) {
+      __m256d d = _mm256_castsi256_pd(
+          _mm256_or_si256(_mm256_slli_epi64(_mm256_cvtepu32_epi64(half[h]), 20),
+                          _mm256_set1_epi64x(0x3ff0000000000000ll)));
+      _mm256_storeu_pd(out + 4 * h, _mm256_sub_pd(d, _mm256_set1_pd(1.0)));
+    }
+  }
+#endif
+};
+
+}  // namespace detail
+
 struct PCG32 {
   MSK_XPU PCG32() : state(PCG32_DEFAULT_STATE), inc(PCG32_DEFAULT_STREAM) {}
   MSK_XPU PCG32(uint64_t initstate, uint64_t initseq = 1u) { seed(initstate, initseq); }
@@ -24,9 +173,7 @@ struct PCG32 {
   MSK_XPU uint32_t next_uint32() {
     uint64_t oldstate = state;
     state = oldstate * PCG32_MULT + inc;
-    uint32_t xorshifted = (uint32_t)(((oldstate >> 18u) ^ oldstate) >> 27u);
-    uint32_t rot = (uint32_t)(oldstate >> 59u);
-    return (xorshifted >> rot) | (xorshifted << ((~rot + 1u) & 31));
+    return detail::pcg32_output(oldstate);
   }
 
   MSK_XPU float next_float32() {
@@ -51,11 +198,418 @@ struct PCG32 {
     return x.d - 1.0;
   }
 
+  // Uniform integer in [0, bound) without modulo bias (Lemire, "Fast Random
+  // Integer Generation in an Interval"). A bound of 0 gives 0.
+  MSK_XPU uint32_t next_uint32(uint32_t bound) {
+    uint64_t m = uint64_t(next_uint32()) * bound;
+    if (uint32_t(m) < bound) {  // never taken for bound 0
+      uint32_t threshold = (0u - bound) % bound;
+      while (uint32_t(m) < threshold) m = uint64_t(next_uint32()) * bound;
+    }
+    return uint32_t(m >> 32);
+  }
+
+  // Bulk versions of next_uint32(), next_float32() and next_float64(). The
+  // output and final state are the same as for a serial loop, but LaneCount
+  // interleaved sub-streams each jump LaneCount steps at a time so the
+  // per-lane work vectorizes.
+  void fill_uint32(uint32_t *out, size_t count) {
+    fill(out, count, detail::PCG32ToUInt32());
+  }
+
+  void fill_float32(float *out, size_t count) {
+    fill(out, count, detail::PCG32ToFloat32());
+  }
+
+  void fill_float64(double *out, size_t count) {
+    fill(out, count, detail::PCG32ToFloat64());
+  }
+
+  // Uniform integers in [0, bound). Rejected draws are replaced from the
+  // serial stream, so the output still only depends on the state and count.
+  // A bound of 0 gives zeros and advances the state by count.
+  void fill_uint32(uint32_t *out, size_t count, uint32_t bound) {
+    uint32_t threshold = bound == 0 ? 0u : (0u - bound) % bound;
+    fill_uint32(out, count);
+    for (size_t i = 0; i < count; ++i) {
+      uint64_t m = uint64_t(out[i]) * bound;
+      while (uint32_t(m) < threshold) m = uint64_t(next_uint32()) * bound;
+      out[i] = uint32_t(m >> 32);
+    }
+  }
+
+  // Fisher-Yates shuffle of a random access range
+  template <typename Iterator>
+  void shuffle(Iterator begin, Iterator end) {
+    if (end - begin < 2)
+      return;
+    for (Iterator it = end - 1; it > begin; --it)
+      std::iter_swap(it, begin + next_uint32(uint32_t(it - begin + 1)));
+  }
+
+  // Move `delta` steps forward (or backward when negative) in O(log delta)
+  MSK_XPU void advance(int64_t delta) {
+    uint64_t mult, plus;
+    detail::pcg32_jump(uint64_t(delta), inc, &mult, &plus);
+    state = mult * state + plus;
+  }
+
+  // Number of steps from `other` to this generator. Both must use the same
+  // stream.
+  MSK_XPU int64_t operator-(const PCG32 &other) const {
+    return int64_t(detail::pcg32_distance(other.state, state, inc));
+  }
+
   bool operator==(const PCG32 &other) const { return state == other.state && inc == other.inc; }
   bool operator!=(const PCG32 &other) const { return state != other.state || inc != other.inc; }
 
   uint64_t state;  // RNG state.  All values are possible.
   uint64_t inc;    // Controls which RNG sequence (stream) is selected. Must *always* be odd.
+
+ private:
+  static constexpr size_t LaneCount = 16;
+
+  // Serial-equivalent output of `count` steps from LaneCount sub-streams
+  template <typename T, typename Convert>
+  void fill(T *out, size_t count, Convert convert) {
+    size_t i = 0;
+    if (count >= LaneCount) {
+      alignas(32) uint64_t s[LaneCount];
+      uint64_t mult, plus;
+      detail::pcg32_jump(LaneCount, inc, &mult, &plus);
+      s[0] = state;
+      for (size_t k = 1; k < LaneCount; ++k)
+        s[k] = s[k - 1] * PCG32_MULT + inc;
+      size_t simd_end = count - count % LaneCount;
+#if defined(MSK_X86_AVX2)
+      detail::pcg32_fill_avx2(s, mult, plus, out, simd_end, convert);
+      i = simd_end;
+#else
+      for (; i < simd_end; i += LaneCount) {
+        for (size_t k = 0; k < LaneCount; ++k) {
+          out[i + k] = convert(detail::pcg32_output(s[k]));
+          s[k] = s[k] * mult + plus;
+        }
+      }
+#endif
+      state = s[0];
+    }
+    for (; i < count; ++i) out[i] = convert(next_uint32());
+  }
+};
+
+// N independent PCG32 generators stepped together, one per lane. The lane
+// loops have no cross-lane dependencies and compile to SIMD code.
+template <size_t N>
+struct PCG32x {
+  using UInt32 = Array<uint32_t, N>;
+  using Float32 = Array<float, N>;
+  using Float64 = Array<double, N>;
+  using Int64 = Array<int64_t, N>;
+
+  // Lane i uses the default state on stream PCG32_DEFAULT_STREAM + 2i
+  MSK_XPU PCG32x() {
+    for (size_t i = 0; i < N; ++i) {
+      state[i] = PCG32_DEFAULT_STATE;
+      inc[i] = PCG32_DEFAULT_STREAM + 2 * i;
+    }
+  }
+
+  // Lane i is seeded like PCG32(initstate, initseq + i)
+  MSK_XPU PCG32x(uint64_t initstate, uint64_t initseq = 1u) {
+    seed(initstate, initseq);
+  }
+
+  // Lane i starts at `rng` advanced by offset + i * stride, so blocks of
+  // samples or pixels can jump straight into one shared stream
+  MSK_XPU PCG32x(const PCG32 &rng, uint64_t offset, uint64_t stride = 1) {
+    uint64_t mult, plus, s = rng.state;
+    detail::pcg32_jump(offset, rng.inc, &mult, &plus);
+    s = mult * s + plus;
+    detail::pcg32_jump(stride, rng.inc, &mult, &plus);
+    for (size_t i = 0; i < N; ++i) {
+      state[i] = s;
+      inc[i] = rng.inc;
+      s = mult * s + plus;
+    }
+  }
+
+  MSK_XPU void seed(uint64_t initstate, uint64_t initseq = 1) {
+    for (size_t i = 0; i < N; ++i) {
+      PCG32 rng(initstate, initseq + i);
+      state[i] = rng.state;
+      inc[i] = rng.inc;
+    }
+  }
+
+  MSK_XPU UInt32 next_uint32() {
+    UInt32 ret;
+    for (size_t i = 0; i < N; ++i) {
+      uint64_t oldstate = state[i];
+      state[i] = oldstate * PCG32_MULT + inc[i];
+      ret.coeff(i) = detail::pcg32_output(oldstate);
+    }
+    return ret;
+  }
+
+  MSK_XPU Float32 next_float32() {
+    UInt32 u = next_uint32();
+    Float32 ret;
+    for (size_t i = 0; i < N; ++i) {
+      uint32_t bits = (u.coeff(i) >> 9) | 0x3f800000u;
+      std::memcpy(&ret.coeff(i), &bits, sizeof(float));
+    }
+    return ret - 1.f;
+  }
+
+  MSK_XPU Float64 next_float64() {
+    UInt32 u = next_uint32();
+    Float64 ret;
+    for (size_t i = 0; i < N; ++i) {
+      uint64_t bits = ((uint64_t)u.coeff(i) << 20) | 0x3ff0000000000000ULL;
+      std::memcpy(&ret.coeff(i), &bits, sizeof(double));
+    }
+    return ret - 1.0;
+  }
+
+  // Advance every lane by `delta` steps in O(log delta)
+  MSK_XPU void advance(int64_t delta) {
+    uint64_t mult = 1u, plus = 0u;
+    for (size_t i = 0; i < N; ++i) {
+      if (i == 0 || inc[i] != inc[i - 1])
+        detail::pcg32_jump(uint64_t(delta), inc[i], &mult, &plus);
+      state[i] = mult * state[i] + plus;
+    }
+  }
+
+  // Per-lane number of steps from `other`, lanes must use the same streams
+  MSK_XPU Int64 operator-(const PCG32x &other) const {
+    Int64 ret;
+    for (size_t i = 0; i < N; ++i)
+      ret.coeff(i) =
+          int64_t(detail::pcg32_distance(other.state[i], state[i], inc[i]));
+    return ret;
+  }
+
+  // The generator of lane i as a scalar PCG32
+  MSK_XPU PCG32 lane(size_t i) const {
+    PCG32 rng;
+    rng.state = state[i];
+    rng.inc = inc[i];
+    return rng;
+  }
+
+  bool operator==(const PCG32x &other) const {
+    for (size_t i = 0; i < N; ++i)
+      if (state[i] != other.state[i] || inc[i] != other.inc[i])
+        return false;
+    return true;
+  }
+  bool operator!=(const PCG32x &other) const { return !(*this == other); }
+
+  alignas(64) uint64_t state[N];
+  alignas(64) uint64_t inc[N];
+};
+
+// Type alias
+using PCG32x4 = PCG32x<4>;
+using PCG32x8 = PCG32x<8>;
+
+// Counter-based generators: pure functions of a key and a counter, so any
+// task can regenerate its numbers from (seed, pixel, sample, dimension)
+// without carrying state around. Packet overloads evaluate each lane
+// independently and compile to SIMD code.
+
+// Tiny Encryption Algorithm as a hash of two words (Zafar et al., "GPU
+// Random Numbers via the Tiny Encryption Algorithm"). Four rounds are
+// enough to decorrelate neighboring inputs such as (pixel, sample) for
+// seeding; use more for direct sampling.
+MSK_XPU inline uint64_t sample_tea_64(uint32_t v0, uint32_t v1,
+                                      int rounds = 4) {
+  uint32_t sum = 0;
+  for (int i = 0; i < rounds; ++i) {
+    sum += 0x9e3779b9u;
+    v0 += ((v1 << 4) + 0xa341316cu) ^ (v1 + sum) ^ ((v1 >> 5) + 0xc8013ea4u);
+    v1 += ((v0 << 4) + 0xad90777du) ^ (v0 + sum) ^ ((v0 >> 5) + 0x7e95761eu);
+  }
+  return uint64_t(v0) | uint64_t(v1) << 32;
+}
+
+MSK_XPU inline uint32_t sample_tea_32(uint32_t v0, uint32_t v1,
+                                      int rounds = 4) {
+  return uint32_t(sample_tea_64(v0, v1, rounds));
+}
+
+MSK_XPU inline float sample_tea_float32(uint32_t v0, uint32_t v1,
+                                        int rounds = 4) {
+  return detail::u32_to_float32(sample_tea_32(v0, v1, rounds));
+}
+
+MSK_XPU inline double sample_tea_float64(uint32_t v0, uint32_t v1,
+                                         int rounds = 4) {
+  return detail::u64_to_float64(sample_tea_64(v0, v1, rounds));
+}
+
+template <size_t N>
+MSK_XPU Array<float, N> sample_tea_float32(const Array<uint32_t, N> &v0,
+                                           const Array<uint32_t, N> &v1,
+                                           int rounds = 4) {
+  Array<float, N> ret;
+  for (size_t i = 0; i < N; ++i)
+    ret.coeff(i) = sample_tea_float32(v0.coeff(i), v1.coeff(i), rounds);
+  return ret;
+}
+
+// PCG32 seeded from a hash of two indices, e.g. (pixel, sample)
+MSK_XPU inline PCG32 seeded_pcg32(uint32_t v0, uint32_t v1) {
+  return PCG32(sample_tea_64(v0, v1), sample_tea_64(v1, v0));
+}
+
+// Philox4x32-10 (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2,
+// 3"): four random words per 128-bit counter under a 64-bit key
+MSK_XPU inline std::array<uint32_t, 4> philox4x32(
+    std::array<uint32_t, 4> ctr, std::array<uint32_t, 2> key) {
+  for (int i = 0; i < 10; ++i) {
+    uint64_t p0 = uint64_t(0xd2511f53u) * ctr[0],
+             p1 = uint64_t(0xcd9e8d57u) * ctr[2];
+    ctr = {uint32_t(p1 >> 32) ^ ctr[1] ^ key[0], uint32_t(p1),
+           uint32_t(p0 >> 32) ^ ctr[3] ^ key[1], uint32_t(p0)};
+    key[0] += 0x9e3779b9u;
+    key[1] += 0xbb67ae85u;
+  }
+  return ctr;
+}
+
+// Philox4x32-10 on N counters at once, each round runs across all lanes
+template <size_t N>
+MSK_XPU std::array<Array<uint32_t, N>, 4> philox4x32(
+    const std::array<Array<uint32_t, N>, 4> &ctr,
+    std::array<uint32_t, 2> key) {
+  // Plain arrays so that the lane loop vectorizes
+  uint32_t c0[N], c1[N], c2[N], c3[N];
+  for (size_t i = 0; i < N; ++i) {
+    c0[i] = ctr[0].coeff(i);
+    c1[i] = ctr[1].coeff(i);
+    c2[i] = ctr[2].coeff(i);
+    c3[i] = ctr[3].coeff(i);
+  }
+  for (int r = 0; r < 10; ++r) {
+    for (size_t i = 0; i < N; ++i) {
+      uint64_t p0 = uint64_t(0xd2511f53u) * c0[i],
+               p1 = uint64_t(0xcd9e8d57u) * c2[i];
+      c0[i] = uint32_t(p1 >> 32) ^ c1[i] ^ key[0];
+      c1[i] = uint32_t(p1);
+      c2[i] = uint32_t(p0 >> 32) ^ c3[i] ^ key[1];
+      c3[i] = uint32_t(p0);
+    }
+    key[0] += 0x9e3779b9u;
+    key[1] += 0xbb67ae85u;
+  }
+  std::array<Array<uint32_t, N>, 4> ret;
+  for (size_t i = 0; i < N; ++i) {
+    ret[0].coeff(i) = c0[i];
+    ret[1].coeff(i) = c1[i];
+    ret[2].coeff(i) = c2[i];
+    ret[3].coeff(i) = c3[i];
+  }
+  return ret;
+}
+
+// Squares (Widynski, "Squares: A Fast Counter-Based RNG"): one 32-bit word
+// per 64-bit counter from four rounds of squaring. Keys should have
+// irregular bit patterns, e.g. squares_key(seed).
+MSK_XPU inline uint32_t squares32(uint64_t ctr, uint64_t key) {
+  uint64_t x = ctr * key, y = x, z = y + key;
+  x = x * x + y;
+  x = (x >> 32) | (x << 32);
+  x = x * x + z;
+  x = (x >> 32) | (x << 32);
+  x = x * x + y;
+  x = (x >> 32) | (x << 32);
+  return uint32_t((x * x + z) >> 32);
+}
+
+MSK_XPU inline uint64_t squares_key(uint64_t seed) {
+  return sample_tea_64(uint32_t(seed), uint32_t(seed >> 32), 8) | 1u;
+}
+
+// Stateless generator keyed by a seed. 32-bit dimensions are grouped by
+// four, each group costing one Philox evaluation of the counter (pixel,
+// sample, dimension / 4, 0). 64-bit dimensions come in pairs from the
+// counters (pixel, sample, dimension / 2, 1), so they never share words
+// with the 32-bit ones.
+struct CounterRNG {
+  MSK_XPU explicit CounterRNG(uint64_t seed = 0)
+      : key{uint32_t(seed), uint32_t(seed >> 32)} {}
+
+  // Dimensions 4 * group to 4 * group + 3 at once
+  MSK_XPU std::array<uint32_t, 4> sample_uint32x4(uint32_t pixel,
+                                                  uint32_t sample,
+                                                  uint32_t group) const {
+    return philox4x32({pixel, sample, group, 0u}, key);
+  }
+
+  MSK_XPU uint32_t sample_uint32(uint32_t pixel, uint32_t sample,
+                                 uint32_t dimension) const {
+    return sample_uint32x4(pixel, sample, dimension >> 2)[dimension & 3];
+  }
+
+  MSK_XPU float sample_float32(uint32_t pixel, uint32_t sample,
+                               uint32_t dimension) const {
+    return detail::u32_to_float32(sample_uint32(pixel, sample, dimension));
+  }
+
+  MSK_XPU double sample_float64(uint32_t pixel, uint32_t sample,
+                                uint32_t dimension) const {
+    std::array<uint32_t, 4> w =
+        philox4x32({pixel, sample, dimension >> 1, 1u}, key);
+    size_t i = (dimension & 1) * 2;
+    return detail::u64_to_float64(uint64_t(w[i]) | uint64_t(w[i + 1]) << 32);
+  }
+
+  template <size_t N>
+  MSK_XPU std::array<Array<uint32_t, N>, 4> sample_uint32x4(
+      const Array<uint32_t, N> &pixel, const Array<uint32_t, N> &sample,
+      uint32_t group) const {
+    return philox4x32<N>({pixel, sample, Array<uint32_t, N>(group),
+                          Array<uint32_t, N>(0u)},
+                         key);
+  }
+
+  template <size_t N>
+  MSK_XPU Array<uint32_t, N> sample_uint32(const Array<uint32_t, N> &pixel,
+                                           const Array<uint32_t, N> &sample,
+                                           uint32_t dimension) const {
+    return sample_uint32x4(pixel, sample, dimension >> 2)[dimension & 3];
+  }
+
+  template <size_t N>
+  MSK_XPU Array<float, N> sample_float32(const Array<uint32_t, N> &pixel,
+                                         const Array<uint32_t, N> &sample,
+                                         uint32_t dimension) const {
+    Array<uint32_t, N> u = sample_uint32(pixel, sample, dimension);
+    Array<float, N> ret;
+    for (size_t i = 0; i < N; ++i)
+      ret.coeff(i) = detail::u32_to_float32(u.coeff(i));
+    return ret;
+  }
+
+  template <size_t N>
+  MSK_XPU Array<double, N> sample_float64(const Array<uint32_t, N> &pixel,
+                                          const Array<uint32_t, N> &sample,
+                                          uint32_t dimension) const {
+    auto w = philox4x32<N>({pixel, sample, Array<uint32_t, N>(dimension >> 1),
+                            Array<uint32_t, N>(1u)},
+                           key);
+    size_t k = (dimension & 1) * 2;
+    Array<double, N> ret;
+    for (size_t i = 0; i < N; ++i)
+      ret.coeff(i) = detail::u64_to_float64(uint64_t(w[k].coeff(i)) |
+                                            uint64_t(w[k + 1].coeff(i)) << 32);
+    return ret;
+  }
+
+  std::array<uint32_t, 2> key;
 };
 
 }  // namespace misaki::math
\ No newline at end of file
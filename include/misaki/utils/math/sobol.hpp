@@ -0,0 +1,177 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "../util/check.h"
+#include "random.hpp"
+
+namespace misaki::math {
+
+// Dimensions of the built-in Sobol generator matrices
+constexpr uint32_t SobolMaxDimension = 1024;
+
+// Sobol generator matrices for 32-bit indices: bit j of the index toggles
+// column matrix(dim)[j]. The built-in table is derived from the Joe-Kuo
+// direction numbers once, on first use. A table can also be written to a
+// binary file and memory-mapped back, sharing one copy between processes.
+// Files are in host byte order, a host of the other order rejects them.
+class SobolTable {
+ public:
+  SobolTable();
+
+  // Map a file produced by write(). Throws std::runtime_error when the file
+  // is missing or malformed.
+  explicit SobolTable(const std::string &filename);
+
+  void write(const std::string &filename) const;
+
+  uint32_t dimensions() const { return m_dimensions; }
+  const uint32_t *matrix(uint32_t dim) const {
+    DCHECK_LT(dim, m_dimensions);
+    return m_data + size_t(dim) * 32;
+  }
+
+ private:
+  std::shared_ptr<const void> m_owner;
+  const uint32_t *m_data;
+  uint32_t m_dimensions;
+};
+
+namespace detail {
+
+MSK_XPU inline uint32_t reverse_bits(uint32_t x) {
+  x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+  x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+  x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+  x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+  return (x >> 16) | (x << 16);
+}
+
+// Hashes where each bit only depends on the bits below it, so applied to
+// bit-reversed values they permute every elementary interval like a nested
+// uniform (Owen) scramble. The first is from Laine and Karras, "Stratified
+// sampling for stochastic transparency", the second is Vegdahl's improved
+// constant set for Burley, "Practical Hash-based Owen Scrambling".
+MSK_XPU inline uint32_t laine_karras_permutation(uint32_t x, uint32_t seed) {
+  x += seed;
+  x ^= x * 0x6c50b47cu;
+  x ^= x * 0xb82f1e52u;
+  x ^= x * 0xc7afe638u;
+  x ^= x * 0x8d22f6e6u;
+  return x;
+}
+
+MSK_XPU inline uint32_t owen_permutation(uint32_t x, uint32_t seed) {
+  x ^= x * 0x3d20adeau;
+  x += seed;
+  x *= (seed >> 16) | 1u;
+  x ^= x * 0x05526c56u;
+  x ^= x * 0x53a22864u;
+  return x;
+}
+
+MSK_XPU inline float uint32_to_unit_float(uint32_t v) {
+  return float(int32_t(v >> 8)) * (1.f / 16777216.f);
+}
+
+}  // namespace detail
+
+// Sobol sequence over 2^32 indices in up to table.dimensions() dimensions,
+// optionally scrambled with a per-dimension seed
+class SobolSampler {
+ public:
+  enum class Scramble { None, LaineKarras, Owen };
+
+  explicit SobolSampler(uint32_t seed = 0, Scramble scramble = Scramble::Owen,
+                        const SobolTable &table = SobolTable());
+
+  uint32_t dimensions() const { return m_table.dimensions(); }
+  uint32_t seed() const { return m_seed; }
+  Scramble scramble() const { return m_scramble; }
+
+  // 32-bit fixed point sample of `dim`
+  uint32_t sample_uint32(uint32_t index, uint32_t dim) const {
+    const uint32_t *m = m_table.matrix(dim);
+    uint32_t v = 0;
+    for (; index; index >>= 1, ++m) v ^= *m & (0u - (index & 1u));
+    return apply_scramble(v, dim_seed(dim));
+  }
+
+  // Sample in [0, 1)
+  float sample(uint32_t index, uint32_t dim) const {
+    return detail::uint32_to_unit_float(sample_uint32(index, dim));
+  }
+
+  // Samples first, first + 1, ..., first + N - 1 of `dim`
+  template <size_t N>
+  Array<float, N> sample(uint32_t first, uint32_t dim) const {
+    const uint32_t *m = m_table.matrix(dim);
+    uint32_t v[N] = {};
+    for (int j = 0; j < 32; ++j)
+      for (size_t i = 0; i < N; ++i)
+        v[i] ^= m[j] & (0u - ((uint32_t(first + i) >> j) & 1u));
+    Array<float, N> ret;
+    finish(v, dim_seed(dim), ret.data(), N);
+    return ret;
+  }
+
+  // Samples first to first + count - 1 of `dim`, evaluated incrementally
+  void sample(uint32_t first, size_t count, uint32_t dim, float *out) const;
+
+ private:
+  uint32_t dim_seed(uint32_t dim) const { return sample_tea_32(m_seed, dim); }
+
+  template <Scramble S>
+  static uint32_t apply_scramble(uint32_t v, uint32_t seed) {
+    if constexpr (S == Scramble::LaineKarras)
+      return detail::reverse_bits(
+          detail::laine_karras_permutation(detail::reverse_bits(v), seed));
+    else if constexpr (S == Scramble::Owen)
+      return detail::reverse_bits(
+          detail::owen_permutation(detail::reverse_bits(v), seed));
+    else
+      return v;
+  }
+
+  uint32_t apply_scramble(uint32_t v, uint32_t seed) const {
+    switch (m_scramble) {
+      case Scramble::LaineKarras:
+        return apply_scramble<Scramble::LaineKarras>(v, seed);
+      case Scramble::Owen:
+        return apply_scramble<Scramble::Owen>(v, seed);
+      default:
+        return v;
+    }
+  }
+
+  // Scramble and convert `count` raw values, choosing the scramble once so
+  // that the loop vectorizes
+  void finish(const uint32_t *v, uint32_t seed, float *out,
+              size_t count) const {
+    auto run = [&](auto tag) {
+      constexpr Scramble S = decltype(tag)::value;
+      for (size_t i = 0; i < count; ++i)
+        out[i] = detail::uint32_to_unit_float(apply_scramble<S>(v[i], seed));
+    };
+    switch (m_scramble) {
+      case Scramble::LaineKarras:
+        run(std::integral_constant<Scramble, Scramble::LaineKarras>());
+        break;
+      case Scramble::Owen:
+        run(std::integral_constant<Scramble, Scramble::Owen>());
+        break;
+      default:
+        run(std::integral_constant<Scramble, Scramble::None>());
+        break;
+    }
+  }
+
+  SobolTable m_table;
+  uint32_t m_seed;
+  Scramble m_scramble;
+};
+
+}  // namespace misaki::math
\ No newline at end of file
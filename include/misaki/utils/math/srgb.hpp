@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace misaki::math {
+
+// Batch sRGB transfer function conversions over flat channel buffers
+// (alpha channels, if any, must be skipped by the caller). With `parallel`
+// large buffers are split across the thread pool. Error bounds against
+// TColor3 are checked by `msk-bench srgb`.
+
+// Linear float to 8-bit sRGB, clamped to [0, 1]. Matches exact rounding
+// except for a few values lying within 1e-5 of a rounding boundary. With
+// `dither`, triangular noise of +-1 LSB seeded by the element index is
+// added before rounding.
+extern void linear_to_srgb8(const float *in, uint8_t *out, size_t count,
+                            bool dither = false, bool parallel = false);
+
+// 8-bit sRGB to linear float through a 256 entry table
+extern void srgb8_to_linear(const uint8_t *in, float *out, size_t count,
+                            bool parallel = false);
+
+// Float to float in both directions, matching TColor3::to_srgb() and
+// to_linear() within 10 ulp. `out` may be equal to `in`.
+extern void linear_to_srgb(const float *in, float *out, size_t count,
+                           bool parallel = false);
+extern void srgb_to_linear(const float *in, float *out, size_t count,
+                           bool parallel = false);
+
+// The table used by srgb8_to_linear()
+extern const float *srgb8_to_linear_table();
+
+}  // namespace misaki::math
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../misc/string.h"
+#include "../util/parallel.h"
 #include "matrix4.hpp"
 
 namespace misaki::math {
@@ -40,11 +41,48 @@ class TTransform4 {
 
   MSK_XPU Vector3 apply_normal(const Vector3 &normal) const noexcept {
     using Vector4 = TVector4<Value>;
-    const auto p =
-        (m_inverse_matrix * Vector4(normal.x, normal.y, normal.z, 0));
+    const auto p = (m_inverse_matrix.transpose() *
+                    Vector4(normal.x, normal.y, normal.z, 0));
     return Vector3(p.x, p.y, p.z).normalize();
   }
 
+  // Batched apply_point/apply_vector/apply_normal over structure-of-arrays
+  // buffers. Outputs may alias the inputs, and large batches can be split
+  // across the thread pool.
+  void apply_points(const Value *x, const Value *y, const Value *z,
+                    Value *out_x, Value *out_y, Value *out_z, size_t count,
+                    bool parallel = false) const {
+    apply_batch<Mode::Point>(x, y, z, out_x, out_y, out_z, count, parallel);
+  }
+
+  void apply_vectors(const Value *x, const Value *y, const Value *z,
+                     Value *out_x, Value *out_y, Value *out_z, size_t count,
+                     bool parallel = false) const {
+    apply_batch<Mode::Vector>(x, y, z, out_x, out_y, out_z, count, parallel);
+  }
+
+  void apply_normals(const Value *x, const Value *y, const Value *z,
+                     Value *out_x, Value *out_y, Value *out_z, size_t count,
+                     bool parallel = false) const {
+    apply_batch<Mode::Normal>(x, y, z, out_x, out_y, out_z, count, parallel);
+  }
+
+  // Same over arrays of vectors, `out` may be equal to `in`
+  void apply_points(const Vector3 *in, Vector3 *out, size_t count,
+                    bool parallel = false) const {
+    apply_batch<Mode::Point>(in, out, count, parallel);
+  }
+
+  void apply_vectors(const Vector3 *in, Vector3 *out, size_t count,
+                     bool parallel = false) const {
+    apply_batch<Mode::Vector>(in, out, count, parallel);
+  }
+
+  void apply_normals(const Vector3 *in, Vector3 *out, size_t count,
+                     bool parallel = false) const {
+    apply_batch<Mode::Normal>(in, out, count, parallel);
+  }
+
   MSK_XPU static Self translate(const Vector3 &delta) noexcept {
     Matrix4 m(1, 0, 0, delta.x, 0, 1, 0, delta.y, 0, 0, 1, delta.z, 0, 0, 0, 1);
     Matrix4 minv(1, 0, 0, -delta.x, 0, 1, 0, -delta.y, 0, 0, 1, -delta.z, 0, 0,
@@ -106,6 +144,127 @@ class TTransform4 {
     os << *this;
     return os.str();
   }
+
+ private:
+  enum class Mode { Point, Vector, Normal };
+
+  // Items handed to one thread pool task
+  static constexpr size_t BatchGrain = 16384;
+  // Vectors staged in SoA form at a time by the array-of-vectors path
+  static constexpr size_t BatchBlock = 64;
+
+  template <Mode mode>
+  void apply_batch(const Value *x, const Value *y, const Value *z,
+                   Value *out_x, Value *out_y, Value *out_z, size_t count,
+                   bool parallel) const {
+    if (!parallel) {
+      apply_kernel<mode>(x, y, z, out_x, out_y, out_z, 0, count);
+      return;
+    }
+    util::parallel_for(0, count, BatchGrain, [&](size_t begin, size_t end) {
+      apply_kernel<mode>(x, y, z, out_x, out_y, out_z, begin, end);
+    });
+  }
+
+  template <Mode mode>
+  void apply_batch(const Vector3 *in, Vector3 *out, size_t count,
+                   bool parallel) const {
+    auto run = [&](size_t begin, size_t end) {
+      Value x[BatchBlock], y[BatchBlock], z[BatchBlock];
+      for (size_t i = begin; i < end; i += BatchBlock) {
+        size_t n = std::min(BatchBlock, end - i);
+        for (size_t j = 0; j < n; ++j) {
+          x[j] = in[i + j].x;
+          y[j] = in[i + j].y;
+          z[j] = in[i + j].z;
+        }
+        apply_kernel<mode>(x, y, z, x, y, z, 0, n);
+        for (size_t j = 0; j < n; ++j) out[i + j] = Vector3(x[j], y[j], z[j]);
+      }
+    };
+    if (parallel)
+      util::parallel_for(0, count, BatchGrain, run);
+    else
+      run(0, count);
+  }
+
+  // Transforms [begin, end) with the matrix rows held in registers. Points
+  // through an affine matrix skip the homogeneous divide, and normals are
+  // renormalized in the same pass.
+  template <Mode mode>
+  void apply_kernel(const Value *x, const Value *y, const Value *z,
+                    Value *out_x, Value *out_y, Value *out_z, size_t begin,
+                    size_t end) const {
+    Value m[4][4];
+    for (size_t r = 0; r < 4; ++r)
+      for (size_t c = 0; c < 4; ++c)
+        m[r][c] = mode == Mode::Normal ? m_inverse_matrix(c, r)
+                                       : m_matrix(r, c);
+    const bool project = mode == Mode::Point &&
+                         (m[3][0] != 0 || m[3][1] != 0 || m[3][2] != 0 ||
+                          m[3][3] != 1);
+
+    size_t i = begin;
+    constexpr size_t Width = detail::native_width_v<Value>;
+    using Packet = detail::Packet<Value, Width>;
+    if constexpr (Packet::Enabled) {
+      using Register = typename Packet::Register;
+      Register p[4][4];
+      for (size_t r = 0; r < 4; ++r)
+        for (size_t c = 0; c < 4; ++c) p[r][c] = Packet::set1(m[r][c]);
+      const Register one = Packet::set1(Value(1));
+
+      for (; i + Width <= end; i += Width) {
+        Register vx = Packet::loadu(x + i), vy = Packet::loadu(y + i),
+                 vz = Packet::loadu(z + i), o[3];
+        for (size_t r = 0; r < 3; ++r) {
+          o[r] = Packet::add(Packet::mul(p[r][0], vx),
+                             Packet::add(Packet::mul(p[r][1], vy),
+                                         Packet::mul(p[r][2], vz)));
+          if constexpr (mode == Mode::Point) o[r] = Packet::add(o[r], p[r][3]);
+        }
+        if constexpr (mode == Mode::Point) {
+          if (project) {
+            Register w = Packet::add(
+                Packet::add(Packet::mul(p[3][0], vx), Packet::mul(p[3][1], vy)),
+                Packet::add(Packet::mul(p[3][2], vz), p[3][3]));
+            Register inv_w = Packet::div(one, w);
+            for (size_t r = 0; r < 3; ++r) o[r] = Packet::mul(o[r], inv_w);
+          }
+        } else if constexpr (mode == Mode::Normal) {
+          Register len2 = Packet::add(
+              Packet::mul(o[0], o[0]),
+              Packet::add(Packet::mul(o[1], o[1]), Packet::mul(o[2], o[2])));
+          Register inv_len = Packet::div(one, Packet::sqrt(len2));
+          for (size_t r = 0; r < 3; ++r) o[r] = Packet::mul(o[r], inv_len);
+        }
+        Packet::storeu(out_x + i, o[0]);
+        Packet::storeu(out_y + i, o[1]);
+        Packet::storeu(out_z + i, o[2]);
+      }
+    }
+
+    for (; i < end; ++i) {
+      Value vx = x[i], vy = y[i], vz = z[i], o[3];
+      for (size_t r = 0; r < 3; ++r) {
+        o[r] = m[r][0] * vx + m[r][1] * vy + m[r][2] * vz;
+        if constexpr (mode == Mode::Point) o[r] += m[r][3];
+      }
+      if constexpr (mode == Mode::Point) {
+        if (project) {
+          Value inv_w =
+              1 / (m[3][0] * vx + m[3][1] * vy + m[3][2] * vz + m[3][3]);
+          for (size_t r = 0; r < 3; ++r) o[r] *= inv_w;
+        }
+      } else if constexpr (mode == Mode::Normal) {
+        Value inv_len = 1 / sqrt(o[0] * o[0] + o[1] * o[1] + o[2] * o[2]);
+        for (size_t r = 0; r < 3; ++r) o[r] *= inv_len;
+      }
+      out_x[i] = o[0];
+      out_y[i] = o[1];
+      out_z[i] = o[2];
+    }
+  }
 };
 
 template <typename Value>
@@ -119,11 +278,12 @@ std::ostream &operator<<(std::ostream &oss, const TTransform4<Value> &t) {
   return oss;
 }
 
+// (A B)^-1 = B^-1 A^-1
 template <typename Value>
 MSK_XPU TTransform4<Value> operator*(const TTransform4<Value> &lhs,
                                      const TTransform4<Value> &rhs) noexcept {
   return TTransform4<Value>(lhs.matrix() * rhs.matrix(),
-                            lhs.inverse_matrix() * rhs.inverse_matrix());
+                            rhs.inverse_matrix() * lhs.inverse_matrix());
 }
 
 // Type alias
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <utility>
+
 #include "common.hpp"
 
 namespace misaki::math {
@@ -30,7 +32,7 @@ class TVector3 {
 
   // Inline math functions
   MSK_XPU auto norm() const noexcept {
-    return std::sqrt(squared_norm());
+    return sqrt(squared_norm());
   }
 
   MSK_XPU auto squared_norm() const noexcept {
@@ -38,26 +40,26 @@ class TVector3 {
   }
 
   MSK_XPU Self normalize() const noexcept {
-    static_assert(std::is_floating_point_v<Value>);
+    static_assert(std::is_floating_point_v<scalar_t<Value>>);
     return *this / norm();
   }
 
   MSK_XPU Self clamp(Value min_v, Value max_v) const noexcept {
-    return Self(std::clamp(x, min_v, max_v),
-                std::clamp(y, min_v, max_v),
-                std::clamp(z, min_v, max_v));
+    return Self(math::clamp(x, min_v, max_v),
+                math::clamp(y, min_v, max_v),
+                math::clamp(z, min_v, max_v));
   }
 
   MSK_XPU Self abs() const noexcept {
-    return Self(std::abs(x), std::abs(y), std::abs(z));
+    return Self(math::abs(x), math::abs(y), math::abs(z));
   }
 
   MSK_XPU Self ceil() const noexcept {
-    return Self(std::ceil(x), std::ceil(y), std::ceil(z));
+    return Self(math::ceil(x), math::ceil(y), math::ceil(z));
   }
 
   MSK_XPU Self floor() const noexcept {
-    return Self(std::floor(x), std::floor(y), std::floor(z));
+    return Self(math::floor(x), math::floor(y), math::floor(z));
   }
 
   MSK_XPU auto hsum() const noexcept {
@@ -68,9 +70,9 @@ class TVector3 {
     return x * y * z;
   }
 
-  MSK_XPU Value max_coeff() const noexcept { return std::max({x, y, z}); }
+  MSK_XPU Value max_coeff() const noexcept { return max(max(x, y), z); }
 
-  MSK_XPU Value min_coeff() const noexcept { return std::min({x, y, z}); }
+  MSK_XPU Value min_coeff() const noexcept { return min(min(x, y), z); }
 
   // Unary squared_norm
   MSK_XPU Self &operator+=(const Self &rhs) noexcept {
@@ -244,6 +246,22 @@ template <typename Value, typename T, std::enable_if_t<std::is_arithmetic_v<T>,
 MSK_XPU TVector3<Value> operator/(T lhs, const TVector3<Value> &rhs) noexcept {
   return TVector3<Value>(lhs / rhs.x, lhs / rhs.y, lhs / rhs.z);
 }
+
+// Operations with a packet of scalars, e.g. TVector3<Packet8f> * Packet8f
+template <typename Value, std::enable_if_t<is_array_v<Value>, int> = 0>
+MSK_XPU TVector3<Value> operator*(const TVector3<Value> &lhs, const Value &rhs) noexcept {
+  return TVector3<Value>(lhs.x * rhs, lhs.y * rhs, lhs.z * rhs);
+}
+
+template <typename Value, std::enable_if_t<is_array_v<Value>, int> = 0>
+MSK_XPU TVector3<Value> operator/(const TVector3<Value> &lhs, const Value &rhs) noexcept {
+  return TVector3<Value>(lhs.x / rhs, lhs.y / rhs, lhs.z / rhs);
+}
+
+template <typename Value, std::enable_if_t<is_array_v<Value>, int> = 0>
+MSK_XPU TVector3<Value> operator*(const Value &lhs, const TVector3<Value> &rhs) noexcept {
+  return TVector3<Value>(lhs * rhs.x, lhs * rhs.y, lhs * rhs.z);
+}
 // Math functions
 template <typename Value>
 MSK_XPU auto dot(const TVector3<Value> &lhs, const TVector3<Value> &rhs) noexcept {
@@ -260,12 +278,12 @@ MSK_XPU auto cross(const TVector3<Value> &lhs, const TVector3<Value> &rhs) noexc
 
 template <typename Value>
 MSK_XPU TVector3<Value> min(const TVector3<Value> &lhs, const TVector3<Value> &rhs) noexcept {
-  return TVector3<Value>(std::min(lhs.x, rhs.x), std::min(lhs.y, rhs.y), std::min(lhs.z, rhs.z));
+  return TVector3<Value>(min(lhs.x, rhs.x), min(lhs.y, rhs.y), min(lhs.z, rhs.z));
 }
 
 template <typename Value>
 MSK_XPU TVector3<Value> max(const TVector3<Value> &lhs, const TVector3<Value> &rhs) noexcept {
-  return TVector3<Value>(std::max(lhs.x, rhs.x), std::max(lhs.y, rhs.y), std::max(lhs.z, rhs.z));
+  return TVector3<Value>(max(lhs.x, rhs.x), max(lhs.y, rhs.y), max(lhs.z, rhs.z));
 }
 
 // Stream
@@ -284,17 +302,27 @@ std::ostream &operator<<(
 // Based on paper "Building an Orthonormal Basis, Revisited"
 template <typename Float>
 MSK_XPU void coordinate_system(const TVector3<Float> &n, TVector3<Float> *v1, TVector3<Float> *v2) {
-  Float sign = std::copysign(1.f, n.z);
-  const Float a = -1.f / (sign + n.z);
+  using Scalar = scalar_t<Float>;
+  const Float sign = copysign(Float(Scalar(1)), n.z);
+  const Float a = Scalar(-1) / (sign + n.z);
   const Float b = n.x * n.y * a;
-  *v1 = {1.f + sign * n.x * n.x * a, sign * b, -sign * n.x};
+  *v1 = {Scalar(1) + sign * n.x * n.x * a, sign * b, -sign * n.x};
   *v2 = {b, sign + n.y * n.y * a, -n.y};
 }
 
+template <typename Float>
+MSK_XPU std::pair<TVector3<Float>, TVector3<Float>> coordinate_system(const TVector3<Float> &n) {
+  std::pair<TVector3<Float>, TVector3<Float>> ret;
+  coordinate_system(n, &ret.first, &ret.second);
+  return ret;
+}
+
 // Type alias
 using Vector3f = TVector3<float>;
 using Vector3d = TVector3<double>;
 using Vector3i = TVector3<int>;
 using Vector3u = TVector3<uint32_t>;
+using Vector3f4 = TVector3<Packet4f>;
+using Vector3f8 = TVector3<Packet8f>;
 
 }  // namespace misaki::math
\ No newline at end of file
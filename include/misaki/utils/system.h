@@ -1,5 +1,6 @@
 #pragma once
 
 #include "system/fresolver.h"
+#include "system/mmap.h"
 #include "system/platform.h"
 #include "system/shared_library.h"
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+
+#include "platform.h"
+
+namespace misaki::system {
+
+// Read-only view of a whole file mapped into memory. Pages are loaded on
+// first access and shared with other processes mapping the same file.
+class MemoryMappedFile {
+ public:
+  // Throws std::runtime_error when the file cannot be opened or mapped
+  explicit MemoryMappedFile(const std::filesystem::path &filename);
+  ~MemoryMappedFile();
+
+  MemoryMappedFile(const MemoryMappedFile &) = delete;
+  MemoryMappedFile &operator=(const MemoryMappedFile &) = delete;
+
+  const void *data() const { return m_data; }
+  size_t size() const { return m_size; }
+  const std::filesystem::path &filename() const { return m_filename; }
+
+ private:
+  std::filesystem::path m_filename;
+  const void *m_data = nullptr;
+  size_t m_size = 0;
+#if MSK_PLATFORM_WINDOWS
+  void *m_file = nullptr;
+  void *m_mapping = nullptr;
+#endif
+};
+
+}  // namespace misaki::system
\ No newline at end of file
@@ -41,13 +41,15 @@ namespace misaki::system {
 #define MSK_VECTORCALL
 #endif
 
-/* Likely/unlikely macros (only on GCC/Clang) */
+/* Likely/unlikely and prefetch macros (only on GCC/Clang) */
 #if defined(__GNUG__) || defined(__clang__)
 #define likely(x) __builtin_expect(!!(x), 1)
 #define unlikely(x) __builtin_expect(!!(x), 0)
+#define MSK_PREFETCH(p) __builtin_prefetch(p)
 #else
 #define likely(x) (x)
 #define unlikely(x) (x)
+#define MSK_PREFETCH(p)
 #endif
 
 // For GPU
@@ -72,4 +74,20 @@ namespace misaki::system {
 #define MSK_GPU
 #endif
 
+// SIMD instruction sets available to host code
+#if !defined(MSK_IS_GPU_CODE) && !defined(MSK_DISABLE_SIMD)
+#if defined(__SSE4_2__) || defined(__AVX__)
+#define MSK_X86_SSE42 1
+#endif
+#if defined(__AVX__)
+#define MSK_X86_AVX 1
+#endif
+#if defined(__AVX2__)
+#define MSK_X86_AVX2 1
+#endif
+#if defined(__F16C__)
+#define MSK_X86_F16C 1
+#endif
+#endif
+
 }  // namespace misaki::system
\ No newline at end of file
@@ -1,3 +1,4 @@
 #pragma once
 
+#include "texture/distribution2d.h"
 #include "texture/sample2d.h"
\ No newline at end of file
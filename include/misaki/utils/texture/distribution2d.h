@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "../math/color3.hpp"
+#include "../math/vec2.hpp"
+
+namespace misaki::texture {
+
+// Piecewise-constant density over [0, 1)^2 proportional to a width x height
+// grid, sampled through a marginal CDF over rows and one conditional CDF per
+// row (binary searches). It takes one float per texel plus one per row and
+// per 64 texels; the grid itself is not kept. For environment maps, weight the rows by
+// sin(theta) first.
+class Distribution2D {
+ public:
+  Distribution2D() = default;
+
+  // Row-major values, finite and non-negative with a positive sum, otherwise
+  // std::runtime_error is thrown. With `parallel` rows are built on the
+  // thread pool.
+  Distribution2D(const float *values, uint32_t width, uint32_t height,
+                 bool parallel = false);
+
+  // Density proportional to pixel luminance
+  Distribution2D(const math::TColor3<float> *pixels, uint32_t width,
+                 uint32_t height, bool parallel = false);
+
+  uint32_t width() const { return m_width; }
+  uint32_t height() const { return m_height; }
+  // Sum of the values
+  double sum() const { return m_sum; }
+
+  // Point distributed proportionally to the grid, and its density
+  std::pair<math::TVector2<float>, float> sample(
+      const math::TVector2<float> &u) const {
+    auto [y, fy, py] = sample_cdf(
+        m_marginal.data(), search(m_marginal.data(), m_height, u.y), u.y);
+    auto [x, fx, px] = sample_row(y, u.x);
+    return {{position(x, fx, m_width, m_inv_width),
+             position(y, fy, m_height, m_inv_height)},
+            px * py * m_texels};
+  }
+
+  template <size_t N>
+  std::pair<math::TVector2<math::Array<float, N>>, math::Array<float, N>>
+  sample(const math::TVector2<math::Array<float, N>> &u) const {
+    std::pair<math::TVector2<math::Array<float, N>>, math::Array<float, N>>
+        ret;
+    for (size_t i = 0; i < N; ++i) {
+      auto [p, pdf] = sample({u.x.coeff(i), u.y.coeff(i)});
+      ret.first.x.coeff(i) = p.x;
+      ret.first.y.coeff(i) = p.y;
+      ret.second.coeff(i) = pdf;
+    }
+    return ret;
+  }
+
+  // Bulk version, `pdf` may be null
+  void sample(const math::TVector2<float> *u, math::TVector2<float> *out,
+              float *pdf, size_t count, bool parallel = false) const;
+
+  float pdf(const math::TVector2<float> &p) const {
+    auto [x, y] = texel(p);
+    return pmf(row(y), x) * pmf(m_marginal.data(), y) * m_texels;
+  }
+
+  // Uniform sample that sample() maps to `p`
+  math::TVector2<float> invert(const math::TVector2<float> &p) const {
+    auto [x, y] = texel(p);
+    const float *r = row(y);
+    float fx = p.x * m_width - x, fy = p.y * m_height - y;
+    return {std::min(lower(r, x) + fx * pmf(r, x), math::OneMinusEpsilon<float>),
+            std::min(lower(m_marginal.data(), y) + fy * pmf(m_marginal.data(), y),
+                     math::OneMinusEpsilon<float>)};
+  }
+
+ private:
+  static constexpr uint32_t BlockSize = 64;
+
+  struct CDFSample {
+    uint32_t index;
+    // Position within the entry in [0, 1) and probability of the entry
+    float offset, pmf;
+  };
+
+  static float lower(const float *cdf, uint32_t index) {
+    return index == 0 ? 0.f : cdf[index - 1];
+  }
+
+  static float pmf(const float *cdf, uint32_t index) {
+    return cdf[index] - lower(cdf, index);
+  }
+
+  // First of `size` entries whose CDF exceeds `u`, without branches
+  static uint32_t search(const float *cdf, uint32_t size, float u) {
+    const float *first = cdf;
+    while (size > 1) {
+      uint32_t half = size >> 1;
+      first += (first[half - 1] <= u) * half;
+      size -= half;
+    }
+    return uint32_t(first - cdf);
+  }
+
+  static CDFSample sample_cdf(const float *cdf, uint32_t index, float u) {
+    float p = pmf(cdf, index);
+    return {index,
+            std::min((u - lower(cdf, index)) / p, math::OneMinusEpsilon<float>),
+            p};
+  }
+
+  // A random row of a large map is cold, so the search first runs over the
+  // last CDF value of each block of the row, which all fit in cache, and then
+  // loads one block, prefetched as a whole
+  CDFSample sample_row(uint32_t y, float u) const {
+    const float *r = row(y);
+    uint32_t block = search(m_blocks.data() + size_t(y) * m_row_blocks,
+                            m_row_blocks, u);
+    uint32_t begin = block * BlockSize,
+             size = std::min(BlockSize, m_width - begin);
+    for (uint32_t i = 0; i < size; i += 16) MSK_PREFETCH(r + begin + i);
+    return sample_cdf(r, begin + search(r + begin, size, u), u);
+  }
+
+  // Coordinate at `offset` within texel `index`, kept inside that texel
+  // despite rounding so that pdf() and invert() agree with sample()
+  static float position(uint32_t index, float offset, uint32_t size,
+                        float inv_size) {
+    float p = std::min((index + offset) * inv_size, math::OneMinusEpsilon<float>);
+    while (p > 0.f && uint32_t(p * size) > index) p = std::nextafter(p, 0.f);
+    return p;
+  }
+
+  const float *row(uint32_t y) const {
+    return m_conditional.data() + size_t(y) * m_width;
+  }
+
+  std::pair<uint32_t, uint32_t> texel(const math::TVector2<float> &p) const {
+    return {std::min(uint32_t(std::max(p.x, 0.f) * m_width), m_width - 1),
+            std::min(uint32_t(std::max(p.y, 0.f) * m_height), m_height - 1)};
+  }
+
+  uint32_t m_width = 0, m_height = 0, m_row_blocks = 0;
+  float m_inv_width = 0.f, m_inv_height = 0.f, m_texels = 0.f;
+  double m_sum = 0.0;
+  std::vector<float> m_marginal;
+  std::vector<float> m_conditional;
+  // Last conditional CDF value of each block of BlockSize texels
+  std::vector<float> m_blocks;
+};
+
+}  // namespace misaki::texture
\ No newline at end of file
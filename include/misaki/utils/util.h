@@ -1,7 +1,10 @@
 #pragma once
 
+#include "util/aligned.h"
 #include "util/check.h"
 #include "util/logger.h"
+#include "util/parallel.h"
 #include "util/pbar.h"
+#include "util/radix_sort.h"
 #include "util/string.h"
 #include "util/timer.h"
\ No newline at end of file
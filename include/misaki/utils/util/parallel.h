@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+namespace misaki::util {
+
+// Start the worker pool. A thread count of zero uses one thread per core.
+// Called implicitly by the first parallel_for() when omitted.
+extern void init_parallel(size_t thread_count = 0);
+
+// Number of threads (including the calling one) that run parallel loops
+extern size_t thread_count();
+
+// Split [begin, end) into chunks of at most `grain` items and run `func` on
+// each chunk. The calling thread takes part in the work, so nested calls from
+// inside `func` are allowed. The first exception thrown by `func` is
+// rethrown once all chunks have finished.
+extern void parallel_for(size_t begin, size_t end, size_t grain,
+                         const std::function<void(size_t, size_t)> &func);
+
+}  // namespace misaki::util
\ No newline at end of file
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace misaki::util {
+
+// Stable LSD radix sort of keys carrying one value each, 8 bits per pass.
+// Only the low `bits` bits of the keys are sorted on, and passes in which
+// all keys share the same digit are skipped.
+extern void radix_sort(uint32_t *keys, uint32_t *values, size_t count,
+                       int bits = 32, bool parallel = true);
+extern void radix_sort(uint64_t *keys, uint32_t *values, size_t count,
+                       int bits = 64, bool parallel = true);
+
+}  // namespace misaki::util
\ No newline at end of file
@@ -0,0 +1,498 @@
+#include <misaki/utils/accel/bvh.h>
+#include <misaki/utils/util/parallel.h>
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+namespace misaki::accel {
+
+namespace {
+
+using Lane4 = math::Array<float, 4>;
+
+// Ranges of at least 2 * Grain primitives are binned and partitioned in
+// parallel chunks of Grain
+constexpr size_t Grain = 1 << 16;
+// Nodes of at least this many primitives build their children as two tasks
+constexpr uint32_t TaskThreshold = 1 << 13;
+constexpr uint32_t MaxBins = 64;
+
+Lane4 load(const math::TVector3<float> &v) { return Lane4(v.x, v.y, v.z, 0.f); }
+
+struct Box {
+  Lane4 lo = Lane4(math::Infinity<float>), hi = Lane4(-math::Infinity<float>);
+
+  void expand(const Lane4 &l, const Lane4 &h) {
+    lo = min(lo, l);
+    hi = max(hi, h);
+  }
+  void expand(const Box &b) { expand(b.lo, b.hi); }
+
+  // Half the surface area, zero for empty boxes
+  float half_area() const {
+    Lane4 d = max(hi - lo, Lane4(0.f));
+    return d.x() * d.y() + d.y() * d.z() + d.z() * d.x();
+  }
+
+  math::BoundingBox3f bbox() const {
+    return {{lo.x(), lo.y(), lo.z()}, {hi.x(), hi.y(), hi.z()}};
+  }
+};
+
+struct Bin {
+  Box bounds;
+  uint32_t count = 0;
+};
+
+// Bins of the three axes, allocated per node since small nodes use fewer
+struct Bins {
+  explicit Bins(uint32_t count) : count(count), data(new Bin[3 * count]) {}
+
+  Bin *axis(int k) { return data.get() + k * count; }
+  const Bin *axis(int k) const { return data.get() + k * count; }
+
+  void merge(const Bins &other) {
+    for (uint32_t i = 0; i < 3 * count; ++i) {
+      data[i].bounds.expand(other.data[i].bounds);
+      data[i].count += other.data[i].count;
+    }
+  }
+
+  uint32_t count;
+  std::unique_ptr<Bin[]> data;
+};
+
+// Maps centroids to bins along each axis. Axes without centroid extent have
+// a zero scale and put everything into bin 0.
+struct Binner {
+  Binner(const Box &centroids, uint32_t bins) : bins(bins) {
+    for (int k = 0; k < 3; ++k) {
+      float extent = centroids.hi.coeff(k) - centroids.lo.coeff(k);
+      base[k] = centroids.lo.coeff(k);
+      scale[k] = extent > 0.f ? bins / extent : 0.f;
+    }
+  }
+
+  bool degenerate() const {
+    return scale[0] == 0.f && scale[1] == 0.f && scale[2] == 0.f;
+  }
+
+  uint32_t operator()(float c, int axis) const {
+    return std::min(bins - 1, uint32_t((c - base[axis]) * scale[axis]));
+  }
+
+  float base[3], scale[3];
+  uint32_t bins;
+};
+
+struct Split {
+  float cost = math::Infinity<float>;
+  int axis = -1;
+  uint32_t bin = 0;
+  Box left, left_centroids, right, right_centroids;
+  uint32_t left_count = 0;
+};
+
+// Copy of a primitive's bounds and centroid that is partitioned along with
+// the build, so that every pass over a range reads memory in order. The
+// index is kept in the unused fourth lane of the centroid, so that all three
+// load as whole packets.
+struct PrimRef {
+  PrimRef() = default;
+  PrimRef(const math::BoundingBox3f &bounds,
+          const math::TVector3<float> &c, uint32_t index)
+      : lo(load(bounds.pmin)), hi(load(bounds.pmax)), centroid(load(c)) {
+    std::memcpy(&centroid.coeff(3), &index, sizeof(uint32_t));
+  }
+
+  uint32_t index() const {
+    uint32_t index;
+    std::memcpy(&index, &centroid.coeff(3), sizeof(uint32_t));
+    return index;
+  }
+
+  Lane4 lo, hi, centroid;
+};
+
+struct BuildNode {
+  BVHNode node;
+  // Arena holding the children of an interior node
+  uint32_t arena = 0;
+};
+
+using Arena = std::vector<BuildNode>;
+
+class Builder {
+ public:
+  Builder(PrimRef *refs, const BVHBuildSettings &settings)
+      : m_refs(refs), m_settings(settings) {}
+
+  // `first` is the first primitive of the subtree that opens the arena
+  std::pair<uint32_t, Arena *> new_arena(uint32_t first) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_arenas.push_back(std::make_unique<Arena>());
+    m_first.push_back(first);
+    return {uint32_t(m_arenas.size() - 1), m_arenas.back().get()};
+  }
+
+  const std::vector<std::unique_ptr<Arena>> &arenas() const { return m_arenas; }
+
+  // Arena ids sorted by their first primitive, an order that does not
+  // depend on how the tasks were scheduled
+  std::vector<uint32_t> arena_order() const {
+    std::vector<uint32_t> order(m_arenas.size());
+    for (uint32_t a = 0; a < order.size(); ++a) order[a] = a;
+    std::sort(order.begin(), order.end(),
+              [&](uint32_t a, uint32_t b) { return m_first[a] < m_first[b]; });
+    return order;
+  }
+
+  void range_bounds(uint32_t begin, uint32_t end, Box &bounds,
+                    Box &centroids) {
+    std::mutex mutex;
+    for_range(begin, end, [&](size_t b, size_t e) {
+      Box local, local_centroids;
+      for (size_t i = b; i < e; ++i) {
+        const PrimRef &ref = m_refs[i];
+        local.expand(ref.lo, ref.hi);
+        local_centroids.expand(ref.centroid, ref.centroid);
+      }
+      std::lock_guard<std::mutex> lock(mutex);
+      bounds.expand(local);
+      centroids.expand(local_centroids);
+    });
+  }
+
+  // `arena` is where the children of this node go. Subtrees built as tasks
+  // continue in the current arena for the left child and open a new one for
+  // the right child, so no arena is ever appended to by two threads.
+  BuildNode build(uint32_t begin, uint32_t end, const Box &bounds,
+                  const Box &centroids, uint32_t arena_id, Arena *arena) {
+    const uint32_t n = end - begin;
+    BuildNode result;
+    result.node.bbox = bounds.bbox();
+
+    Split split;
+    uint32_t mid = 0;
+    if (n > 1)
+      mid = plan(begin, end, bounds, centroids, split);
+    if (mid == 0) {
+      result.node.offset = begin;
+      result.node.count = n;
+      return result;
+    }
+
+    uint32_t pair = uint32_t(arena->size());
+    arena->resize(pair + 2);
+    BuildNode left, right;
+    if (m_settings.parallel && n >= TaskThreshold) {
+      auto [right_id, right_arena] = new_arena(mid);
+      util::parallel_for(0, 2, 1, [&](size_t b, size_t e) {
+        for (size_t i = b; i < e; ++i) {
+          if (i == 0)
+            left = build(begin, mid, split.left, split.left_centroids,
+                         arena_id, arena);
+          else
+            right = build(mid, end, split.right, split.right_centroids,
+                          right_id, right_arena);
+        }
+      });
+    } else {
+      left = build(begin, mid, split.left, split.left_centroids, arena_id,
+                   arena);
+      right = build(mid, end, split.right, split.right_centroids, arena_id,
+                    arena);
+    }
+    (*arena)[pair] = left;
+    (*arena)[pair + 1] = right;
+    result.node.offset = pair;
+    result.arena = arena_id;
+    return result;
+  }
+
+ private:
+  template <typename Func>
+  void for_range(size_t begin, size_t end, const Func &func) {
+    if (m_settings.parallel && end - begin >= 2 * Grain)
+      util::parallel_for(begin, end, Grain, func);
+    else
+      func(begin, end);
+  }
+
+  // Choose how to split [begin, end): returns the start of the right half
+  // after partitioning, or 0 for a leaf
+  uint32_t plan(uint32_t begin, uint32_t end, const Box &bounds,
+                             const Box &centroids, Split &split) {
+    const uint32_t n = end - begin;
+    // Small ranges cannot use more bins than they have primitives
+    Binner binner(centroids, std::min(m_settings.bins, n));
+    if (!binner.degenerate()) {
+      Bins bins(binner.bins);
+      bin_range(begin, end, binner, bins);
+      find_split(bins, bounds, split);
+    }
+
+    if (split.axis < 0) {
+      // All centroids coincide: SAH cannot separate them, so only split
+      // when the leaf would be too large
+      if (n <= m_settings.max_leaf_size)
+        return 0;
+      uint32_t mid = begin + n / 2;
+      range_bounds(begin, mid, split.left, split.left_centroids);
+      range_bounds(mid, end, split.right, split.right_centroids);
+      return mid;
+    }
+    if (n <= m_settings.max_leaf_size &&
+        m_settings.intersection_cost * n <= split.cost)
+      return 0;
+    return partition(begin, end, binner, split);
+  }
+
+  void centroid_bounds(uint32_t begin, uint32_t end, Box &centroids) {
+    std::mutex mutex;
+    for_range(begin, end, [&](size_t b, size_t e) {
+      Box local;
+      for (size_t i = b; i < e; ++i) {
+        local.expand(m_refs[i].centroid, m_refs[i].centroid);
+      }
+      std::lock_guard<std::mutex> lock(mutex);
+      centroids.expand(local);
+    });
+  }
+
+  void bin_range(uint32_t begin, uint32_t end, const Binner &binner,
+                 Bins &bins) {
+    std::mutex mutex;
+    for_range(begin, end, [&](size_t b, size_t e) {
+      std::unique_ptr<Bins> local;
+      Bins *target = &bins;
+      if (b != begin || e != end) {
+        local = std::make_unique<Bins>(bins.count);
+        target = local.get();
+      }
+      for (size_t i = b; i < e; ++i) {
+        const PrimRef &ref = m_refs[i];
+        for (int k = 0; k < 3; ++k) {
+          Bin &bin = target->axis(k)[binner(ref.centroid.coeff(k), k)];
+          bin.bounds.expand(ref.lo, ref.hi);
+          ++bin.count;
+        }
+      }
+      if (local) {
+        std::lock_guard<std::mutex> lock(mutex);
+        bins.merge(*local);
+      }
+    });
+  }
+
+  void find_split(const Bins &bins, const Box &bounds, Split &split) {
+    const uint32_t count = bins.count;
+    const float area = bounds.half_area(),
+                scale = m_settings.intersection_cost / (area > 0.f ? area : 1.f);
+    float right_area[MaxBins];
+    uint32_t right_count[MaxBins];
+    for (int k = 0; k < 3; ++k) {
+      const Bin *bin = bins.axis(k);
+      Box acc;
+      uint32_t n = 0;
+      for (uint32_t i = count - 1; i > 0; --i) {
+        acc.expand(bin[i].bounds);
+        n += bin[i].count;
+        right_area[i] = acc.half_area();
+        right_count[i] = n;
+      }
+      acc = Box();
+      n = 0;
+      for (uint32_t i = 1; i < count; ++i) {
+        acc.expand(bin[i - 1].bounds);
+        n += bin[i - 1].count;
+        if (n == 0 || right_count[i] == 0)
+          continue;
+        float cost = m_settings.traversal_cost +
+                     scale * (acc.half_area() * n + right_area[i] * right_count[i]);
+        if (cost < split.cost) {
+          split.cost = cost;
+          split.axis = k;
+          split.bin = i;
+        }
+      }
+    }
+    if (split.axis < 0)
+      return;
+
+    const Bin *bin = bins.axis(split.axis);
+    for (uint32_t i = 0; i < count; ++i) {
+      if (i < split.bin) {
+        split.left.expand(bin[i].bounds);
+        split.left_count += bin[i].count;
+      } else {
+        split.right.expand(bin[i].bounds);
+      }
+    }
+  }
+
+  // Also computes the centroid bounds of both halves, which are not binned
+  uint32_t partition(uint32_t begin, uint32_t end, const Binner &binner,
+                     Split &split) {
+    const int axis = split.axis;
+    auto is_left = [&](const PrimRef &ref) {
+      return binner(ref.centroid.coeff(axis), axis) < split.bin;
+    };
+    const size_t mid = begin + split.left_count;
+    if (!(m_settings.parallel && end - begin >= 2 * Grain)) {
+      PrimRef *l = m_refs + begin, *r = m_refs + end;
+      for (;;) {
+        for (; l < r && is_left(*l); ++l)
+          split.left_centroids.expand(l->centroid, l->centroid);
+        for (; l < r && !is_left(r[-1]); --r)
+          split.right_centroids.expand(r[-1].centroid, r[-1].centroid);
+        if (l == r)
+          break;
+        std::swap(*l, r[-1]);
+      }
+      return uint32_t(mid);
+    }
+
+    // Partition each chunk in place, then swap the right-side runs that
+    // ended up below `mid` with the left-side runs above it. Both hold the
+    // same number of references.
+    const size_t chunks = (end - begin + Grain - 1) / Grain;
+    std::vector<size_t> pivot(chunks);
+    util::parallel_for(0, chunks, 1, [&](size_t b, size_t e) {
+      for (size_t c = b; c < e; ++c) {
+        size_t first = begin + c * Grain,
+               last = std::min<size_t>(end, first + Grain);
+        pivot[c] = std::partition(m_refs + first, m_refs + last, is_left) -
+                   m_refs;
+      }
+    });
+    struct Runs {
+      std::vector<size_t> start, offset{0};
+      void add(size_t first, size_t last) {
+        if (first >= last)
+          return;
+        start.push_back(first);
+        offset.push_back(offset.back() + last - first);
+      }
+      // Position of the k-th misplaced reference, with the index of its run
+      size_t find(size_t k, size_t &run) const {
+        run = std::upper_bound(offset.begin(), offset.end(), k) -
+              offset.begin() - 1;
+        return start[run] + k - offset[run];
+      }
+    } wrong_right, wrong_left;
+    for (size_t c = 0; c < chunks; ++c) {
+      size_t first = begin + c * Grain,
+             last = std::min<size_t>(end, first + Grain);
+      wrong_right.add(pivot[c], std::min(last, mid));
+      wrong_left.add(std::max(first, mid), pivot[c]);
+    }
+    util::parallel_for(0, wrong_right.offset.back(), Grain,
+                       [&](size_t b, size_t e) {
+      size_t rr, lr, r = wrong_right.find(b, rr), l = wrong_left.find(b, lr);
+      for (size_t k = b; k < e; ++k) {
+        if (k == wrong_right.offset[rr + 1])
+          r = wrong_right.start[++rr];
+        if (k == wrong_left.offset[lr + 1])
+          l = wrong_left.start[++lr];
+        std::swap(m_refs[r++], m_refs[l++]);
+      }
+    });
+    centroid_bounds(begin, uint32_t(mid), split.left_centroids);
+    centroid_bounds(uint32_t(mid), end, split.right_centroids);
+    return uint32_t(mid);
+  }
+
+  PrimRef *m_refs;
+  BVHBuildSettings m_settings;
+  std::vector<std::unique_ptr<Arena>> m_arenas;
+  std::vector<uint32_t> m_first;
+  std::mutex m_mutex;
+};
+
+}  // namespace
+
+BVH::BVH(const math::BoundingBox3f *bounds,
+         const math::TVector3<float> *centroids, size_t count,
+         const BVHBuildSettings &settings) {
+  if (count == 0 || count >= (size_t(1) << 31))
+    throw std::runtime_error("BVH needs 1 to 2^31 - 1 primitives");
+  if (settings.max_leaf_size == 0 || settings.bins < 2 ||
+      settings.bins > MaxBins)
+    throw std::runtime_error("BVH needs a positive leaf size and 2 to 64 bins");
+
+  auto for_range = [&](const std::function<void(size_t, size_t)> &func) {
+    if (settings.parallel && count >= 2 * Grain)
+      util::parallel_for(0, count, Grain, func);
+    else
+      func(0, count);
+  };
+  std::vector<PrimRef> refs(count);
+  for_range([&](size_t b, size_t e) {
+    for (size_t i = b; i < e; ++i)
+      refs[i] = PrimRef(bounds[i], centroids[i], uint32_t(i));
+  });
+
+  Builder builder(refs.data(), settings);
+  Box root_bounds, root_centroids;
+  builder.range_bounds(0, uint32_t(count), root_bounds, root_centroids);
+  auto [root_id, root_arena] = builder.new_arena(0);
+  BuildNode root = builder.build(0, uint32_t(count), root_bounds,
+                                 root_centroids, root_id, root_arena);
+
+  // Concatenate the arenas after the root and the padding node, turning
+  // arena-local child indices into global ones
+  const auto &arenas = builder.arenas();
+  std::vector<uint32_t> order = builder.arena_order(), base(arenas.size());
+  uint32_t size = 2;
+  for (uint32_t a : order) {
+    base[a] = size;
+    size += uint32_t(arenas[a]->size());
+  }
+  auto relocate = [&](const BuildNode &n) {
+    BVHNode node = n.node;
+    if (!node.is_leaf())
+      node.offset += base[n.arena];
+    return node;
+  };
+  m_primitives.resize(count);
+  for_range([&](size_t b, size_t e) {
+    for (size_t i = b; i < e; ++i) m_primitives[i] = refs[i].index();
+  });
+  m_nodes.resize(size);
+  m_nodes[0] = relocate(root);
+  if (settings.parallel)
+    util::parallel_for(0, arenas.size(), 1, [&](size_t b, size_t e) {
+      for (size_t a = b; a < e; ++a)
+        std::transform(arenas[a]->begin(), arenas[a]->end(),
+                       m_nodes.begin() + base[a], relocate);
+    });
+  else
+    for (size_t a = 0; a < arenas.size(); ++a)
+      std::transform(arenas[a]->begin(), arenas[a]->end(),
+                     m_nodes.begin() + base[a], relocate);
+}
+
+float BVH::sah_cost(float traversal_cost, float intersection_cost) const {
+  if (m_nodes.empty())
+    return 0.f;
+  const float root_area = m_nodes[0].bbox.surface_area(),
+              scale = root_area > 0.f ? 1.f / root_area : 1.f;
+  double cost = 0.0;
+  for (size_t i = 0; i < m_nodes.size(); ++i) {
+    if (i == 1)
+      continue;
+    const BVHNode &node = m_nodes[i];
+    float area = root_area > 0.f ? node.bbox.surface_area() * scale : 1.f;
+    cost += area * (node.is_leaf() ? intersection_cost * node.count
+                                   : traversal_cost);
+  }
+  return float(cost);
+}
+
+}  // namespace misaki::accel
\ No newline at end of file
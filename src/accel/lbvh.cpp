@@ -0,0 +1,259 @@
+#include <misaki/utils/accel/lbvh.h>
+#include <misaki/utils/util/parallel.h>
+#include <misaki/utils/util/radix_sort.h>
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+namespace misaki::accel {
+
+namespace {
+
+constexpr size_t Grain = 1 << 16;
+// Nodes of at least this many primitives build their children as two tasks
+constexpr uint32_t TaskThreshold = 1 << 13;
+
+struct BuildNode {
+  BVHNode node;
+  // Arena holding the children of an interior node
+  uint32_t arena = 0;
+};
+
+using Arena = std::vector<BuildNode>;
+
+// Lowest key with only the highest set bit of `v`
+template <typename Key>
+Key highest_bit(Key v) {
+  for (size_t s = 1; s < sizeof(Key) * 8; s <<= 1) v |= v >> s;
+  return v ^ (v >> 1);
+}
+
+// Builds the tree over sorted keys, with leaves indexing into the sorted
+// order. Arenas work as in the SAH builder.
+template <typename Key>
+class Builder {
+ public:
+  Builder(const Key *keys, const math::BoundingBox3f *bounds,
+          const LBVHBuildSettings &settings)
+      : m_keys(keys), m_bounds(bounds), m_settings(settings) {}
+
+  std::pair<uint32_t, Arena *> new_arena(uint32_t first) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_arenas.push_back(std::make_unique<Arena>());
+    m_first.push_back(first);
+    return {uint32_t(m_arenas.size() - 1), m_arenas.back().get()};
+  }
+
+  const std::vector<std::unique_ptr<Arena>> &arenas() const { return m_arenas; }
+
+  std::vector<uint32_t> arena_order() const {
+    std::vector<uint32_t> order(m_arenas.size());
+    for (uint32_t a = 0; a < order.size(); ++a) order[a] = a;
+    std::sort(order.begin(), order.end(),
+              [&](uint32_t a, uint32_t b) { return m_first[a] < m_first[b]; });
+    return order;
+  }
+
+  BuildNode build(uint32_t begin, uint32_t end, uint32_t arena_id,
+                  Arena *arena) {
+    const uint32_t n = end - begin;
+    BuildNode result;
+    if (n <= m_settings.max_leaf_size) {
+      for (uint32_t i = begin; i < end; ++i)
+        result.node.bbox.expand(m_bounds[i]);
+      result.node.offset = begin;
+      result.node.count = n;
+      return result;
+    }
+
+    const uint32_t mid = split(begin, end);
+    uint32_t pair = uint32_t(arena->size());
+    arena->resize(pair + 2);
+    BuildNode left, right;
+    if (m_settings.parallel && n >= TaskThreshold) {
+      auto [right_id, right_arena] = new_arena(mid);
+      util::parallel_for(0, 2, 1, [&](size_t b, size_t e) {
+        for (size_t i = b; i < e; ++i) {
+          if (i == 0)
+            left = build(begin, mid, arena_id, arena);
+          else
+            right = build(mid, end, right_id, right_arena);
+        }
+      });
+    } else {
+      left = build(begin, mid, arena_id, arena);
+      right = build(mid, end, arena_id, arena);
+    }
+    (*arena)[pair] = left;
+    (*arena)[pair + 1] = right;
+    result.node.bbox = left.node.bbox;
+    result.node.bbox.expand(right.node.bbox);
+    result.node.offset = pair;
+    result.arena = arena_id;
+    return result;
+  }
+
+ private:
+  // First key that has the highest bit in which the range differs set, or
+  // the middle when all keys are equal
+  uint32_t split(uint32_t begin, uint32_t end) const {
+    Key diff = m_keys[begin] ^ m_keys[end - 1];
+    if (diff == 0)
+      return begin + (end - begin) / 2;
+    Key bit = highest_bit(diff);
+    return uint32_t(std::partition_point(m_keys + begin, m_keys + end,
+                                         [&](Key k) { return !(k & bit); }) -
+                    m_keys);
+  }
+
+  const Key *m_keys;
+  const math::BoundingBox3f *m_bounds;
+  LBVHBuildSettings m_settings;
+  std::vector<std::unique_ptr<Arena>> m_arenas;
+  std::vector<uint32_t> m_first;
+  std::mutex m_mutex;
+};
+
+template <typename Key>
+BVH build(const math::BoundingBox3f *bounds,
+          const math::TVector3<float> *centroids, size_t count,
+          const LBVHBuildSettings &settings) {
+  constexpr uint32_t KeyBits = 3 * math::detail::curve_bits<Key>;
+  if (settings.cluster_bits > KeyBits)
+    throw std::runtime_error("LBVH cluster bits exceed the key size");
+  const size_t chunks = (count + Grain - 1) / Grain;
+  auto for_chunks =
+      [&](const std::function<void(size_t, size_t, size_t)> &func) {
+    auto body = [&](size_t begin, size_t end) {
+      for (size_t c = begin; c < end; ++c)
+        func(c, c * Grain, std::min(count, (c + 1) * Grain));
+    };
+    if (settings.parallel && chunks > 1)
+      util::parallel_for(0, chunks, 1, body);
+    else
+      body(0, chunks);
+  };
+
+  math::BoundingBox3f centroid_bounds;
+  std::mutex mutex;
+  for_chunks([&](size_t, size_t begin, size_t end) {
+    math::BoundingBox3f local;
+    for (size_t i = begin; i < end; ++i) local.expand(centroids[i]);
+    std::lock_guard<std::mutex> lock(mutex);
+    centroid_bounds.expand(local);
+  });
+
+  // Sort primitive indices by key, then gather the bounds into that order
+  std::vector<Key> keys(count);
+  std::vector<uint32_t> primitives(count);
+  math::curve_keys(settings.curve, centroids, count, centroid_bounds,
+                   keys.data(), settings.parallel);
+  for_chunks([&](size_t, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) primitives[i] = uint32_t(i);
+  });
+  util::radix_sort(keys.data(), primitives.data(), count, KeyBits,
+                   settings.parallel);
+  std::vector<math::BoundingBox3f> sorted_bounds(count);
+  for_chunks([&](size_t, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i)
+      sorted_bounds[i] = bounds[primitives[i]];
+  });
+
+  // Clusters start where the leading key bits change
+  std::vector<uint32_t> starts{0};
+  if (settings.cluster_bits > 0) {
+    const uint32_t shift = KeyBits - settings.cluster_bits;
+    std::vector<std::vector<uint32_t>> chunk_starts(chunks);
+    for_chunks([&](size_t c, size_t begin, size_t end) {
+      for (size_t i = std::max<size_t>(begin, 1); i < end; ++i)
+        if ((keys[i] >> shift) != (keys[i - 1] >> shift))
+          chunk_starts[c].push_back(uint32_t(i));
+    });
+    for (const auto &s : chunk_starts)
+      starts.insert(starts.end(), s.begin(), s.end());
+  }
+  const size_t clusters = starts.size();
+  starts.push_back(uint32_t(count));
+
+  Builder<Key> builder(keys.data(), sorted_bounds.data(), settings);
+  std::vector<BuildNode> roots(clusters);
+  auto build_clusters = [&](size_t begin, size_t end) {
+    for (size_t c = begin; c < end; ++c) {
+      auto [id, arena] = builder.new_arena(starts[c]);
+      roots[c] = builder.build(starts[c], starts[c + 1], id, arena);
+    }
+  };
+  if (settings.parallel && clusters > 1)
+    util::parallel_for(0, clusters, 1, build_clusters);
+  else
+    build_clusters(0, clusters);
+
+  // Levels above the clusters, whose leaves each refer to one cluster
+  BVH::NodeArray top(2);
+  std::vector<uint32_t> top_clusters{0};
+  top[0].count = 1;
+  if (clusters > 1) {
+    std::vector<math::BoundingBox3f> cluster_bounds(clusters);
+    std::vector<math::TVector3<float>> cluster_centroids(clusters);
+    for (size_t c = 0; c < clusters; ++c) {
+      cluster_bounds[c] = roots[c].node.bbox;
+      cluster_centroids[c] = cluster_bounds[c].center();
+    }
+    BVHBuildSettings top_settings;
+    top_settings.max_leaf_size = 1;
+    top_settings.parallel = settings.parallel;
+    BVH tree(cluster_bounds.data(), cluster_centroids.data(), clusters,
+             top_settings);
+    top = tree.nodes();
+    top_clusters = tree.primitives();
+  }
+
+  // Top levels first, with their leaves replaced by the cluster roots, then
+  // the arenas
+  const auto &arenas = builder.arenas();
+  std::vector<uint32_t> order = builder.arena_order(), base(arenas.size());
+  uint32_t size = uint32_t(top.size());
+  for (uint32_t a : order) {
+    base[a] = size;
+    size += uint32_t(arenas[a]->size());
+  }
+  auto relocate = [&](const BuildNode &n) {
+    BVHNode node = n.node;
+    if (!node.is_leaf())
+      node.offset += base[n.arena];
+    return node;
+  };
+  BVH::NodeArray nodes(size);
+  for (size_t i = 0; i < top.size(); ++i)
+    nodes[i] = top[i].is_leaf() ? relocate(roots[top_clusters[top[i].offset]])
+                                : top[i];
+  auto copy_arenas = [&](size_t begin, size_t end) {
+    for (size_t a = begin; a < end; ++a)
+      std::transform(arenas[a]->begin(), arenas[a]->end(),
+                     nodes.begin() + base[a], relocate);
+  };
+  if (settings.parallel)
+    util::parallel_for(0, arenas.size(), 1, copy_arenas);
+  else
+    copy_arenas(0, arenas.size());
+  return BVH(std::move(nodes), std::move(primitives));
+}
+
+}  // namespace
+
+BVH build_lbvh(const math::BoundingBox3f *bounds,
+               const math::TVector3<float> *centroids, size_t count,
+               const LBVHBuildSettings &settings) {
+  if (count == 0 || count >= (size_t(1) << 31))
+    throw std::runtime_error("BVH needs 1 to 2^31 - 1 primitives");
+  if (settings.max_leaf_size == 0)
+    throw std::runtime_error("BVH needs a positive leaf size");
+  return settings.long_keys
+             ? build<uint64_t>(bounds, centroids, count, settings)
+             : build<uint32_t>(bounds, centroids, count, settings);
+}
+
+}  // namespace misaki::accel
\ No newline at end of file
@@ -0,0 +1,134 @@
+#include <misaki/utils/accel/refit.h>
+#include <misaki/utils/util/parallel.h>
+
+#include <algorithm>
+#include <utility>
+
+namespace misaki::accel {
+
+namespace {
+
+// Nodes refit per parallel chunk
+constexpr size_t Grain = 1 << 16;
+constexpr uint32_t InvalidNode = ~0u;
+
+}  // namespace
+
+BVHRefitter::BVHRefitter(BVH &bvh)
+    : m_bvh(bvh),
+      m_parents(bvh.m_nodes.size(), InvalidNode),
+      m_visits(std::make_unique<std::atomic<uint32_t>[]>(
+          bvh.m_nodes.size())) {
+  const auto &nodes = m_bvh.m_nodes;
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    if (i == 1 || nodes[i].is_leaf())
+      continue;
+    m_parents[nodes[i].offset] = m_parents[nodes[i].offset + 1] =
+        uint32_t(i);
+  }
+}
+
+void BVHRefitter::refit(const math::BoundingBox3f *bounds, bool parallel) {
+  auto &nodes = m_bvh.m_nodes;
+  const auto &primitives = m_bvh.m_primitives;
+  const bool threaded = parallel && nodes.size() >= 2 * Grain &&
+                        util::thread_count() > 1;
+  // Whether `p` has its other child done; a plain counter when serial,
+  // where the locked increment would be most of the cost
+  auto second_visit = [&](uint32_t p) {
+    if (threaded)
+      return m_visits[p].fetch_add(1, std::memory_order_acq_rel) != 0;
+    uint32_t visits = m_visits[p].load(std::memory_order_relaxed);
+    m_visits[p].store(visits + 1, std::memory_order_relaxed);
+    return visits != 0;
+  };
+  auto func = [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      BVHNode &leaf = nodes[i];
+      if (!leaf.is_leaf())
+        continue;
+      math::BoundingBox3f bbox;
+      for (uint32_t j = 0; j < leaf.count; ++j)
+        bbox.expand(bounds[primitives[leaf.offset + j]]);
+      leaf.bbox = bbox;
+      // Carry on upwards only from the second child to finish; the counter
+      // is cleared again for the next refit
+      for (uint32_t p = m_parents[i]; p != InvalidNode; p = m_parents[p]) {
+        if (!second_visit(p))
+          break;
+        m_visits[p].store(0, std::memory_order_relaxed);
+        BVHNode &node = nodes[p];
+        node.bbox = nodes[node.offset].bbox;
+        node.bbox.expand(nodes[node.offset + 1].bbox);
+      }
+    }
+  };
+  if (threaded)
+    util::parallel_for(0, nodes.size(), Grain, func);
+  else
+    func(0, nodes.size());
+}
+
+// Try the four swaps of a child of `index` with a grandchild on the other
+// side, keeping the one that shrinks the other child the most
+bool BVHRefitter::rotate(uint32_t index) {
+  auto &nodes = m_bvh.m_nodes;
+  const uint32_t first = nodes[index].offset;
+  float best_gain = 0.f;
+  uint32_t child = 0, grandchild = 0;
+  for (uint32_t side = 0; side < 2; ++side) {
+    const BVHNode &other = nodes[first + 1 - side];
+    if (other.is_leaf())
+      continue;
+    const float area = other.bbox.surface_area();
+    for (uint32_t k = 0; k < 2; ++k) {
+      math::BoundingBox3f bbox = nodes[first + side].bbox;
+      bbox.expand(nodes[other.offset + 1 - k].bbox);
+      float gain = area - bbox.surface_area();
+      if (gain > best_gain) {
+        best_gain = gain;
+        child = first + side;
+        grandchild = other.offset + k;
+      }
+    }
+  }
+  if (best_gain <= 0.f)
+    return false;
+
+  std::swap(nodes[child], nodes[grandchild]);
+  for (uint32_t slot : {child, grandchild}) {
+    const BVHNode &node = nodes[slot];
+    if (!node.is_leaf())
+      m_parents[node.offset] = m_parents[node.offset + 1] = slot;
+  }
+  BVHNode &other = nodes[m_parents[grandchild]];
+  other.bbox = nodes[other.offset].bbox;
+  other.bbox.expand(nodes[other.offset + 1].bbox);
+  return true;
+}
+
+size_t BVHRefitter::optimize() {
+  const auto &nodes = m_bvh.m_nodes;
+  if (nodes.empty())
+    return 0;
+  size_t rotations = 0;
+  // Post-order, so that subtrees are rotated before their parents
+  std::vector<std::pair<uint32_t, bool>> stack{{0u, false}};
+  while (!stack.empty()) {
+    auto [index, expanded] = stack.back();
+    stack.pop_back();
+    const BVHNode &node = nodes[index];
+    if (node.is_leaf())
+      continue;
+    if (expanded) {
+      rotations += rotate(index);
+      continue;
+    }
+    stack.push_back({index, true});
+    stack.push_back({node.offset, false});
+    stack.push_back({node.offset + 1, false});
+  }
+  return rotations;
+}
+
+}  // namespace misaki::accel
\ No newline at end of file
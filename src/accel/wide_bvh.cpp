@@ -0,0 +1,165 @@
+#include <misaki/utils/accel/wide_bvh.h>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace misaki::accel {
+
+namespace {
+
+static_assert(sizeof(TCompressedWideBVHNode<4>) == 64 &&
+              sizeof(TCompressedWideBVHNode<8>) == 128);
+
+struct Child {
+  const BVHNode *node;
+  // Slot in the wide node array for interior children
+  uint32_t index = 0;
+};
+
+template <size_t Width>
+void set_child(TWideBVHNode<Width> &node, size_t i,
+               const math::BoundingBox3f &bbox) {
+  node.bbox.set(i, bbox);
+}
+
+// Smallest power of two step whose 255 multiples cover [lo, hi] from lo
+int8_t quantization_exponent(float lo, float hi) {
+  int e = -126;
+  float extent = hi - lo;
+  if (extent > 0.f) {
+    std::frexp(extent / 255.f, &e);
+    e = std::max(e - 1, -126);
+  }
+  auto scale = [](int e) { return std::ldexp(1.f, e); };
+  while (e < 127 && lo + 255.f * scale(e) < hi) ++e;
+  return int8_t(e);
+}
+
+template <size_t Width>
+void set_child(TCompressedWideBVHNode<Width> &node, size_t i,
+               const math::BoundingBox3f &bbox) {
+  for (int k = 0; k < 3; ++k) {
+    const float origin = node.origin[k], s = node.scale(k);
+    float l = std::floor((bbox.pmin[k] - origin) / s),
+          h = std::ceil((bbox.pmax[k] - origin) / s);
+    uint32_t ql = uint32_t(std::clamp(l, 0.f, 255.f)),
+             qh = uint32_t(std::clamp(h, 0.f, 255.f));
+    // Rounding of the offsets may leave the decoded planes just inside the
+    // box, so step outwards until they are not
+    while (ql > 0 && origin + float(ql) * s > bbox.pmin[k]) --ql;
+    while (qh < 255 && origin + float(qh) * s < bbox.pmax[k]) ++qh;
+    node.lo[k][i] = uint8_t(ql);
+    node.hi[k][i] = uint8_t(qh);
+  }
+}
+
+template <size_t Width>
+void init_node(TWideBVHNode<Width> &node, const math::BoundingBox3f &) {
+  node = TWideBVHNode<Width>();
+  std::fill(node.child, node.child + Width, 0u);
+  std::fill(node.count, node.count + Width, uint8_t(0));
+}
+
+// Empty slots decode to inverted boxes
+template <size_t Width>
+void init_node(TCompressedWideBVHNode<Width> &node,
+               const math::BoundingBox3f &bbox) {
+  for (int k = 0; k < 3; ++k) {
+    node.origin[k] = bbox.pmin[k];
+    node.exponent[k] = quantization_exponent(bbox.pmin[k], bbox.pmax[k]);
+    std::fill(node.lo[k], node.lo[k] + Width, uint8_t(255));
+    std::fill(node.hi[k], node.hi[k] + Width, uint8_t(0));
+  }
+  std::fill(node.child, node.child + Width, 0u);
+  std::fill(node.count, node.count + Width, uint8_t(0));
+}
+
+template <typename Node, size_t Width, typename NodeArray>
+class Collapser {
+ public:
+  Collapser(const BVH::NodeArray &binary, NodeArray &nodes)
+      : m_binary(binary), m_nodes(nodes) {}
+
+  // Emit the wide node for binary node `b` into slot `index`, returning the
+  // depth of its subtree
+  size_t emit(const BVHNode &b, uint32_t index) {
+    Child children[Width];
+    size_t count = 0;
+    if (b.is_leaf()) {
+      children[count++].node = &b;
+    } else {
+      children[count++].node = &m_binary[b.offset];
+      children[count++].node = &m_binary[b.offset + 1];
+    }
+    // Open the interior child with the largest surface area until full
+    while (count < Width) {
+      size_t best = Width;
+      float best_area = -1.f;
+      for (size_t i = 0; i < count; ++i) {
+        if (children[i].node->is_leaf())
+          continue;
+        float area = children[i].node->bbox.surface_area();
+        if (area > best_area) {
+          best = i;
+          best_area = area;
+        }
+      }
+      if (best == Width)
+        break;
+      uint32_t offset = children[best].node->offset;
+      children[best].node = &m_binary[offset];
+      children[count++].node = &m_binary[offset + 1];
+    }
+
+    // Reserve the interior children's slots next to each other, then fill
+    // this node and recurse
+    for (size_t i = 0; i < count; ++i)
+      if (!children[i].node->is_leaf()) {
+        children[i].index = uint32_t(m_nodes.size());
+        m_nodes.emplace_back();
+      }
+    Node &node = m_nodes[index];
+    init_node(node, b.bbox);
+    for (size_t i = 0; i < count; ++i) {
+      const BVHNode &c = *children[i].node;
+      if (c.is_leaf()) {
+        if (c.count > 255)
+          throw std::runtime_error("Wide BVH leaves hold at most 255 "
+                                   "primitives");
+        node.child[i] = c.offset;
+        node.count[i] = uint8_t(c.count);
+      } else {
+        node.child[i] = children[i].index;
+      }
+      set_child(node, i, c.bbox);
+    }
+    size_t depth = 0;
+    for (size_t i = 0; i < count; ++i)
+      if (!children[i].node->is_leaf())
+        depth = std::max(depth, emit(*children[i].node, children[i].index));
+    return depth + 1;
+  }
+
+ private:
+  const BVH::NodeArray &m_binary;
+  NodeArray &m_nodes;
+};
+
+}  // namespace
+
+template <size_t Width, bool Compressed>
+TWideBVH<Width, Compressed>::TWideBVH(const BVH &bvh)
+    : m_primitives(bvh.primitives()) {
+  m_nodes.reserve(bvh.nodes().size() / (Width - 1) + 1);
+  m_nodes.emplace_back();
+  Collapser<Node, Width, NodeArray> collapser(bvh.nodes(), m_nodes);
+  m_stack_size = collapser.emit(bvh.root(), 0) * (Width - 1) + 2;
+}
+
+template class TWideBVH<4, false>;
+template class TWideBVH<4, true>;
+template class TWideBVH<8, false>;
+template class TWideBVH<8, true>;
+
+}  // namespace misaki::accel
\ No newline at end of file
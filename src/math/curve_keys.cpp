@@ -0,0 +1,51 @@
+#include <misaki/utils/math/curve_keys.hpp>
+#include <misaki/utils/util/parallel.h>
+
+namespace misaki::math {
+
+namespace {
+constexpr size_t Grain = 1 << 16;
+constexpr size_t Width = 8;
+
+void run(size_t count, bool parallel,
+         const std::function<void(size_t, size_t)> &func) {
+  if (parallel && count > Grain)
+    util::parallel_for(0, count, Grain, func);
+  else
+    func(0, count);
+}
+
+template <typename Key>
+void compute_keys(SpaceFillingCurve curve, const TVector3<float> *points,
+                  size_t count, const TBoundingBox3<float> &bounds, Key *keys,
+                  bool parallel) {
+  run(count, parallel, [&](size_t begin, size_t end) {
+    size_t i = begin;
+    for (; end - i >= Width; i += Width) {
+      TVector3<Array<float, Width>> p;
+      for (size_t j = 0; j < Width; ++j) {
+        p.x.coeff(j) = points[i + j].x;
+        p.y.coeff(j) = points[i + j].y;
+        p.z.coeff(j) = points[i + j].z;
+      }
+      Array<Key, Width> k = curve_key<Key>(curve, p, bounds);
+      std::copy(k.data(), k.data() + Width, keys + i);
+    }
+    for (; i < end; ++i) keys[i] = curve_key<Key>(curve, points[i], bounds);
+  });
+}
+}  // namespace
+
+void curve_keys(SpaceFillingCurve curve, const TVector3<float> *points,
+                size_t count, const TBoundingBox3<float> &bounds,
+                uint32_t *keys, bool parallel) {
+  compute_keys(curve, points, count, bounds, keys, parallel);
+}
+
+void curve_keys(SpaceFillingCurve curve, const TVector3<float> *points,
+                size_t count, const TBoundingBox3<float> &bounds,
+                uint64_t *keys, bool parallel) {
+  compute_keys(curve, points, count, bounds, keys, parallel);
+}
+
+}  // namespace misaki::math
\ No newline at end of file
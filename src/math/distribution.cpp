@@ -0,0 +1,214 @@
+#include <misaki/utils/math/distribution.hpp>
+#include <misaki/utils/util/parallel.h>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+
+namespace misaki::math {
+
+namespace {
+
+// Work is split at fixed multiples of Grain, so partial sums and therefore
+// the tables do not depend on `parallel` or the thread count
+constexpr size_t Grain = 1 << 16;
+
+void for_chunks(size_t size, bool parallel,
+                const std::function<void(size_t, size_t, size_t)> &func) {
+  size_t chunks = (size + Grain - 1) / Grain;
+  auto body = [&](size_t begin, size_t end) {
+    for (size_t c = begin; c < end; ++c)
+      func(c, c * Grain, std::min(size, (c + 1) * Grain));
+  };
+  if (parallel && chunks > 1)
+    util::parallel_for(0, chunks, 1, body);
+  else
+    body(0, chunks);
+}
+
+// Per-chunk sums of the weights, checking them on the way
+std::vector<double> chunk_sums(const float *weights, size_t size,
+                               bool parallel, double *total) {
+  if (size == 0 || size >= std::numeric_limits<uint32_t>::max())
+    throw std::runtime_error("Discrete distributions need 1 to 2^32 - 1 "
+                             "entries");
+  std::vector<double> sums((size + Grain - 1) / Grain);
+  std::vector<uint8_t> valid(sums.size());
+  for_chunks(size, parallel, [&](size_t c, size_t begin, size_t end) {
+    double sum = 0.0;
+    bool ok = true;
+    for (size_t i = begin; i < end; ++i) {
+      ok &= weights[i] >= 0.f && weights[i] <= std::numeric_limits<float>::max();
+      sum += weights[i];
+    }
+    sums[c] = sum;
+    valid[c] = ok;
+  });
+  *total = 0.0;
+  for (size_t c = 0; c < sums.size(); ++c) {
+    if (!valid[c])
+      throw std::runtime_error("Discrete distribution weights must be finite "
+                               "and non-negative");
+    *total += sums[c];
+  }
+  if (!(*total > 0.0))
+    throw std::runtime_error("Discrete distribution weights sum to zero");
+  return sums;
+}
+
+// Probability in [0, 1] as a 32-bit fixed point alias threshold, where
+// certainty rounds down to 1 - 2^-32
+uint32_t to_threshold(double prob) {
+  double t = std::min(std::max(prob, 0.0), 1.0) * 4294967296.0;
+  return t >= 4294967295.0 ? std::numeric_limits<uint32_t>::max()
+                           : uint32_t(t);
+}
+
+}  // namespace
+
+DiscreteDistribution::DiscreteDistribution(const float *weights, size_t size,
+                                           bool parallel) {
+  chunk_sums(weights, size, parallel, &m_sum);
+  const double scale = double(size) / m_sum, inv_sum = 1.0 / m_sum;
+  const size_t chunks = (size + Grain - 1) / Grain;
+
+  // With weights scaled to a mean of 1, entries below 1 are light and have a
+  // deficit 1 - q, the others are heavy with an excess q - 1. Both get
+  // positions along the running sums of those amounts, in index order.
+  std::vector<size_t> light_offset(chunks + 1, 0), heavy_offset(chunks + 1, 0);
+  std::vector<double> deficit_offset(chunks + 1, 0.0),
+      excess_offset(chunks + 1, 0.0);
+  m_pmf.resize(size);
+  for_chunks(size, parallel, [&](size_t c, size_t begin, size_t end) {
+    size_t lights = 0;
+    double deficit = 0.0, excess = 0.0;
+    for (size_t i = begin; i < end; ++i) {
+      double q = weights[i] * scale;
+      m_pmf[i] = float(weights[i] * inv_sum);
+      lights += q < 1.0;
+      deficit += std::max(1.0 - q, 0.0);
+      excess += std::max(q - 1.0, 0.0);
+    }
+    light_offset[c + 1] = lights;
+    heavy_offset[c + 1] = end - begin - lights;
+    deficit_offset[c + 1] = deficit;
+    excess_offset[c + 1] = excess;
+  });
+  for (size_t c = 0; c < chunks; ++c) {
+    light_offset[c + 1] += light_offset[c];
+    heavy_offset[c + 1] += heavy_offset[c];
+    deficit_offset[c + 1] += deficit_offset[c];
+    excess_offset[c + 1] += excess_offset[c];
+  }
+
+  const size_t light_count = light_offset[chunks],
+               heavy_count = heavy_offset[chunks];
+  std::vector<uint32_t> lights(light_count), heavies(heavy_count);
+  std::vector<double> light_pos(light_count + 1), heavy_pos(heavy_count + 1);
+  light_pos[light_count] = deficit_offset[chunks];
+  heavy_pos[heavy_count] = excess_offset[chunks];
+  for_chunks(size, parallel, [&](size_t c, size_t begin, size_t end) {
+    size_t l = light_offset[c], h = heavy_offset[c];
+    double deficit = deficit_offset[c], excess = excess_offset[c];
+    for (size_t i = begin; i < end; ++i) {
+      double q = weights[i] * scale;
+      if (q < 1.0) {
+        lights[l] = uint32_t(i);
+        light_pos[l++] = deficit;
+        deficit += 1.0 - q;
+      } else {
+        heavies[h] = uint32_t(i);
+        heavy_pos[h++] = excess;
+        excess += q - 1.0;
+      }
+    }
+  });
+
+  // The sweep pairs lights in order with the current heavy, which hands over
+  // to the next heavy once its excess is used up. Hence light l takes the
+  // heavy whose excess range holds the light's start position, and heavy h
+  // keeps whatever the light straddling the end of its range leaves over.
+  m_table.resize(size);
+  for_chunks(light_count, parallel, [&](size_t, size_t begin, size_t end) {
+    if (heavy_count == 0) {
+      for (size_t l = begin; l < end; ++l)
+        m_table[lights[l]] = {to_threshold(1.0), lights[l]};
+      return;
+    }
+    size_t h = size_t(std::upper_bound(heavy_pos.begin(),
+                                       heavy_pos.begin() + heavy_count,
+                                       light_pos[begin]) -
+                      heavy_pos.begin());
+    h = h > 0 ? h - 1 : 0;
+    for (size_t l = begin; l < end; ++l) {
+      while (h + 1 < heavy_count && heavy_pos[h + 1] <= light_pos[l]) ++h;
+      m_table[lights[l]] = {to_threshold(weights[lights[l]] * scale),
+                            heavies[h]};
+    }
+  });
+  for_chunks(heavy_count, parallel, [&](size_t, size_t begin, size_t end) {
+    size_t l = size_t(std::upper_bound(light_pos.begin() + 1, light_pos.end(),
+                                       heavy_pos[begin + 1]) -
+                      light_pos.begin()) - 1;
+    for (size_t h = begin; h < end; ++h) {
+      double limit = heavy_pos[h + 1];
+      while (l < light_count && light_pos[l + 1] <= limit) ++l;
+      if (h + 1 < heavy_count && l < light_count && light_pos[l] < limit)
+        m_table[heavies[h]] = {to_threshold(1.0 - (light_pos[l + 1] - limit)),
+                               heavies[h + 1]};
+      else
+        m_table[heavies[h]] = {to_threshold(1.0), heavies[h]};
+    }
+  });
+}
+
+void DiscreteDistribution::sample(const uint32_t *u, uint32_t *out,
+                                  size_t count) const {
+  for (size_t i = 0; i < count; ++i) out[i] = sample(u[i]);
+}
+
+DiscreteCDF::DiscreteCDF(const float *weights, size_t size, bool parallel) {
+  std::vector<double> sums = chunk_sums(weights, size, parallel, &m_sum);
+  for (size_t c = 1; c < sums.size(); ++c) sums[c] += sums[c - 1];
+  m_cdf.resize(size);
+  for_chunks(size, parallel, [&](size_t c, size_t begin, size_t end) {
+    double sum = c == 0 ? 0.0 : sums[c - 1];
+    for (size_t i = begin; i < end; ++i) {
+      sum += weights[i];
+      m_cdf[i] = float(sum / m_sum);
+    }
+  });
+  // Exactly 1, so that every u < 1 has an entry
+  const float last = m_cdf[size - 1];
+  for (size_t i = size; i-- > 0 && m_cdf[i] >= last;) m_cdf[i] = 1.f;
+
+  // Slot k starts at the smallest u that sample() maps to it
+  const size_t slots = size;
+  m_guide.resize(slots + 1);
+  auto slot_of = [&](float u) {
+    return std::min(size_t(u * float(slots)), slots - 1);
+  };
+  for_chunks(slots, parallel, [&](size_t, size_t begin, size_t end) {
+    size_t i = 0;
+    for (size_t k = begin; k < end; ++k) {
+      float u = float(k) / float(slots);
+      while (u > 0.f && slot_of(std::nextafter(u, 0.f)) >= k)
+        u = std::nextafter(u, 0.f);
+      while (slot_of(u) < k) u = std::nextafter(u, 1.f);
+      // Search once per chunk, then walk forward
+      if (k == begin)
+        i = size_t(std::upper_bound(m_cdf.begin(), m_cdf.end(), u) -
+                   m_cdf.begin());
+      while (i < size && m_cdf[i] <= u) ++i;
+      m_guide[k] = uint32_t(i);
+    }
+  });
+  m_guide[slots] = uint32_t(size - 1);
+}
+
+void DiscreteCDF::sample(const float *u, uint32_t *out, size_t count) const {
+  for (size_t i = 0; i < count; ++i) out[i] = sample(u[i]);
+}
+
+}  // namespace misaki::math
\ No newline at end of file
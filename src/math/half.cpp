@@ -0,0 +1,79 @@
+#include <misaki/utils/math/half.hpp>
+#include <misaki/utils/util/parallel.h>
+
+namespace misaki::math {
+
+namespace detail {
+
+namespace {
+// Binary16 to float, after Marat Dukhan's FP16 library
+float half_bits_to_float(uint16_t h) {
+  uint32_t w = uint32_t(h) << 16, sign = w & 0x80000000u, two_w = w + w;
+  uint32_t normalized_bits = (two_w >> 4) + (0xe0u << 23),
+           denormalized_bits = (two_w >> 17) | (126u << 23);
+  float normalized, denormalized;
+  std::memcpy(&normalized, &normalized_bits, sizeof(float));
+  std::memcpy(&denormalized, &denormalized_bits, sizeof(float));
+  normalized *= 0x1.0p-112f;
+  denormalized -= 0.5f;
+  uint32_t result_bits;
+  std::memcpy(&result_bits, two_w < (1u << 27) ? &denormalized : &normalized,
+              sizeof(uint32_t));
+  result_bits |= sign;
+  float result;
+  std::memcpy(&result, &result_bits, sizeof(float));
+  return result;
+}
+}  // namespace
+
+const float *half_to_float_table() {
+  static const struct Table {
+    float values[65536];
+    Table() {
+      for (uint32_t i = 0; i < 65536; ++i)
+        values[i] = half_bits_to_float(uint16_t(i));
+    }
+  } table;
+  return table.values;
+}
+
+}  // namespace detail
+
+namespace {
+constexpr size_t Grain = 1 << 16;
+
+void run(size_t count, bool parallel,
+         const std::function<void(size_t, size_t)> &func) {
+  if (parallel && count > Grain)
+    util::parallel_for(0, count, Grain, func);
+  else
+    func(0, count);
+}
+}  // namespace
+
+void float_to_half(const float *in, half *out, size_t count, bool parallel) {
+  run(count, parallel, [&](size_t begin, size_t end) {
+    size_t i = begin;
+#if defined(MSK_X86_F16C) && defined(MSK_X86_AVX)
+    for (; end - i >= 8; i += 8)
+      _mm_storeu_si128((__m128i *)(out + i),
+                       _mm256_cvtps_ph(_mm256_loadu_ps(in + i),
+                                       _MM_FROUND_TO_NEAREST_INT));
+#endif
+    for (; i < end; ++i) out[i] = half(in[i]);
+  });
+}
+
+void half_to_float(const half *in, float *out, size_t count, bool parallel) {
+  run(count, parallel, [&](size_t begin, size_t end) {
+    size_t i = begin;
+#if defined(MSK_X86_F16C) && defined(MSK_X86_AVX)
+    for (; end - i >= 8; i += 8)
+      _mm256_storeu_ps(out + i, _mm256_cvtph_ps(_mm_loadu_si128(
+                                    (const __m128i *)(in + i))));
+#endif
+    for (; i < end; ++i) out[i] = float(in[i]);
+  });
+}
+
+}  // namespace misaki::math
\ No newline at end of file
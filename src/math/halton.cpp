@@ -0,0 +1,92 @@
+#include <misaki/utils/math/halton.hpp>
+#include <misaki/utils/math/random.hpp>
+
+#include <numeric>
+#include <stdexcept>
+
+namespace misaki::math {
+
+const uint32_t *halton_bases() {
+  static const struct Table {
+    uint32_t values[HaltonMaxDimension];
+    Table() {
+      uint32_t n = 0;
+      for (uint32_t p = 2; n < HaltonMaxDimension; ++p) {
+        bool prime = true;
+        for (uint32_t k = 0; k < n && values[k] * values[k] <= p; ++k)
+          if (p % values[k] == 0) {
+            prime = false;
+            break;
+          }
+        if (prime)
+          values[n++] = p;
+      }
+    }
+  } table;
+  return table.values;
+}
+
+HaltonSampler::HaltonSampler(uint32_t dimensions, uint32_t seed,
+                             Scramble scramble)
+    : m_dimensions(dimensions), m_scramble(scramble) {
+  if (dimensions == 0 || dimensions > HaltonMaxDimension)
+    throw std::runtime_error("HaltonSampler supports 1 to " +
+                             std::to_string(HaltonMaxDimension) +
+                             " dimensions");
+  if (scramble == Scramble::None)
+    return;
+  const uint32_t *bases = halton_bases();
+  m_offsets.resize(dimensions);
+  size_t size = 0;
+  for (uint32_t dim = 0; dim < dimensions; ++dim) {
+    m_offsets[dim] = uint32_t(size);
+    size += bases[dim];
+  }
+  m_permutations.resize(size);
+  PCG32 rng(seed);
+  for (uint32_t dim = 0; dim < dimensions; ++dim) {
+    uint16_t *perm = m_permutations.data() + m_offsets[dim];
+    std::iota(perm, perm + bases[dim], uint16_t(0));
+    rng.shuffle(perm, perm + bases[dim]);
+  }
+}
+
+void HaltonSampler::sample(uint32_t first, size_t count, uint32_t dim,
+                           float *out) const {
+  DCHECK_LT(dim, m_dimensions);
+  const uint32_t base = halton_bases()[dim];
+  const uint16_t *perm = permutation(dim);
+  // Use k low digits per table entry, with base^k >= 64
+  uint32_t period = base, digits = 1;
+  while (period < 64) {
+    period *= base;
+    ++digits;
+  }
+  if (count < period) {
+    for (size_t i = 0; i < count; ++i)
+      out[i] = sample(uint32_t(first + i), dim);
+    return;
+  }
+
+  // low[r] holds the mirrored k low digits of r scaled by base^k, so that
+  // index q * period + r maps to (low[r] + RI(q)) / period
+  std::vector<double> low(period);
+  for (uint32_t r = 0; r < period; ++r) {
+    double v = 0.0;
+    for (uint32_t k = 0, a = r; k < digits; ++k, a /= base)
+      v = v * base + (perm ? perm[a % base] : a % base);
+    low[r] = v;
+  }
+  const double inv_period = 1.0 / period;
+  for (size_t i = 0; i < count;) {
+    uint32_t index = uint32_t(first + i), q = index / period,
+             r = index - q * period;
+    size_t n = std::min<size_t>(period - r, count - i);
+    double high = radical_inverse(q, dim);
+    for (size_t j = 0; j < n; ++j)
+      out[i + j] = to_float((low[r + j] + high) * inv_period);
+    i += n;
+  }
+}
+
+}  // namespace misaki::math
\ No newline at end of file
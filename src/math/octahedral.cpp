@@ -0,0 +1,179 @@
+#include <misaki/utils/math/octahedral.hpp>
+#include <misaki/utils/util/parallel.h>
+
+#include <cstring>
+
+namespace misaki::math {
+
+namespace {
+
+constexpr size_t Grain = 1 << 14;
+constexpr size_t Width = detail::native_width_v<float>;
+// Elements staged per block in SoA buffers, a multiple of Width
+constexpr size_t Block = 256;
+using Lanes = Array<float, Width>;
+
+void run(size_t count, bool parallel,
+         const std::function<void(size_t, size_t)> &func) {
+  if (parallel && count > Grain)
+    util::parallel_for(0, count, Grain, func);
+  else
+    func(0, count);
+}
+
+// Run `f` over the first `n` elements of `N` SoA input streams a register
+// at a time, writing `M` output streams
+template <size_t N, size_t M, typename F>
+void apply_block(float (&in)[N][Block], float (&out)[M][Block], size_t n,
+                 F &&f) {
+  for (size_t i = 0; i < n; i += Width) {
+    Lanes a[N], r[M];
+    for (size_t k = 0; k < N; ++k)
+      std::memcpy(a[k].data(), in[k] + i, sizeof(Lanes));
+    f(a, r);
+    for (size_t k = 0; k < M; ++k)
+      std::memcpy(out[k] + i, r[k].data(), sizeof(Lanes));
+  }
+}
+
+// Encode blocks of unit vectors to two codes each, `pack` combines them
+template <int Bits, bool Precise, typename Code, typename Pack>
+void encode_vectors(const TVector3<float> *in, Code *out, size_t count,
+                    bool parallel, Pack pack) {
+  run(count, parallel, [&](size_t begin, size_t end) {
+    alignas(64) float v[3][Block], q[2][Block];
+    for (size_t i = begin; i < end; i += Block) {
+      size_t n = std::min(Block, end - i);
+      for (size_t j = 0; j < Block; ++j) {
+        const TVector3<float> &p = in[i + std::min(j, n - 1)];
+        v[0][j] = p.x;
+        v[1][j] = p.y;
+        v[2][j] = p.z;
+      }
+      apply_block(v, q, n, [](const Lanes *a, Lanes *r) {
+        TVector2<Lanes> c = detail::oct_quantize<Bits, Precise>(
+            TVector3<Lanes>(a[0], a[1], a[2]));
+        r[0] = c.x;
+        r[1] = c.y;
+      });
+      for (size_t j = 0; j < n; ++j)
+        out[i + j] = pack(uint32_t(q[0][j]), uint32_t(q[1][j]));
+    }
+  });
+}
+
+template <int Bits, typename Code>
+void decode_vectors(const Code *in, TVector3<float> *out, size_t count,
+                    bool parallel) {
+  constexpr uint32_t Mask = (1u << Bits) - 1;
+  run(count, parallel, [&](size_t begin, size_t end) {
+    alignas(64) float q[2][Block], v[3][Block];
+    for (size_t i = begin; i < end; i += Block) {
+      size_t n = std::min(Block, end - i);
+      for (size_t j = 0; j < Block; ++j) {
+        uint32_t c = in[i + std::min(j, n - 1)];
+        q[0][j] = float(c & Mask);
+        q[1][j] = float(c >> Bits);
+      }
+      apply_block(q, v, n, [](const Lanes *a, Lanes *r) {
+        TVector3<Lanes> d =
+            detail::oct_dequantize<Bits>(TVector2<Lanes>(a[0], a[1]));
+        r[0] = d.x;
+        r[1] = d.y;
+        r[2] = d.z;
+      });
+      for (size_t j = 0; j < n; ++j)
+        out[i + j] = TVector3<float>(v[0][j], v[1][j], v[2][j]);
+    }
+  });
+}
+
+}  // namespace
+
+void oct32_encode(const TVector3<float> *in, uint32_t *out, size_t count,
+                  bool parallel) {
+  encode_vectors<16, false>(in, out, count, parallel,
+                            [](uint32_t u, uint32_t v) { return u | v << 16; });
+}
+
+void oct32_decode(const uint32_t *in, TVector3<float> *out, size_t count,
+                  bool parallel) {
+  decode_vectors<16>(in, out, count, parallel);
+}
+
+void oct16_encode(const TVector3<float> *in, uint16_t *out, size_t count,
+                  bool parallel) {
+  encode_vectors<8, true>(in, out, count, parallel, [](uint32_t u, uint32_t v) {
+    return uint16_t(u | v << 8);
+  });
+}
+
+void oct16_decode(const uint16_t *in, TVector3<float> *out, size_t count,
+                  bool parallel) {
+  decode_vectors<8>(in, out, count, parallel);
+}
+
+void frame32_encode(const TFrame<float> *in, uint32_t *out, size_t count,
+                    bool parallel) {
+  run(count, parallel, [&](size_t begin, size_t end) {
+    alignas(64) float f[9][Block], q[4][Block];
+    for (size_t i = begin; i < end; i += Block) {
+      size_t n = std::min(Block, end - i);
+      for (size_t j = 0; j < Block; ++j) {
+        const TFrame<float> &p = in[i + std::min(j, n - 1)];
+        for (size_t k = 0; k < 3; ++k) {
+          f[k][j] = p.s[k];
+          f[3 + k][j] = p.t[k];
+          f[6 + k][j] = p.n[k];
+        }
+      }
+      apply_block(f, q, n, [](const Lanes *a, Lanes *r) {
+        TFrame<Lanes> frame(TVector3<Lanes>(a[0], a[1], a[2]),
+                            TVector3<Lanes>(a[3], a[4], a[5]),
+                            TVector3<Lanes>(a[6], a[7], a[8]));
+        TVector4<Lanes> c = detail::frame_quantize(frame);
+        for (size_t k = 0; k < 4; ++k) r[k] = c[k];
+      });
+      for (size_t j = 0; j < n; ++j)
+        out[i + j] = uint32_t(q[0][j]) |
+                     uint32_t(q[1][j]) << detail::FrameNormalBits |
+                     uint32_t(q[2][j]) << (2 * detail::FrameNormalBits) |
+                     uint32_t(q[3][j]) << 31;
+    }
+  });
+}
+
+void frame32_decode(const uint32_t *in, TFrame<float> *out, size_t count,
+                    bool parallel) {
+  constexpr uint32_t NormalMask = (1u << detail::FrameNormalBits) - 1,
+                     AngleMask = (1u << detail::FrameAngleBits) - 1;
+  run(count, parallel, [&](size_t begin, size_t end) {
+    alignas(64) float q[4][Block], f[9][Block];
+    for (size_t i = begin; i < end; i += Block) {
+      size_t n = std::min(Block, end - i);
+      for (size_t j = 0; j < Block; ++j) {
+        uint32_t c = in[i + std::min(j, n - 1)];
+        q[0][j] = float(c & NormalMask);
+        q[1][j] = float((c >> detail::FrameNormalBits) & NormalMask);
+        q[2][j] = float((c >> (2 * detail::FrameNormalBits)) & AngleMask);
+        q[3][j] = float(c >> 31);
+      }
+      apply_block(q, f, n, [](const Lanes *a, Lanes *r) {
+        TFrame<Lanes> frame = detail::frame_dequantize(
+            TVector4<Lanes>(a[0], a[1], a[2], a[3]));
+        for (size_t k = 0; k < 3; ++k) {
+          r[k] = frame.s[k];
+          r[3 + k] = frame.t[k];
+          r[6 + k] = frame.n[k];
+        }
+      });
+      for (size_t j = 0; j < n; ++j)
+        out[i + j] = TFrame<float>(
+            TVector3<float>(f[0][j], f[1][j], f[2][j]),
+            TVector3<float>(f[3][j], f[4][j], f[5][j]),
+            TVector3<float>(f[6][j], f[7][j], f[8][j]));
+    }
+  });
+}
+
+}  // namespace misaki::math
\ No newline at end of file
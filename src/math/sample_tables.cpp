@@ -0,0 +1,358 @@
+#include <misaki/utils/math/random.hpp>
+#include <misaki/utils/math/sample_tables.hpp>
+#include <misaki/utils/system/mmap.h>
+#include <misaki/utils/util/parallel.h>
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <numeric>
+#include <stdexcept>
+
+namespace misaki::math {
+
+namespace {
+
+// File layout: magic, byte order mark, type, sets, count, dimensions, then
+// the float entries, all in the byte order of the writing host
+constexpr char FileMagic[8] = {'M', 'S', 'K', 'S', 'M', 'P', 'T', '1'};
+constexpr uint32_t ByteOrderMark = 0x01020304u;
+constexpr size_t HeaderSize = sizeof(FileMagic) + 5 * sizeof(uint32_t);
+
+int log2_floor(uint32_t v) {
+  int r = 0;
+  while (v >>= 1) ++r;
+  return r;
+}
+
+// PMJ02 construction on 32-bit fixed point coordinates, so that the strata
+// of a point never change when it is rounded
+class PMJ02Builder {
+ public:
+  explicit PMJ02Builder(uint32_t seed) : m_rng(seed) {}
+
+  std::vector<TVector2<float>> build(uint32_t count) {
+    m_points.reserve(count);
+    m_points.push_back({m_rng.next_uint32(), m_rng.next_uint32()});
+    // Alternate between doubling a square number of points (new points go
+    // diagonally opposite the old ones in their cell) and doubling from 2n^2
+    // points (new points fill the two empty quarters of each cell)
+    for (uint32_t n = 1; m_points.size() < count; n *= 2) {
+      extend_even(n);
+      if (m_points.size() < count)
+        extend_odd(n);
+    }
+    std::vector<TVector2<float>> ret(count);
+    for (uint32_t i = 0; i < count; ++i)
+      ret[i] = {(m_points[i].first >> 8) * (1.f / 16777216.f),
+                (m_points[i].second >> 8) * (1.f / 16777216.f)};
+    return ret;
+  }
+
+ private:
+  using Point = std::pair<uint32_t, uint32_t>;
+
+  // Strata of the next 2^m points: for each k, a 2^k x 2^(m - k) grid
+  void begin_level(size_t total) {
+    m_bits = log2_floor(uint32_t(total));
+    m_occupied.assign(size_t(m_bits + 1) << m_bits, 0);
+    for (const Point &p : m_points)
+      mark(p.first >> (32 - m_bits), p.second >> (32 - m_bits));
+  }
+
+  size_t cell(int k, uint32_t x, uint32_t y) const {
+    int shift = m_bits - k;
+    return (size_t(k) << m_bits) + (size_t(x >> shift) << shift) + (y >> k);
+  }
+
+  void mark(uint32_t x, uint32_t y) {
+    for (int k = 0; k <= m_bits; ++k) m_occupied[cell(k, x, y)] = 1;
+  }
+
+  void extend_even(uint32_t n) {
+    size_t count = m_points.size();
+    begin_level(2 * count);
+    int grid = log2_floor(n);
+    for (size_t s = 0; s < count; ++s) {
+      auto [x, y] = m_points[s];
+      uint32_t cx = x >> (31 - grid), cy = y >> (31 - grid);
+      if (!place(cx ^ 1u, cy ^ 1u, grid + 1))
+        throw std::runtime_error("PMJ02 construction failed");
+    }
+  }
+
+  void extend_odd(uint32_t n) {
+    size_t count = m_points.size(), half = count / 2;
+    begin_level(2 * count);
+    int grid = log2_floor(n);
+    // Both old points of a cell sit in diagonal quarters, the quarter next to
+    // point s is picked at random and the last one is left for the second
+    // pass
+    std::vector<uint8_t> flip_x(half);
+    for (size_t s = 0; s < half; ++s) {
+      auto [x, y] = m_points[s];
+      uint32_t cx = x >> (31 - grid), cy = y >> (31 - grid);
+      flip_x[s] = uint8_t(m_rng.next_uint32() & 1);
+      if (!place(cx ^ flip_x[s], cy ^ (flip_x[s] ^ 1u), grid + 1)) {
+        flip_x[s] ^= 1;
+        if (!place(cx ^ flip_x[s], cy ^ (flip_x[s] ^ 1u), grid + 1))
+          throw std::runtime_error("PMJ02 construction failed");
+      }
+    }
+    for (size_t s = 0; s < half; ++s) {
+      auto [x, y] = m_points[s];
+      uint32_t cx = x >> (31 - grid), cy = y >> (31 - grid);
+      if (!place(cx ^ (flip_x[s] ^ 1u), cy ^ flip_x[s], grid + 1))
+        throw std::runtime_error("PMJ02 construction failed");
+    }
+  }
+
+  // Add a point inside quarter (qx, qy) of a 2^grid x 2^grid subdivision
+  // whose strata are all free. x is drawn among the free columns, y by a
+  // randomized depth-first search over its bits, most significant first.
+  bool place(uint32_t qx, uint32_t qy, int grid) {
+    int free_bits = m_bits - grid;
+    m_columns.clear();
+    for (uint32_t x = qx << free_bits; x < (qx + 1) << free_bits; ++x)
+      if (!m_occupied[cell(m_bits, x, 0)])
+        m_columns.push_back(x);
+    m_rng.shuffle(m_columns.begin(), m_columns.end());
+    for (uint32_t x : m_columns) {
+      uint32_t y;
+      if (search_y(x, qy, grid, &y)) {
+        mark(x, y);
+        uint32_t jitter = 32 - m_bits;
+        uint32_t mask = jitter == 32 ? ~0u : (1u << jitter) - 1;
+        m_points.push_back({(x << jitter) | (m_rng.next_uint32() & mask),
+                            (y << jitter) | (m_rng.next_uint32() & mask)});
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // The stratum of shape k involves the top m - k bits of y
+  bool search_y(uint32_t x, uint32_t prefix, int bits, uint32_t *y) {
+    for (int t = 0; t <= bits; ++t)
+      if (m_occupied[cell(m_bits - t, x, (prefix >> (bits - t))
+                                             << (m_bits - t))])
+        return false;
+    if (bits == m_bits) {
+      *y = prefix;
+      return true;
+    }
+    uint32_t first = m_rng.next_uint32() & 1;
+    return search_y(x, prefix << 1 | first, bits + 1, y) ||
+           search_y(x, prefix << 1 | (first ^ 1), bits + 1, y);
+  }
+
+  PCG32 m_rng;
+  std::vector<Point> m_points;
+  std::vector<uint8_t> m_occupied;
+  std::vector<uint32_t> m_columns;
+  int m_bits = 0;
+};
+
+void run_sets(uint32_t sets, bool parallel,
+              const std::function<void(uint32_t)> &func) {
+  auto body = [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) func(uint32_t(i));
+  };
+  if (parallel && sets > 1)
+    util::parallel_for(0, sets, 1, body);
+  else
+    body(0, sets);
+}
+
+}  // namespace
+
+std::vector<TVector2<float>> generate_pmj02(uint32_t count, uint32_t seed) {
+  if (count == 0 || count > (1u << 20))
+    throw std::runtime_error("PMJ02 supports 1 to 2^20 points");
+  return PMJ02Builder(seed).build(count);
+}
+
+std::vector<float> generate_blue_noise(uint32_t resolution, uint32_t seed) {
+  if (resolution < 4 || resolution > 256)
+    throw std::runtime_error("Blue noise masks support 4 to 256 texels");
+  const uint32_t size = resolution * resolution;
+  // Gaussian energy with sigma = 1.5, cut off where it drops below 1e-4 but
+  // kept within one period so the total energy of the torus stays uniform
+  constexpr float Sigma = 1.5f;
+  const int radius = std::min(6, int(resolution - 1) / 2);
+  const int width = 2 * radius + 1;
+  std::vector<float> kernel(width * width);
+  for (int dy = -radius; dy <= radius; ++dy)
+    for (int dx = -radius; dx <= radius; ++dx)
+      kernel[(dy + radius) * width + dx + radius] =
+          std::exp(-float(dx * dx + dy * dy) / (2 * Sigma * Sigma));
+
+  std::vector<uint8_t> pattern(size, 0);
+  std::vector<float> energy(size, 0.f);
+  auto toggle = [&](std::vector<uint8_t> &bits, std::vector<float> &e,
+                    uint32_t p) {
+    float sign = bits[p] ? -1.f : 1.f;
+    bits[p] ^= 1;
+    int px = int(p % resolution), py = int(p / resolution);
+    for (int dy = -radius; dy <= radius; ++dy) {
+      uint32_t row = uint32_t((py + dy + int(resolution)) % int(resolution));
+      const float *k = kernel.data() + (dy + radius) * width + radius;
+      for (int dx = -radius; dx <= radius; ++dx) {
+        uint32_t col = uint32_t((px + dx + int(resolution)) % int(resolution));
+        e[row * resolution + col] += sign * k[dx];
+      }
+    }
+  };
+  // Tightest cluster: the set texel of highest energy. Largest void: the
+  // empty texel of lowest energy.
+  auto tightest_cluster = [&](const std::vector<uint8_t> &bits,
+                     const std::vector<float> &e) {
+    uint32_t best = 0;
+    float best_e = -Infinity<float>;
+    for (uint32_t p = 0; p < size; ++p)
+      if (bits[p] && e[p] > best_e) {
+        best_e = e[p];
+        best = p;
+      }
+    return best;
+  };
+  auto largest_void = [&](const std::vector<uint8_t> &bits,
+                   const std::vector<float> &e) {
+    uint32_t best = 0;
+    float best_e = Infinity<float>;
+    for (uint32_t p = 0; p < size; ++p)
+      if (!bits[p] && e[p] < best_e) {
+        best_e = e[p];
+        best = p;
+      }
+    return best;
+  };
+
+  // Initial pattern: 10% random texels, relaxed by moving the tightest
+  // cluster into the largest void until that no longer changes anything
+  PCG32 rng(seed);
+  std::vector<uint32_t> order(size);
+  std::iota(order.begin(), order.end(), 0u);
+  rng.shuffle(order.begin(), order.end());
+  const uint32_t initial = std::max(1u, size / 10);
+  for (uint32_t i = 0; i < initial; ++i) toggle(pattern, energy, order[i]);
+  for (uint32_t iter = 0; iter < size; ++iter) {
+    uint32_t c = tightest_cluster(pattern, energy);
+    toggle(pattern, energy, c);
+    uint32_t v = largest_void(pattern, energy);
+    toggle(pattern, energy, v);
+    if (v == c)
+      break;
+  }
+
+  std::vector<uint32_t> rank(size);
+  // Ranks below the initial pattern: remove tightest clusters one by one
+  {
+    std::vector<uint8_t> bits = pattern;
+    std::vector<float> e = energy;
+    for (uint32_t r = initial; r-- > 0;) {
+      uint32_t c = tightest_cluster(bits, e);
+      toggle(bits, e, c);
+      rank[c] = r;
+    }
+  }
+  // Ranks above: fill the largest voids. Past half full this is the same as
+  // removing the tightest clusters of empty texels, since the kernel sums to
+  // a constant over the torus.
+  for (uint32_t r = initial; r < size; ++r) {
+    uint32_t v = largest_void(pattern, energy);
+    toggle(pattern, energy, v);
+    rank[v] = r;
+  }
+
+  std::vector<float> ret(size);
+  for (uint32_t p = 0; p < size; ++p) ret[p] = (rank[p] + .5f) / size;
+  return ret;
+}
+
+SampleTable generate_pmj02_table(uint32_t sets, uint32_t count, uint32_t seed,
+                                 bool parallel) {
+  std::vector<float> data(size_t(sets) * count * 2);
+  run_sets(sets, parallel, [&](uint32_t set) {
+    std::vector<TVector2<float>> points =
+        generate_pmj02(count, sample_tea_32(seed, set));
+    float *out = data.data() + size_t(set) * count * 2;
+    for (uint32_t i = 0; i < count; ++i) {
+      out[2 * i] = points[i].x;
+      out[2 * i + 1] = points[i].y;
+    }
+  });
+  return SampleTable(SampleTable::Type::PMJ02, sets, count, 2,
+                     std::move(data));
+}
+
+SampleTable generate_blue_noise_table(uint32_t sets, uint32_t resolution,
+                                      uint32_t seed, bool parallel) {
+  const size_t size = size_t(resolution) * resolution;
+  std::vector<float> data(sets * size);
+  run_sets(sets, parallel, [&](uint32_t set) {
+    std::vector<float> mask =
+        generate_blue_noise(resolution, sample_tea_32(seed, set));
+    std::copy(mask.begin(), mask.end(), data.begin() + set * size);
+  });
+  return SampleTable(SampleTable::Type::BlueNoise, sets, uint32_t(size), 1,
+                     std::move(data));
+}
+
+SampleTable::SampleTable(Type type, uint32_t sets, uint32_t count,
+                         uint32_t dimensions, std::vector<float> data)
+    : m_type(type), m_sets(sets), m_count(count), m_dimensions(dimensions) {
+  if (data.size() != size_t(sets) * count * dimensions)
+    throw std::runtime_error("SampleTable data has the wrong size");
+  auto owner = std::make_shared<const std::vector<float>>(std::move(data));
+  m_data = owner->data();
+  m_owner = owner;
+  m_resolution = type == Type::BlueNoise
+                     ? uint32_t(std::lround(std::sqrt(double(count))))
+                     : 0;
+}
+
+SampleTable::SampleTable(const std::string &filename) {
+  auto file = std::make_shared<system::MemoryMappedFile>(filename);
+  const char *bytes = static_cast<const char *>(file->data());
+  if (file->size() < HeaderSize ||
+      std::memcmp(bytes, FileMagic, sizeof(FileMagic)) != 0)
+    throw std::runtime_error("\"" + filename + "\" is not a sample table");
+  uint32_t header[5];
+  std::memcpy(header, bytes + sizeof(FileMagic), sizeof(header));
+  if (header[0] != ByteOrderMark)
+    throw std::runtime_error("Sample table \"" + filename +
+                             "\" was written with the other byte order");
+  m_type = Type(header[1]);
+  m_sets = header[2];
+  m_count = header[3];
+  m_dimensions = header[4];
+  if ((m_type != Type::PMJ02 && m_type != Type::BlueNoise) ||
+      file->size() !=
+          HeaderSize + size_t(m_sets) * m_count * m_dimensions * sizeof(float))
+    throw std::runtime_error("Sample table \"" + filename +
+                             "\" has an invalid header");
+  m_data = reinterpret_cast<const float *>(bytes + HeaderSize);
+  m_owner = file;
+  m_resolution = m_type == Type::BlueNoise
+                     ? uint32_t(std::lround(std::sqrt(double(m_count))))
+                     : 0;
+}
+
+void SampleTable::write(const std::string &filename) const {
+  std::ofstream os(filename, std::ios::binary);
+  if (!os)
+    throw std::runtime_error("Could not open \"" + filename + "\"");
+  uint32_t header[5] = {ByteOrderMark, uint32_t(m_type), m_sets, m_count,
+                        m_dimensions};
+  os.write(FileMagic, sizeof(FileMagic));
+  os.write(reinterpret_cast<const char *>(header), sizeof(header));
+  os.write(reinterpret_cast<const char *>(m_data),
+           std::streamsize(size_t(m_sets) * m_count * m_dimensions *
+                           sizeof(float)));
+  if (!os)
+    throw std::runtime_error("Could not write \"" + filename + "\"");
+}
+
+}  // namespace misaki::math
\ No newline at end of file
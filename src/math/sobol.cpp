@@ -0,0 +1,126 @@
+#include <misaki/utils/math/sobol.hpp>
+#include <misaki/utils/system/mmap.h>
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace misaki::math {
+
+namespace detail {
+extern const uint16_t SOBOL_POLYNOMIALS[SobolMaxDimension - 1];
+extern const uint16_t SOBOL_MINIT[];
+}  // namespace detail
+
+namespace {
+
+// File layout: magic, byte order mark, dimension count, then 32 columns per
+// dimension, all uint32 in the byte order of the writing host. The mapped
+// columns are used in place, so files are not converted on load.
+constexpr char FileMagic[8] = {'M', 'S', 'K', 'S', 'O', 'B', 'L', '1'};
+constexpr uint32_t ByteOrderMark = 0x01020304u;
+constexpr size_t HeaderSize = sizeof(FileMagic) + 2 * sizeof(uint32_t);
+
+int degree(uint32_t poly) {
+  int d = 0;
+  while (poly >>= 1) ++d;
+  return d;
+}
+
+// Direction numbers by the Bratley-Fox recurrence, scaled to 32-bit columns
+std::vector<uint32_t> build_matrices() {
+  std::vector<uint32_t> data(size_t(SobolMaxDimension) * 32);
+  // Dimension 0 is the van der Corput sequence
+  for (int j = 0; j < 32; ++j) data[j] = 1u << (31 - j);
+  const uint16_t *minit = detail::SOBOL_MINIT;
+  for (uint32_t dim = 1; dim < SobolMaxDimension; ++dim) {
+    uint32_t poly = detail::SOBOL_POLYNOMIALS[dim - 1];
+    int d = degree(poly);
+    uint32_t m[32];
+    for (int j = 0; j < d; ++j) m[j] = *minit++;
+    for (int j = d; j < 32; ++j) {
+      m[j] = m[j - d] ^ (m[j - d] << d);
+      for (int k = 1; k < d; ++k)
+        if ((poly >> (d - k)) & 1)
+          m[j] ^= m[j - k] << k;
+    }
+    uint32_t *column = data.data() + size_t(dim) * 32;
+    for (int j = 0; j < 32; ++j) column[j] = m[j] << (31 - j);
+  }
+  return data;
+}
+
+}  // namespace
+
+SobolTable::SobolTable() {
+  static const std::shared_ptr<const std::vector<uint32_t>> builtin =
+      std::make_shared<const std::vector<uint32_t>>(build_matrices());
+  m_owner = builtin;
+  m_data = builtin->data();
+  m_dimensions = SobolMaxDimension;
+}
+
+SobolTable::SobolTable(const std::string &filename) {
+  auto file = std::make_shared<system::MemoryMappedFile>(filename);
+  const char *bytes = static_cast<const char *>(file->data());
+  if (file->size() < HeaderSize ||
+      std::memcmp(bytes, FileMagic, sizeof(FileMagic)) != 0)
+    throw std::runtime_error("\"" + filename + "\" is not a Sobol table");
+  uint32_t header[2];
+  std::memcpy(header, bytes + sizeof(FileMagic), sizeof(header));
+  if (header[0] != ByteOrderMark)
+    throw std::runtime_error("Sobol table \"" + filename +
+                             "\" was written with the other byte order");
+  m_dimensions = header[1];
+  if (m_dimensions == 0 ||
+      file->size() != HeaderSize + size_t(m_dimensions) * 32 * sizeof(uint32_t))
+    throw std::runtime_error("Sobol table \"" + filename +
+                             "\" has an invalid size");
+  m_data = reinterpret_cast<const uint32_t *>(bytes + HeaderSize);
+  m_owner = file;
+}
+
+void SobolTable::write(const std::string &filename) const {
+  std::ofstream os(filename, std::ios::binary);
+  if (!os)
+    throw std::runtime_error("Could not open \"" + filename + "\"");
+  uint32_t header[2] = {ByteOrderMark, m_dimensions};
+  os.write(FileMagic, sizeof(FileMagic));
+  os.write(reinterpret_cast<const char *>(header), sizeof(header));
+  os.write(reinterpret_cast<const char *>(m_data),
+           std::streamsize(size_t(m_dimensions) * 32 * sizeof(uint32_t)));
+  if (!os)
+    throw std::runtime_error("Could not write \"" + filename + "\"");
+}
+
+SobolSampler::SobolSampler(uint32_t seed, Scramble scramble,
+                           const SobolTable &table)
+    : m_table(table), m_seed(seed), m_scramble(scramble) {}
+
+void SobolSampler::sample(uint32_t first, size_t count, uint32_t dim,
+                          float *out) const {
+  const uint32_t *m = m_table.matrix(dim);
+  // The low 8 index bits go through a table, the others change once per 256
+  // consecutive indices
+  uint32_t low[256], v[256];
+  low[0] = 0;
+  for (int b = 0; b < 8; ++b)
+    for (uint32_t k = 1u << b; k < 2u << b; ++k)
+      low[k] = low[k - (1u << b)] ^ m[b];
+
+  uint32_t seed = dim_seed(dim);
+  for (size_t i = 0; i < count;) {
+    uint32_t index = uint32_t(first + i), offset = index & 255u;
+    size_t n = std::min<size_t>(256 - offset, count - i);
+    uint32_t high = 0;
+    for (uint32_t bits = index >> 8, j = 8; bits; bits >>= 1, ++j)
+      if (bits & 1)
+        high ^= m[j];
+    for (size_t j = 0; j < n; ++j) v[j] = high ^ low[offset + j];
+    finish(v, seed, out + i, n);
+    i += n;
+  }
+}
+
+}  // namespace misaki::math
\ No newline at end of file
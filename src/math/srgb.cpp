@@ -0,0 +1,121 @@
+#include <misaki/utils/math/fastmath.hpp>
+#include <misaki/utils/math/srgb.hpp>
+#include <misaki/utils/util/parallel.h>
+
+#include <cmath>
+
+namespace misaki::math {
+
+namespace {
+
+constexpr size_t Grain = 1 << 16;
+constexpr size_t Width = detail::native_width_v<float>;
+using Lanes = Array<float, Width>;
+
+Lanes encode(const Lanes &v) {
+  Lanes curve = Lanes(1.055f) * fast_pow(v, Lanes(1.f / 2.4f)) - 0.055f;
+  return select(v <= Lanes(0.0031308f), v * 12.92f, curve);
+}
+
+Lanes decode(const Lanes &v) {
+  Lanes curve = fast_pow((v + 0.055f) * (1.f / 1.055f), Lanes(2.4f));
+  return select(v <= Lanes(0.04045f), v * (1.f / 12.92f), curve);
+}
+
+// Apply `f` to [begin, end) one register at a time, the tail is padded
+template <typename F>
+void apply_lanes(const float *in, float *out, size_t begin, size_t end,
+                 F &&f) {
+  Lanes v;
+  size_t i = begin;
+  // Constant size copies of full registers compile to plain loads and stores
+  for (; i + Width <= end; i += Width) {
+    std::memcpy(v.data(), in + i, Width * sizeof(float));
+    v = f(v);
+    std::memcpy(out + i, v.data(), Width * sizeof(float));
+  }
+  if (i < end) {
+    size_t n = end - i;
+    v = Lanes(0.f);
+    std::memcpy(v.data(), in + i, n * sizeof(float));
+    v = f(v);
+    std::memcpy(out + i, v.data(), n * sizeof(float));
+  }
+}
+
+void run(size_t count, bool parallel,
+         const std::function<void(size_t, size_t)> &func) {
+  if (parallel && count > Grain)
+    util::parallel_for(0, count, Grain, func);
+  else
+    func(0, count);
+}
+
+// Uniform value in [0, 1) from an integer hash of the index
+inline float hash_float(uint32_t x) {
+  x ^= x >> 16;
+  x *= 0x7feb352du;
+  x ^= x >> 15;
+  x *= 0x846ca68bu;
+  x ^= x >> 16;
+  return float(x >> 8) * (1.f / 16777216.f);
+}
+
+}  // namespace
+
+const float *srgb8_to_linear_table() {
+  static const struct Table {
+    float values[256];
+    Table() {
+      for (int i = 0; i < 256; ++i) {
+        double v = i / 255.0;
+        values[i] = float(v <= 0.04045 ? v / 12.92
+                                       : std::pow((v + 0.055) / 1.055, 2.4));
+      }
+    }
+  } table;
+  return table.values;
+}
+
+void linear_to_srgb8(const float *in, uint8_t *out, size_t count, bool dither,
+                     bool parallel) {
+  run(count, parallel, [&](size_t begin, size_t end) {
+    float buf[256];
+    for (size_t i = begin; i < end; i += 256) {
+      size_t n = std::min<size_t>(256, end - i);
+      apply_lanes(in + i, buf, 0, n, [](const Lanes &v) {
+        return encode(clamp(v, Lanes(0.f), Lanes(1.f))) * 255.f + .5f;
+      });
+      if (dither) {
+        for (size_t j = 0; j < n; ++j) {
+          uint32_t k = uint32_t(i + j) * 2;
+          buf[j] += hash_float(k) + hash_float(k + 1) - 1.f;
+        }
+      }
+      for (size_t j = 0; j < n; ++j)
+        out[i + j] = uint8_t(std::min(std::max(buf[j], 0.f), 255.f));
+    }
+  });
+}
+
+void srgb8_to_linear(const uint8_t *in, float *out, size_t count,
+                     bool parallel) {
+  const float *table = srgb8_to_linear_table();
+  run(count, parallel, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) out[i] = table[in[i]];
+  });
+}
+
+void linear_to_srgb(const float *in, float *out, size_t count, bool parallel) {
+  run(count, parallel, [&](size_t begin, size_t end) {
+    apply_lanes(in, out, begin, end, encode);
+  });
+}
+
+void srgb_to_linear(const float *in, float *out, size_t count, bool parallel) {
+  run(count, parallel, [&](size_t begin, size_t end) {
+    apply_lanes(in, out, begin, end, decode);
+  });
+}
+
+}  // namespace misaki::math
\ No newline at end of file
@@ -0,0 +1,73 @@
+#include <misaki/utils/system/mmap.h>
+
+#include <stdexcept>
+
+#if MSK_PLATFORM_WINDOWS
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace misaki::system {
+
+MemoryMappedFile::MemoryMappedFile(const std::filesystem::path &filename)
+    : m_filename(filename) {
+#if MSK_PLATFORM_WINDOWS
+  m_file = CreateFileW(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                       OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (m_file == INVALID_HANDLE_VALUE)
+    throw std::runtime_error("Could not open \"" + filename.string() + "\"");
+  LARGE_INTEGER size;
+  GetFileSizeEx(m_file, &size);
+  m_size = size_t(size.QuadPart);
+  if (m_size > 0) {
+    m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_mapping)
+      m_data = MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!m_data) {
+      if (m_mapping)
+        CloseHandle(m_mapping);
+      CloseHandle(m_file);
+      throw std::runtime_error("Could not map \"" + filename.string() + "\"");
+    }
+  }
+#else
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd == -1)
+    throw std::runtime_error("Could not open \"" + filename.string() + "\"");
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    throw std::runtime_error("Could not stat \"" + filename.string() + "\"");
+  }
+  m_size = size_t(st.st_size);
+  if (m_size > 0) {
+    void *ptr = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (ptr == MAP_FAILED) {
+      close(fd);
+      throw std::runtime_error("Could not map \"" + filename.string() + "\"");
+    }
+    m_data = ptr;
+  }
+  // The mapping stays valid after the descriptor is closed
+  close(fd);
+#endif
+}
+
+MemoryMappedFile::~MemoryMappedFile() {
+#if MSK_PLATFORM_WINDOWS
+  if (m_data)
+    UnmapViewOfFile(m_data);
+  if (m_mapping)
+    CloseHandle(m_mapping);
+  CloseHandle(m_file);
+#else
+  if (m_data)
+    munmap(const_cast<void *>(m_data), m_size);
+#endif
+}
+
+}  // namespace misaki::system
\ No newline at end of file
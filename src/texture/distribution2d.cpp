@@ -0,0 +1,116 @@
+#include <misaki/utils/texture/distribution2d.h>
+#include <misaki/utils/util/parallel.h>
+
+#include <functional>
+#include <limits>
+#include <stdexcept>
+
+namespace misaki::texture {
+
+namespace {
+
+constexpr size_t Grain = 1 << 14;
+
+void run(size_t count, size_t grain, bool parallel,
+         const std::function<void(size_t, size_t)> &func) {
+  if (parallel && count > grain)
+    util::parallel_for(0, count, grain, func);
+  else
+    func(0, count);
+}
+
+// Normalized running sum of `n` values, exactly 1 at the end. A zero sum
+// gives a uniform CDF.
+void build_cdf(const double *values, size_t n, double sum, float *cdf) {
+  if (sum > 0.0) {
+    double run = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+      run += values[i];
+      cdf[i] = float(run / sum);
+    }
+  } else {
+    for (size_t i = 0; i < n; ++i) cdf[i] = float(double(i + 1) / n);
+  }
+  const float last = cdf[n - 1];
+  for (size_t i = n; i-- > 0 && cdf[i] >= last;) cdf[i] = 1.f;
+}
+
+std::vector<float> luminance(const math::TColor3<float> *pixels, size_t count,
+                             bool parallel) {
+  std::vector<float> ret(count);
+  run(count, Grain, parallel, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i)
+      ret[i] = std::max(pixels[i].luminance(), 0.f);
+  });
+  return ret;
+}
+
+}  // namespace
+
+Distribution2D::Distribution2D(const float *values, uint32_t width,
+                               uint32_t height, bool parallel)
+    : m_width(width), m_height(height) {
+  if (width == 0 || height == 0)
+    throw std::runtime_error("Distribution2D needs a non-empty grid");
+  m_inv_width = 1.f / width;
+  m_inv_height = 1.f / height;
+  m_texels = float(double(width) * height);
+  m_row_blocks = (width + BlockSize - 1) / BlockSize;
+  m_conditional.resize(size_t(width) * height);
+  m_blocks.resize(size_t(m_row_blocks) * height);
+  std::vector<double> row_sums(height);
+  std::vector<uint8_t> valid(height);
+
+  size_t rows_per_chunk = std::max<size_t>(1, Grain / width);
+  run(height, rows_per_chunk, parallel, [&](size_t begin, size_t end) {
+    std::vector<double> row_values(width);
+    for (size_t y = begin; y < end; ++y) {
+      const float *v = values + y * width;
+      double sum = 0.0;
+      bool ok = true;
+      for (uint32_t x = 0; x < width; ++x) {
+        ok &= v[x] >= 0.f && v[x] <= std::numeric_limits<float>::max();
+        row_values[x] = v[x];
+        sum += v[x];
+      }
+      float *cdf = m_conditional.data() + y * width;
+      build_cdf(row_values.data(), width, sum, cdf);
+      for (uint32_t b = 0; b < m_row_blocks; ++b)
+        m_blocks[y * m_row_blocks + b] =
+            cdf[std::min((b + 1) * BlockSize, width) - 1];
+      row_sums[y] = sum;
+      valid[y] = ok;
+    }
+  });
+
+  for (uint32_t y = 0; y < height; ++y) {
+    if (!valid[y])
+      throw std::runtime_error("Distribution2D values must be finite and "
+                               "non-negative");
+    m_sum += row_sums[y];
+  }
+  if (!(m_sum > 0.0))
+    throw std::runtime_error("Distribution2D values sum to zero");
+  m_marginal.resize(height);
+  build_cdf(row_sums.data(), height, m_sum, m_marginal.data());
+}
+
+Distribution2D::Distribution2D(const math::TColor3<float> *pixels,
+                               uint32_t width, uint32_t height, bool parallel)
+    : Distribution2D(luminance(pixels, size_t(width) * height, parallel).data(),
+                     width, height, parallel) {}
+
+void Distribution2D::sample(const math::TVector2<float> *u,
+                            math::TVector2<float> *out, float *pdf,
+                            size_t count, bool parallel) const {
+  run(count, Grain, parallel, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      auto [p, density] = sample(u[i]);
+      out[i] = p;
+      if (pdf)
+        pdf[i] = density;
+    }
+  });
+}
+
+}  // namespace misaki::texture
\ No newline at end of file
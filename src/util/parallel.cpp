@@ -0,0 +1,154 @@
+#include <misaki/utils/util/parallel.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace misaki::util {
+
+namespace {
+
+struct Job {
+  const std::function<void(size_t, size_t)> *func;
+  size_t begin, end, grain, chunks;
+  std::atomic<size_t> next{0}, finished{0};
+  std::mutex mutex;
+  std::condition_variable done;
+  std::exception_ptr error;
+
+  bool exhausted() const { return next.load() >= chunks; }
+
+  void run() {
+    for (;;) {
+      size_t chunk = next++;
+      if (chunk >= chunks)
+        break;
+      size_t b = begin + chunk * grain, e = std::min(b + grain, end);
+      try {
+        (*func)(b, e);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!error)
+          error = std::current_exception();
+      }
+      if (++finished == chunks) {
+        std::lock_guard<std::mutex> lock(mutex);
+        done.notify_all();
+      }
+    }
+  }
+};
+
+class ThreadPool {
+ public:
+  explicit ThreadPool(size_t thread_count) {
+    for (size_t i = 1; i < thread_count; ++i)
+      m_workers.emplace_back([this] { work(); });
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_cv.notify_all();
+    for (auto &w : m_workers) w.join();
+  }
+
+  size_t size() const { return m_workers.size() + 1; }
+
+  void run(const std::shared_ptr<Job> &job) {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_jobs.push_back(job);
+    }
+    m_cv.notify_all();
+
+    job->run();
+    {
+      std::unique_lock<std::mutex> lock(job->mutex);
+      job->done.wait(lock, [&] { return job->finished.load() == job->chunks; });
+    }
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_jobs.erase(std::remove(m_jobs.begin(), m_jobs.end(), job), m_jobs.end());
+    }
+  }
+
+ private:
+  void work() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+      m_cv.wait(lock, [&] { return m_stop || !m_jobs.empty(); });
+      if (m_stop)
+        return;
+      std::shared_ptr<Job> job = m_jobs.front();
+      if (job->exhausted()) {
+        m_jobs.pop_front();
+        continue;
+      }
+      lock.unlock();
+      job->run();
+      lock.lock();
+    }
+  }
+
+  std::vector<std::thread> m_workers;
+  std::deque<std::shared_ptr<Job>> m_jobs;
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  bool m_stop = false;
+};
+
+std::unique_ptr<ThreadPool> GLOBAL_POOL;
+std::mutex GLOBAL_POOL_MUTEX;
+
+ThreadPool &pool() {
+  std::lock_guard<std::mutex> lock(GLOBAL_POOL_MUTEX);
+  if (!GLOBAL_POOL)
+    GLOBAL_POOL = std::make_unique<ThreadPool>(
+        std::max(1u, std::thread::hardware_concurrency()));
+  return *GLOBAL_POOL;
+}
+
+}  // namespace
+
+void init_parallel(size_t thread_count) {
+  if (thread_count == 0)
+    thread_count = std::max(1u, std::thread::hardware_concurrency());
+  std::lock_guard<std::mutex> lock(GLOBAL_POOL_MUTEX);
+  GLOBAL_POOL = std::make_unique<ThreadPool>(thread_count);
+}
+
+size_t thread_count() { return pool().size(); }
+
+void parallel_for(size_t begin, size_t end, size_t grain,
+                  const std::function<void(size_t, size_t)> &func) {
+  if (end <= begin)
+    return;
+  grain = std::max<size_t>(grain, 1);
+  size_t chunks = (end - begin + grain - 1) / grain;
+  ThreadPool &p = pool();
+  if (chunks == 1 || p.size() == 1) {
+    func(begin, end);
+    return;
+  }
+
+  auto job = std::make_shared<Job>();
+  job->func = &func;
+  job->begin = begin;
+  job->end = end;
+  job->grain = grain;
+  job->chunks = chunks;
+  p.run(job);
+  if (job->error)
+    std::rethrow_exception(job->error);
+}
+
+}  // namespace misaki::util
\ No newline at end of file
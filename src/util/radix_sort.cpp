@@ -0,0 +1,91 @@
+#include <misaki/utils/util/parallel.h>
+#include <misaki/utils/util/radix_sort.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace misaki::util {
+
+namespace {
+
+constexpr size_t Grain = 1 << 16;
+constexpr size_t Radix = 256;
+
+template <typename Key>
+void sort(Key *keys, uint32_t *values, size_t count, int bits, bool parallel) {
+  if (count < 2)
+    return;
+  bits = std::min(bits, int(sizeof(Key) * 8));
+  const size_t chunks = (count + Grain - 1) / Grain;
+  auto for_chunks = [&](const std::function<void(size_t, size_t, size_t)> &func) {
+    auto body = [&](size_t begin, size_t end) {
+      for (size_t c = begin; c < end; ++c)
+        func(c, c * Grain, std::min(count, (c + 1) * Grain));
+    };
+    if (parallel && chunks > 1)
+      parallel_for(0, chunks, 1, body);
+    else
+      body(0, chunks);
+  };
+
+  std::vector<Key> key_buffer(count);
+  std::vector<uint32_t> value_buffer(count);
+  Key *key_src = keys, *key_dst = key_buffer.data();
+  uint32_t *value_src = values, *value_dst = value_buffer.data();
+  // Per chunk digit counts, turned into scatter offsets
+  std::vector<size_t> offsets(chunks * Radix);
+  for (int shift = 0; shift < bits; shift += 8) {
+    for_chunks([&](size_t c, size_t begin, size_t end) {
+      size_t *hist = offsets.data() + c * Radix;
+      std::fill(hist, hist + Radix, 0);
+      for (size_t i = begin; i < end; ++i) ++hist[(key_src[i] >> shift) & 0xff];
+    });
+
+    bool trivial = false;
+    size_t sum = 0;
+    for (size_t d = 0; d < Radix; ++d) {
+      size_t digit_count = 0;
+      for (size_t c = 0; c < chunks; ++c) {
+        size_t n = offsets[c * Radix + d];
+        offsets[c * Radix + d] = sum;
+        sum += n;
+        digit_count += n;
+      }
+      trivial |= digit_count == count;
+    }
+    if (trivial)
+      continue;
+
+    for_chunks([&](size_t c, size_t begin, size_t end) {
+      size_t *offset = offsets.data() + c * Radix;
+      for (size_t i = begin; i < end; ++i) {
+        size_t j = offset[(key_src[i] >> shift) & 0xff]++;
+        key_dst[j] = key_src[i];
+        value_dst[j] = value_src[i];
+      }
+    });
+    std::swap(key_src, key_dst);
+    std::swap(value_src, value_dst);
+  }
+
+  if (key_src != keys)
+    for_chunks([&](size_t, size_t begin, size_t end) {
+      std::copy(key_src + begin, key_src + end, keys + begin);
+      std::copy(value_src + begin, value_src + end, values + begin);
+    });
+}
+
+}  // namespace
+
+void radix_sort(uint32_t *keys, uint32_t *values, size_t count, int bits,
+                bool parallel) {
+  sort(keys, values, count, bits, parallel);
+}
+
+void radix_sort(uint64_t *keys, uint32_t *values, size_t count, int bits,
+                bool parallel) {
+  sort(keys, values, count, bits, parallel);
+}
+
+}  // namespace misaki::util
\ No newline at end of file
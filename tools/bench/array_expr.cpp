@@ -0,0 +1,107 @@
+// Eager against lazy evaluation of a*b - c*d + e for Size 3, 4, 8 and 16,
+// and the lazy 4x4 inverse of matrix.hpp. The kernels are not inlined, so
+// their code can be compared with objdump -d --demangle.
+#include <misaki/utils/math/array_expr.hpp>
+#include <misaki/utils/math/matrix.hpp>
+#include <misaki/utils/math/random.hpp>
+
+#include <vector>
+
+#include "bench.h"
+
+namespace misaki::bench {
+
+namespace {
+
+constexpr size_t Count = 1 << 12;
+constexpr int Passes = 64;
+
+template <size_t N>
+using Vec = math::Array<float, N>;
+
+template <size_t N>
+MSK_NOINLINE void eager_kernel(const Vec<N> *a, const Vec<N> *b,
+                               const Vec<N> *c, const Vec<N> *d,
+                               const Vec<N> *e, Vec<N> *out, size_t count) {
+  for (size_t i = 0; i < count; ++i)
+    out[i] = a[i] * b[i] - c[i] * d[i] + e[i];
+}
+
+template <size_t N>
+MSK_NOINLINE void lazy_kernel(const Vec<N> *a, const Vec<N> *b,
+                              const Vec<N> *c, const Vec<N> *d,
+                              const Vec<N> *e, Vec<N> *out, size_t count) {
+  for (size_t i = 0; i < count; ++i)
+    out[i] = math::lazy(a[i]) * b[i] - math::lazy(c[i]) * d[i] + e[i];
+}
+
+template <size_t N>
+bool compare(math::PCG32 &rng) {
+  std::vector<Vec<N>> in[5], out(Count), eager, lazy;
+  for (auto &v : in) {
+    v.resize(Count);
+    for (auto &x : v)
+      for (size_t k = 0; k < N; ++k) x.coeff(k) = rng.next_float32();
+  }
+  // Both kernels write the same buffer and take turns, so that neither
+  // gains from where its output happens to lie relative to the inputs
+  auto run = [&](auto kernel) {
+    return time_per_item(Count * Passes, [&] {
+      for (int p = 0; p < Passes; ++p)
+        kernel(in[0].data(), in[1].data(), in[2].data(), in[3].data(),
+               in[4].data(), out.data(), Count);
+      consume(out.data());
+    });
+  };
+  double t_eager = 0.0, t_lazy = 0.0;
+  for (int round = 0; round < 2; ++round) {
+    double t = run(eager_kernel<N>);
+    t_eager = round == 0 ? t : std::min(t_eager, t);
+    eager = out;
+    t = run(lazy_kernel<N>);
+    t_lazy = round == 0 ? t : std::min(t_lazy, t);
+    lazy = out;
+  }
+  std::printf("  Size %2zu: eager %6.2f ns, lazy %6.2f ns per array\n", N,
+              t_eager, t_lazy);
+  bool same = true;
+  for (size_t i = 0; i < Count; ++i)
+    for (size_t k = 0; k < N; ++k)
+      same &= eager[i].coeff(k) == lazy[i].coeff(k);
+  char what[64];
+  std::snprintf(what, sizeof(what), "Size %zu lazy == eager", N);
+  return check(same, what);
+}
+
+}  // namespace
+
+bool array_expr() {
+  math::PCG32 rng;
+  bool ok = compare<3>(rng);
+  ok &= compare<4>(rng);
+  ok &= compare<8>(rng);
+  ok &= compare<16>(rng);
+
+  // Well conditioned random matrices, checked through m * inverse(m)
+  using Matrix = math::Matrix<float, 4>;
+  std::vector<Matrix> m(Count), inv(Count);
+  for (auto &x : m)
+    for (size_t i = 0; i < 4; ++i)
+      for (size_t j = 0; j < 4; ++j)
+        x(i, j) = (i == j ? 4.f : 0.f) + rng.next_float32() - .5f;
+  double t = time_per_item(Count, [&] {
+    for (size_t i = 0; i < Count; ++i) inv[i] = math::inverse(m[i]);
+    consume(inv.data());
+  });
+  std::printf("  Matrix<float, 4> inverse: %.2f ns\n", t);
+  float err = 0.f;
+  for (size_t i = 0; i < Count; ++i) {
+    Matrix p = m[i] * inv[i];
+    for (size_t r = 0; r < 4; ++r)
+      for (size_t c = 0; c < 4; ++c)
+        err = std::max(err, std::abs(p(r, c) - (r == c ? 1.f : 0.f)));
+  }
+  return check(err < 1e-5f, "m * inverse(m) == I") && ok;
+}
+
+}  // namespace misaki::bench
\ No newline at end of file
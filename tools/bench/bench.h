@@ -0,0 +1,56 @@
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace misaki::bench {
+
+// Keeps the compiler from discarding a result computed for timing only
+extern void consume(const void *ptr);
+
+// Best of `repeats` runs of func(), in nanoseconds per item
+template <typename Func>
+double time_per_item(size_t items, Func &&func, int repeats = 5) {
+  double best = 0.0;
+  for (int i = 0; i < repeats; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    func();
+    std::chrono::duration<double, std::nano> elapsed =
+        std::chrono::steady_clock::now() - start;
+    double t = elapsed.count() / double(items);
+    if (i == 0 || t < best)
+      best = t;
+  }
+  return best;
+}
+
+// Distance in representable floats, counted across zero
+inline int64_t ulp_distance(float a, float b) {
+  if (std::isnan(a) || std::isnan(b))
+    return std::isnan(a) && std::isnan(b) ? 0 : INT64_MAX;
+  auto ordered = [](float f) {
+    int32_t i;
+    std::memcpy(&i, &f, 4);
+    return i < 0 ? int64_t(INT32_MIN) - i : int64_t(i);
+  };
+  return std::llabs(ordered(a) - ordered(b));
+}
+
+// Print a check and whether it passed
+extern bool check(bool ok, const char *what);
+
+// Suites, each returning false when one of its checks failed
+bool array_expr();
+bool bvh_refit();
+bool fastmath();
+bool octahedral();
+bool random();
+bool srgb();
+bool wide_bvh();
+
+}  // namespace misaki::bench
\ No newline at end of file
@@ -0,0 +1,363 @@
+// Ray traversal of the binary and wide BVHs over a triangle soup: node
+// sizes, rays per second and the work per ray behind them, for coherent
+// camera rays and incoherent rays from random points inside the scene.
+// Times are single-threaded, one ray at a time. Also compares rebuilding
+// the BVH of deformed triangles with refitting it.
+#include <misaki/utils/accel.h>
+#include <misaki/utils/math/random.hpp>
+
+#include <vector>
+
+#include "bench.h"
+
+namespace misaki::bench {
+
+namespace {
+
+using Vector3f = math::TVector3<float>;
+
+constexpr size_t Triangles = 1 << 18;
+// Camera rays per side
+constexpr size_t Resolution = 256;
+constexpr float Infinity = 1e30f;
+
+struct Triangle {
+  Vector3f p0, p1, p2;
+};
+
+struct Ray {
+  Vector3f o, d;
+};
+
+struct Scene {
+  std::vector<Triangle> triangles;
+  std::vector<math::BoundingBox3f> bounds;
+  std::vector<Vector3f> centroids;
+};
+
+// Triangles in the unit cube with edges of about one cell of a grid with
+// one cell per triangle
+Scene triangle_soup(size_t count, math::PCG32 &rng) {
+  const float size = 1.5f / std::cbrt(float(count));
+  Scene scene;
+  scene.triangles.resize(count);
+  scene.bounds.resize(count);
+  scene.centroids.resize(count);
+  auto corner = [&](const Vector3f &p) {
+    return p + Vector3f(rng.next_float32() - .5f, rng.next_float32() - .5f,
+                        rng.next_float32() - .5f) *
+                   size;
+  };
+  for (size_t i = 0; i < count; ++i) {
+    Vector3f p(rng.next_float32(), rng.next_float32(), rng.next_float32());
+    Triangle &t = scene.triangles[i];
+    t = {corner(p), corner(p), corner(p)};
+    scene.bounds[i] = math::BoundingBox3f(t.p0);
+    scene.bounds[i].expand(t.p1);
+    scene.bounds[i].expand(t.p2);
+    scene.centroids[i] = (t.p0 + t.p1 + t.p2) / 3.f;
+  }
+  return scene;
+}
+
+// Triangles twisted around the vertical axis through the cube center, by
+// `angle` at the top and not at all at the bottom
+Scene twisted(const Scene &scene, float angle) {
+  Scene ret;
+  ret.triangles.resize(scene.triangles.size());
+  ret.bounds.resize(scene.triangles.size());
+  ret.centroids.resize(scene.triangles.size());
+  auto twist = [&](const Vector3f &p) {
+    float a = angle * p.y, c = std::cos(a), s = std::sin(a);
+    float x = p.x - .5f, z = p.z - .5f;
+    return Vector3f(c * x - s * z + .5f, p.y, s * x + c * z + .5f);
+  };
+  for (size_t i = 0; i < scene.triangles.size(); ++i) {
+    const Triangle &t = scene.triangles[i];
+    Triangle &u = ret.triangles[i];
+    u = {twist(t.p0), twist(t.p1), twist(t.p2)};
+    ret.bounds[i] = math::BoundingBox3f(u.p0);
+    ret.bounds[i].expand(u.p1);
+    ret.bounds[i].expand(u.p2);
+    ret.centroids[i] = (u.p0 + u.p1 + u.p2) / 3.f;
+  }
+  return ret;
+}
+
+// Pinhole camera in front of the cube, rays in scanline order
+std::vector<Ray> camera_rays() {
+  std::vector<Ray> rays;
+  rays.reserve(Resolution * Resolution);
+  const Vector3f eye(.5f, .5f, -1.5f);
+  for (size_t y = 0; y < Resolution; ++y)
+    for (size_t x = 0; x < Resolution; ++x) {
+      Vector3f target((x + .5f) / Resolution, (y + .5f) / Resolution, 0.f);
+      rays.push_back({eye, (target - eye).normalize()});
+    }
+  return rays;
+}
+
+// Random origins inside the cube and random directions, as for diffuse
+// bounces
+std::vector<Ray> random_rays(size_t count, math::PCG32 &rng) {
+  std::vector<Ray> rays(count);
+  for (Ray &r : rays) {
+    r.o = Vector3f(rng.next_float32(), rng.next_float32(), rng.next_float32());
+    do {
+      r.d = Vector3f(2.f * rng.next_float32() - 1.f,
+                     2.f * rng.next_float32() - 1.f,
+                     2.f * rng.next_float32() - 1.f);
+    } while (r.d.squared_norm() > 1.f || r.d.squared_norm() < 1e-4f);
+    r.d = r.d.normalize();
+  }
+  return rays;
+}
+
+// Möller-Trumbore, shrinking tmax on a hit
+MSK_INLINE void intersect(const Triangle &t, const Ray &r, float &tmax) {
+  Vector3f e1 = t.p1 - t.p0, e2 = t.p2 - t.p0, p = cross(r.d, e2);
+  float det = dot(e1, p);
+  if (std::abs(det) < 1e-12f)
+    return;
+  float inv_det = 1.f / det;
+  Vector3f s = r.o - t.p0;
+  float u = dot(s, p) * inv_det;
+  if (u < 0.f || u > 1.f)
+    return;
+  Vector3f q = cross(s, e1);
+  float v = dot(r.d, q) * inv_det;
+  if (v < 0.f || u + v > 1.f)
+    return;
+  float dist = dot(e2, q) * inv_det;
+  if (dist >= 0.f && dist < tmax)
+    tmax = dist;
+}
+
+// Work per ray, summed over a ray set
+struct Stats {
+  size_t nodes = 0, leaves = 0, tests = 0;
+};
+
+// Nearest hits through the binary BVH, near child first
+void trace_binary(const accel::BVH &bvh, const Scene &scene,
+                  const std::vector<Ray> &rays, float *tmax, Stats *stats) {
+  const auto &nodes = bvh.nodes();
+  const auto &prims = bvh.primitives();
+  uint32_t stack[128];
+  for (size_t r = 0; r < rays.size(); ++r) {
+    const Ray &ray = rays[r];
+    const Vector3f inv_dir(1.f / ray.d.x, 1.f / ray.d.y, 1.f / ray.d.z);
+    float t = Infinity;
+    size_t size = 0;
+    stack[size++] = 0;
+    while (size > 0) {
+      const accel::BVHNode &node = nodes[stack[--size]];
+      if (stats)
+        ++stats->nodes;
+      if (node.is_leaf()) {
+        if (stats) {
+          ++stats->leaves;
+          stats->tests += node.count;
+        }
+        for (uint32_t i = 0; i < node.count; ++i)
+          intersect(scene.triangles[prims[node.offset + i]], ray, t);
+        continue;
+      }
+      auto [hit0, near0, far0] =
+          nodes[node.offset].bbox.ray_intersect(ray.o, inv_dir, 0.f, t);
+      auto [hit1, near1, far1] =
+          nodes[node.offset + 1].bbox.ray_intersect(ray.o, inv_dir, 0.f, t);
+      if (hit0 && hit1) {
+        bool swap = near1 < near0;
+        stack[size++] = node.offset + !swap;
+        stack[size++] = node.offset + swap;
+      } else if (hit0 || hit1) {
+        stack[size++] = node.offset + (hit0 ? 0 : 1);
+      }
+    }
+    tmax[r] = t;
+  }
+}
+
+template <typename WideBVH>
+void trace_wide(const WideBVH &bvh, const Scene &scene,
+                const std::vector<Ray> &rays, float *tmax, Stats *stats) {
+  const auto &prims = bvh.primitives();
+  for (size_t r = 0; r < rays.size(); ++r) {
+    const Ray &ray = rays[r];
+    float t = Infinity;
+    bvh.traverse(ray.o, ray.d, 0.f, t,
+                 [&](uint32_t first, uint32_t count, float &t_) {
+                   if (stats) {
+                     ++stats->leaves;
+                     stats->tests += count;
+                   }
+                   for (uint32_t i = 0; i < count; ++i)
+                     intersect(scene.triangles[prims[first + i]], ray, t_);
+                 });
+    tmax[r] = t;
+  }
+}
+
+}  // namespace
+
+bool wide_bvh() {
+  math::PCG32 rng;
+  const Scene scene = triangle_soup(Triangles, rng);
+  accel::BVHBuildSettings settings;
+  settings.max_leaf_size = 4;
+  const accel::BVH bvh(scene.bounds.data(), scene.centroids.data(),
+                       Triangles, settings);
+  const accel::TWideBVH<4, false> wide4(bvh);
+  const accel::TWideBVH<4, true> wide4c(bvh);
+  const accel::TWideBVH<8, false> wide8(bvh);
+  const accel::TWideBVH<8, true> wide8c(bvh);
+  std::printf("  %zu triangles, SAH cost %.1f\n", Triangles, bvh.sah_cost());
+
+  struct RaySet {
+    const char *name;
+    std::vector<Ray> rays;
+  };
+  const RaySet sets[] = {{"camera", camera_rays()},
+                         {"random", random_rays(Resolution * Resolution, rng)}};
+
+  struct Variant {
+    const char *name;
+    size_t nodes, node_bytes;
+    void (*trace)(const void *, const Scene &, const std::vector<Ray> &,
+                  float *, Stats *);
+    const void *bvh;
+  };
+  auto wide = [](auto *w) {
+    using W = std::remove_const_t<std::remove_pointer_t<decltype(w)>>;
+    return +[](const void *b, const Scene &s, const std::vector<Ray> &rays,
+               float *tmax, Stats *stats) {
+      trace_wide(*static_cast<const W *>(b), s, rays, tmax, stats);
+    };
+  };
+  const Variant variants[] = {
+      {"binary", bvh.nodes().size(), sizeof(accel::BVHNode),
+       [](const void *b, const Scene &s, const std::vector<Ray> &rays,
+          float *tmax, Stats *stats) {
+         trace_binary(*static_cast<const accel::BVH *>(b), s, rays, tmax,
+                      stats);
+       },
+       &bvh},
+      {"wide4", wide4.nodes().size(), sizeof(wide4.nodes()[0]), wide(&wide4),
+       &wide4},
+      {"wide4 compressed", wide4c.nodes().size(), sizeof(wide4c.nodes()[0]),
+       wide(&wide4c), &wide4c},
+      {"wide8", wide8.nodes().size(), sizeof(wide8.nodes()[0]), wide(&wide8),
+       &wide8},
+      {"wide8 compressed", wide8c.nodes().size(), sizeof(wide8c.nodes()[0]),
+       wide(&wide8c), &wide8c},
+  };
+  for (const Variant &v : variants)
+    std::printf("  %s: %zu nodes of %zu bytes, %.1f MB\n", v.name, v.nodes,
+                v.node_bytes, v.nodes * v.node_bytes / 1e6);
+
+  bool ok = true;
+  for (const RaySet &set : sets) {
+    const size_t count = set.rays.size();
+    std::vector<float> ref(count), tmax(count);
+    Stats ref_stats;
+    trace_binary(bvh, scene, set.rays, ref.data(), &ref_stats);
+    size_t hits = 0;
+    for (float t : ref) hits += t < Infinity;
+    std::printf("  %s rays: %zu of %zu hit, binary BVH visits %.1f nodes "
+                "per ray\n",
+                set.name, hits, count, double(ref_stats.nodes) / count);
+    bool same = true;
+    double t_binary = 0.0;
+    for (const Variant &v : variants) {
+      Stats stats;
+      v.trace(v.bvh, scene, set.rays, tmax.data(), &stats);
+      same &= tmax == ref;
+      double t = time_per_item(
+          count, [&] { v.trace(v.bvh, scene, set.rays, tmax.data(), nullptr); },
+          3);
+      if (&v == variants)
+        t_binary = t;
+      std::printf("    %-16s %6.2f Mrays/s, %5.1f leaves and %5.1f "
+                  "triangles per ray\n",
+                  v.name, 1e3 / t, double(stats.leaves) / count,
+                  double(stats.tests) / count);
+    }
+    // Most of a node visit is waiting on unpredictable branches and on
+    // loads, so this sets the scale of the figures above
+    std::printf("    %.1f ns per binary node visit, leaves included\n",
+                t_binary * count / ref_stats.nodes);
+    char what[64];
+    std::snprintf(what, sizeof(what), "%s rays: same hits in every BVH",
+                  set.name);
+    ok &= check(same, what);
+  }
+  return ok;
+}
+
+bool bvh_refit() {
+  math::PCG32 rng;
+  const Scene scene = triangle_soup(Triangles, rng);
+  accel::BVHBuildSettings settings;
+  settings.max_leaf_size = 4;
+  const accel::BVH original(scene.bounds.data(), scene.centroids.data(),
+                            Triangles, settings);
+  const std::vector<Ray> rays = random_rays(1 << 14, rng);
+  std::vector<float> ref(rays.size()), tmax(rays.size());
+  std::printf("  %zu triangles, twisted by an angle growing with height\n",
+              Triangles);
+
+  bool ok = true;
+  for (float angle : {.1f, .5f, 2.f}) {
+    const Scene moved = twisted(scene, angle);
+
+    accel::BVH rebuilt;
+    double t_rebuild = time_per_item(1, [&] {
+      rebuilt = accel::BVH(moved.bounds.data(), moved.centroids.data(),
+                           Triangles, settings);
+    }, 3);
+    accel::BVH refit = original;
+    accel::BVHRefitter refitter(refit);
+    double t_refit = time_per_item(
+        1, [&] { refitter.refit(moved.bounds.data()); }, 3);
+    // Rotations change the tree, so this one is timed once
+    accel::BVH optimized = refit;
+    accel::BVHRefitter optimizer(optimized);
+    size_t rotations = 0;
+    double t_optimize =
+        time_per_item(1, [&] { rotations = optimizer.optimize(); }, 1);
+
+    struct Result {
+      const char *name;
+      const accel::BVH &bvh;
+      double ms;
+    };
+    const Result results[] = {
+        {"rebuild", rebuilt, t_rebuild * 1e-6},
+        {"refit", refit, t_refit * 1e-6},
+        {"refit + optimize", optimized, (t_refit + t_optimize) * 1e-6},
+    };
+    std::printf("  angle %.1f:\n", angle);
+    trace_binary(rebuilt, moved, rays, ref.data(), nullptr);
+    bool same = true;
+    for (const Result &r : results) {
+      double t_trace = time_per_item(rays.size(), [&] {
+        trace_binary(r.bvh, moved, rays, tmax.data(), nullptr);
+      }, 3);
+      same &= tmax == ref;
+      std::printf("    %-16s %8.2f ms, SAH cost %6.1f, %.2f Mrays/s\n",
+                  r.name, r.ms, r.bvh.sah_cost(), 1e3 / t_trace);
+    }
+    std::printf("    %zu rotations\n", rotations);
+    char what[64];
+    std::snprintf(what, sizeof(what), "angle %.1f: same hits after refit",
+                  angle);
+    ok &= check(same, what);
+    std::snprintf(what, sizeof(what),
+                  "angle %.1f: optimize does not raise the SAH cost", angle);
+    ok &= check(optimized.sah_cost() <= refit.sah_cost(), what);
+  }
+  return ok;
+}
+
+}  // namespace misaki::bench
\ No newline at end of file
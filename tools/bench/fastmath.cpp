@@ -0,0 +1,145 @@
+// Max ulp error of the fast_* approximations against libm in double
+// precision, asserted against the bounds documented in fastmath.hpp, and
+// their throughput on packets next to libm's.
+#include <misaki/utils/math/fastmath.hpp>
+#include <misaki/utils/math/random.hpp>
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "bench.h"
+
+namespace misaki::bench {
+
+namespace {
+
+constexpr size_t Count = 1 << 20;
+constexpr size_t Width = 8;
+using Lanes = math::Array<float, Width>;
+
+struct Function {
+  const char *name;
+  int64_t max_ulp;
+  // Inputs x (and y) for the i-th of Count samples
+  float (*x)(math::PCG32 &rng, size_t i);
+  float (*y)(math::PCG32 &rng, size_t i);
+  Lanes (*fast)(const Lanes &x, const Lanes &y);
+  float (*scalar)(float x, float y);
+  // Reference in double precision, and libm in float for timing
+  double (*reference)(double x, double y);
+  float (*libm)(float x, float y);
+};
+
+Lanes load(const float *p) {
+  Lanes ret;
+  std::memcpy(ret.data(), p, sizeof(float) * Width);
+  return ret;
+}
+
+float uniform(math::PCG32 &rng, float lo, float hi) {
+  return lo + (hi - lo) * rng.next_float32();
+}
+
+// Positive normal floats spread over all exponents
+float positive_normal(math::PCG32 &rng, size_t) {
+  uint32_t bits = (rng.next_uint32() % 0x7f000000u) + 0x00800000u;
+  float f;
+  std::memcpy(&f, &bits, 4);
+  return f;
+}
+
+const Function functions[] = {
+    {"exp", 1, [](math::PCG32 &r, size_t) { return uniform(r, -87.f, 88.f); },
+     nullptr, [](const Lanes &x, const Lanes &) { return math::fast_exp(x); },
+     [](float x, float) { return math::fast_exp(x); },
+     [](double x, double) { return std::exp(x); },
+     [](float x, float) { return std::exp(x); }},
+    {"log", 1, positive_normal, nullptr,
+     [](const Lanes &x, const Lanes &) { return math::fast_log(x); },
+     [](float x, float) { return math::fast_log(x); },
+     [](double x, double) { return std::log(x); },
+     [](float x, float) { return std::log(x); }},
+    {"pow", 8, [](math::PCG32 &r, size_t) { return uniform(r, .1f, 10.f); },
+     [](math::PCG32 &, size_t) { return 2.2f; },
+     [](const Lanes &x, const Lanes &y) { return math::fast_pow(x, y); },
+     [](float x, float y) { return math::fast_pow(x, y); },
+     [](double x, double y) { return std::pow(x, y); },
+     [](float x, float y) { return std::pow(x, y); }},
+    {"sin", 1,
+     [](math::PCG32 &r, size_t) { return uniform(r, -3.14159265f, 3.14159265f); },
+     nullptr, [](const Lanes &x, const Lanes &) { return math::fast_sin(x); },
+     [](float x, float) { return math::fast_sin(x); },
+     [](double x, double) { return std::sin(x); },
+     [](float x, float) { return std::sin(x); }},
+    {"cos", 1,
+     [](math::PCG32 &r, size_t) { return uniform(r, -3.14159265f, 3.14159265f); },
+     nullptr, [](const Lanes &x, const Lanes &) { return math::fast_cos(x); },
+     [](float x, float) { return math::fast_cos(x); },
+     [](double x, double) { return std::cos(x); },
+     [](float x, float) { return std::cos(x); }},
+    {"atan2", 3, [](math::PCG32 &r, size_t) { return uniform(r, -10.f, 10.f); },
+     [](math::PCG32 &r, size_t) { return uniform(r, -10.f, 10.f); },
+     [](const Lanes &y, const Lanes &x) { return math::fast_atan2(y, x); },
+     [](float y, float x) { return math::fast_atan2(y, x); },
+     [](double y, double x) { return std::atan2(y, x); },
+     [](float y, float x) { return std::atan2(y, x); }},
+    {"rsqrt", 4, positive_normal, nullptr,
+     [](const Lanes &x, const Lanes &) { return math::fast_rsqrt(x); },
+     [](float x, float) { return math::fast_rsqrt(x); },
+     [](double x, double) { return 1.0 / std::sqrt(x); },
+     [](float x, float) { return 1.f / std::sqrt(x); }},
+};
+
+}  // namespace
+
+bool fastmath() {
+  math::PCG32 rng;
+  std::vector<float> x(Count), y(Count), fast(Count), ref(Count);
+  bool ok = true;
+  for (const Function &f : functions) {
+    for (size_t i = 0; i < Count; ++i) {
+      x[i] = f.x(rng, i);
+      y[i] = f.y ? f.y(rng, i) : 0.f;
+    }
+
+    // Accuracy of the packet and scalar paths
+    int64_t packet_ulp = 0, scalar_ulp = 0;
+    for (size_t i = 0; i < Count; i += Width) {
+      Lanes lx = load(x.data() + i), ly = load(y.data() + i);
+      Lanes r = f.fast(lx, ly);
+      for (size_t k = 0; k < Width; ++k) {
+        float expected = float(f.reference(x[i + k], y[i + k]));
+        packet_ulp = std::max(packet_ulp, ulp_distance(r.coeff(k), expected));
+        scalar_ulp = std::max(
+            scalar_ulp,
+            ulp_distance(f.scalar(x[i + k], y[i + k]), expected));
+      }
+    }
+
+    double t_fast = time_per_item(Count, [&] {
+      for (size_t i = 0; i < Count; i += Width)
+      {
+        Lanes r = f.fast(load(x.data() + i), load(y.data() + i));
+        std::memcpy(fast.data() + i, r.data(), sizeof(float) * Width);
+      }
+      consume(fast.data());
+    });
+    double t_libm = time_per_item(Count, [&] {
+      for (size_t i = 0; i < Count; ++i)
+        ref[i] = f.libm(x[i], y[i]);
+      consume(ref.data());
+    });
+    std::printf("  %-5s %.2f ns fast, %.2f ns libm per value, max %lld / "
+                "%lld ulp (packet / scalar)\n",
+                f.name, t_fast, t_libm, (long long)packet_ulp,
+                (long long)scalar_ulp);
+    char what[64];
+    std::snprintf(what, sizeof(what), "%s within %lld ulp", f.name,
+                  (long long)f.max_ulp);
+    ok &= check(packet_ulp <= f.max_ulp && scalar_ulp <= f.max_ulp, what);
+  }
+  return ok;
+}
+
+}  // namespace misaki::bench
\ No newline at end of file
@@ -0,0 +1,73 @@
+// Benchmarks and accuracy checks of the library kernels:
+//   msk-bench [suite...]
+// runs the given suites, or all of them, and fails when a check fails.
+#include <cstring>
+#include <exception>
+#include <iostream>
+
+#include "bench.h"
+
+namespace misaki::bench {
+
+namespace {
+volatile const void *g_sink;
+}  // namespace
+
+void consume(const void *ptr) { g_sink = ptr; }
+
+bool check(bool ok, const char *what) {
+  std::printf("  [%s] %s\n", ok ? "ok" : "FAILED", what);
+  return ok;
+}
+
+}  // namespace misaki::bench
+
+using namespace misaki;
+
+int main(int argc, char **argv) {
+  struct Suite {
+    const char *name;
+    bool (*run)();
+  };
+  const Suite suites[] = {
+      {"array-expr", bench::array_expr},
+      {"bvh-refit", bench::bvh_refit},
+      {"fastmath", bench::fastmath},
+      {"octahedral", bench::octahedral},
+      {"random", bench::random},
+      {"srgb", bench::srgb},
+      {"wide-bvh", bench::wide_bvh},
+  };
+
+  for (int i = 1; i < argc; ++i) {
+    bool known = false;
+    for (const Suite &s : suites) known |= std::strcmp(argv[i], s.name) == 0;
+    if (!known) {
+      std::cerr << "Usage: " << argv[0] << " [suite...]\nSuites:";
+      for (const Suite &s : suites) std::cerr << " " << s.name;
+      std::cerr << std::endl;
+      return 1;
+    }
+  }
+
+#if !defined(__OPTIMIZE__) && !defined(NDEBUG)
+  std::printf("Unoptimized build, configure with -DCMAKE_BUILD_TYPE=Release "
+              "for meaningful timings\n");
+#endif
+  bool ok = true;
+  try {
+    for (const Suite &s : suites) {
+      bool selected = argc == 1;
+      for (int i = 1; i < argc; ++i)
+        selected |= std::strcmp(argv[i], s.name) == 0;
+      if (!selected)
+        continue;
+      std::printf("%s\n", s.name);
+      ok &= s.run();
+    }
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  return ok ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,169 @@
+// Angular error of the octahedral and frame encodings against the bounds in
+// octahedral.hpp, agreement of the batch and scalar paths, and the cost of
+// decoding compact normals inside a loop that gathers them at random, next
+// to loading full TVector3 normals.
+#include <misaki/utils/math/octahedral.hpp>
+#include <misaki/utils/math/random.hpp>
+
+#include <vector>
+
+#include "bench.h"
+
+namespace misaki::bench {
+
+namespace {
+
+using Vector3f = math::TVector3<float>;
+using Frame3f = math::TFrame<float>;
+
+constexpr size_t Count = 1 << 20;
+// Normals gathered per loop; large enough that the 12 byte array does not
+// fit in the caches
+constexpr size_t Normals = 1 << 22;
+
+Vector3f random_direction(math::PCG32 &rng) {
+  while (true) {
+    Vector3f v(2.f * rng.next_float32() - 1.f, 2.f * rng.next_float32() - 1.f,
+               2.f * rng.next_float32() - 1.f);
+    float n2 = v.squared_norm();
+    if (n2 > 1e-4f && n2 <= 1.f)
+      return v / std::sqrt(n2);
+  }
+}
+
+// In degrees, computed in double so that tiny angles are resolved
+double angle(const Vector3f &a, const Vector3f &b) {
+  double c[3] = {double(a.y) * b.z - double(a.z) * b.y,
+                 double(a.z) * b.x - double(a.x) * b.z,
+                 double(a.x) * b.y - double(a.y) * b.x};
+  double d = double(a.x) * b.x + double(a.y) * b.y + double(a.z) * b.z;
+  return std::atan2(std::sqrt(c[0] * c[0] + c[1] * c[1] + c[2] * c[2]), d) *
+         (180.0 / 3.14159265358979323846);
+}
+
+bool bound(const char *name, double measured, double limit) {
+  char what[96];
+  std::snprintf(what, sizeof(what), "%s: max %.4f deg <= %.4f", name,
+                measured, limit);
+  return check(measured <= limit, what);
+}
+
+// Sum of dot(n, l) over random indices, the access pattern of shading
+// lookups during traversal
+template <typename Decode>
+double gather_loop(const std::vector<uint32_t> &index, Decode &&decode) {
+  const Vector3f l = Vector3f(1.f, 2.f, 3.f).normalize();
+  float sum = 0.f;
+  double t = time_per_item(index.size(), [&] {
+    for (uint32_t i : index) sum += dot(decode(i), l);
+  });
+  consume(&sum);
+  return t;
+}
+
+}  // namespace
+
+bool octahedral() {
+  math::PCG32 rng;
+  std::vector<Vector3f> dirs(Count), decoded(Count);
+  std::vector<Frame3f> frames(Count), decoded_frames(Count);
+  for (size_t i = 0; i < Count; ++i) {
+    dirs[i] = random_direction(rng);
+    // Random tangent angle and handedness
+    Frame3f f(dirs[i]);
+    float a = 6.2831853f * rng.next_float32(), s = std::sin(a),
+          c = std::cos(a);
+    Vector3f t = f.t * c - f.s * s;
+    f.s = f.s * c + f.t * s;
+    f.t = rng.next_float32() < .5f ? t : -t;
+    frames[i] = f;
+  }
+  bool ok = true;
+
+  // Angular error of the batch and the scalar paths. Their codes may differ
+  // by a step where a value rounds differently with and without FMA.
+  struct Error {
+    double oct32 = 0, oct16 = 0, normal = 0, tangent = 0, bitangent = 0;
+  } batch, scalar;
+  std::vector<uint32_t> codes32(Count);
+  std::vector<uint16_t> codes16(Count);
+  math::oct32_encode(dirs.data(), codes32.data(), Count);
+  math::oct32_decode(codes32.data(), decoded.data(), Count);
+  for (size_t i = 0; i < Count; ++i) {
+    batch.oct32 = std::max(batch.oct32, angle(dirs[i], decoded[i]));
+    scalar.oct32 = std::max(
+        scalar.oct32,
+        angle(dirs[i], math::oct32_decode(math::oct32_encode(dirs[i]))));
+  }
+  math::oct16_encode(dirs.data(), codes16.data(), Count);
+  math::oct16_decode(codes16.data(), decoded.data(), Count);
+  for (size_t i = 0; i < Count; ++i) {
+    batch.oct16 = std::max(batch.oct16, angle(dirs[i], decoded[i]));
+    scalar.oct16 = std::max(
+        scalar.oct16,
+        angle(dirs[i], math::oct16_decode(math::oct16_encode(dirs[i]))));
+  }
+  math::frame32_encode(frames.data(), codes32.data(), Count);
+  math::frame32_decode(codes32.data(), decoded_frames.data(), Count);
+  auto frame_error = [](Error &e, const Frame3f &a, const Frame3f &b) {
+    e.normal = std::max(e.normal, angle(a.n, b.n));
+    e.tangent = std::max(e.tangent, angle(a.s, b.s));
+    e.bitangent = std::max(e.bitangent, angle(a.t, b.t));
+  };
+  for (size_t i = 0; i < Count; ++i) {
+    frame_error(batch, frames[i], decoded_frames[i]);
+    frame_error(scalar, frames[i],
+                math::frame32_decode(math::frame32_encode(frames[i])));
+  }
+  for (const Error *e : {&batch, &scalar}) {
+    std::printf("  %s path:\n", e == &batch ? "batch" : "scalar");
+    ok &= bound("oct32", e->oct32, 0.0037);
+    ok &= bound("oct16", e->oct16, 0.64);
+    ok &= bound("frame32 normal", e->normal, 0.08);
+    ok &= bound("frame32 tangent", e->tangent, 0.36);
+    ok &= bound("frame32 bitangent", e->bitangent, 0.36);
+  }
+
+  // Batch throughput
+  double t_enc = time_per_item(Count, [&] {
+    math::oct32_encode(dirs.data(), codes32.data(), Count);
+    consume(codes32.data());
+  });
+  double t_dec = time_per_item(Count, [&] {
+    math::oct32_decode(codes32.data(), decoded.data(), Count);
+    consume(decoded.data());
+  });
+  std::printf("  oct32 batch: encode %.2f ns, decode %.2f ns per vector\n",
+              t_enc, t_dec);
+
+  // Decoding inside a lookup loop, against loading full vectors. In order
+  // the decode cost dominates, at random the memory traffic.
+  std::vector<Vector3f> normals(Normals);
+  std::vector<uint32_t> normals32(Normals), in_order(Count), random(Count);
+  std::vector<uint16_t> normals16(Normals);
+  for (size_t i = 0; i < Normals; ++i) {
+    normals[i] = random_direction(rng);
+    normals32[i] = math::oct32_encode(normals[i]);
+    normals16[i] = math::oct16_encode(normals[i]);
+  }
+  for (size_t i = 0; i < Count; ++i) {
+    in_order[i] = uint32_t(i);
+    random[i] = rng.next_uint32() % Normals;
+  }
+  std::printf("  lookups of %zu normals, ns in order / at random:\n", Normals);
+  auto report = [&](const char *name, size_t bytes, auto &&decode) {
+    std::printf("    %-8s %5.1f MB %6.2f / %6.2f\n", name,
+                Normals * bytes / 1e6, gather_loop(in_order, decode),
+                gather_loop(random, decode));
+  };
+  report("TVector3", sizeof(Vector3f), [&](uint32_t i) { return normals[i]; });
+  report("oct32", 4, [&](uint32_t i) {
+    return math::oct32_decode(normals32[i]);
+  });
+  report("oct16", 2, [&](uint32_t i) {
+    return math::oct16_decode(normals16[i]);
+  });
+  return ok;
+}
+
+}  // namespace misaki::bench
\ No newline at end of file
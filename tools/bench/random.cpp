@@ -0,0 +1,112 @@
+// Counter-based generators of random.hpp: Philox4x32-10 against the known
+// answers of Random123, and CounterRNG throughput against PCG32.
+#include <misaki/utils/math/random.hpp>
+
+#include <array>
+#include <vector>
+
+#include "bench.h"
+
+namespace misaki::bench {
+
+namespace {
+
+constexpr size_t Count = 1 << 22;
+constexpr size_t Width = 8;
+
+// Philox4x32-10 test vectors from kat_vectors of Random123 1.09
+struct KnownAnswer {
+  std::array<uint32_t, 4> ctr;
+  std::array<uint32_t, 2> key;
+  std::array<uint32_t, 4> expected;
+};
+const KnownAnswer known_answers[] = {
+    {{0u, 0u, 0u, 0u},
+     {0u, 0u},
+     {0x6627e8d5u, 0xe169c58du, 0xbc57ac4cu, 0x9b00dbd8u}},
+    {{0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu},
+     {0xffffffffu, 0xffffffffu},
+     {0x408f276du, 0x41c83b0eu, 0xa20bc7c6u, 0x6d5451fdu}},
+    {{0x243f6a88u, 0x85a308d3u, 0x13198a2eu, 0x03707344u},
+     {0xa4093822u, 0x299f31d0u},
+     {0xd16cfe09u, 0x94fdccebu, 0x5001e420u, 0x24126ea1u}},
+};
+
+}  // namespace
+
+bool random() {
+  bool ok = true;
+
+  bool known = true;
+  for (const KnownAnswer &k : known_answers)
+    known &= math::philox4x32(k.ctr, k.key) == k.expected;
+  ok &= check(known, "philox4x32 matches the Random123 known answers");
+
+  // Packets run the same rounds lane by lane
+  math::PCG32 rng;
+  bool lanes = true;
+  for (int n = 0; n < 1024; ++n) {
+    std::array<math::Array<uint32_t, Width>, 4> ctr;
+    for (auto &c : ctr)
+      for (size_t i = 0; i < Width; ++i) c.coeff(i) = rng.next_uint32();
+    std::array<uint32_t, 2> key{rng.next_uint32(), rng.next_uint32()};
+    auto packet = math::philox4x32<Width>(ctr, key);
+    for (size_t i = 0; i < Width; ++i) {
+      auto scalar = math::philox4x32({ctr[0].coeff(i), ctr[1].coeff(i),
+                                      ctr[2].coeff(i), ctr[3].coeff(i)},
+                                     key);
+      for (size_t j = 0; j < 4; ++j) lanes &= packet[j].coeff(i) == scalar[j];
+    }
+  }
+  ok &= check(lanes, "packet philox4x32 matches the scalar one");
+
+  // One float per (pixel, sample) at dimension 0, as a renderer would draw
+  // the first sample of each path
+  std::vector<float> out(Count);
+  double t_pcg = time_per_item(Count, [&] {
+    for (size_t i = 0; i < Count; ++i) out[i] = rng.next_float32();
+    consume(out.data());
+  });
+  double t_fill = time_per_item(Count, [&] {
+    rng.fill_float32(out.data(), Count);
+    consume(out.data());
+  });
+  math::CounterRNG counter(7);
+  double t_counter = time_per_item(Count, [&] {
+    for (size_t i = 0; i < Count; ++i)
+      out[i] = counter.sample_float32(uint32_t(i >> 4), uint32_t(i & 15), 0);
+    consume(out.data());
+  });
+  // All four words of a Philox block
+  double t_counter4 = time_per_item(Count, [&] {
+    for (size_t i = 0; i < Count; i += 4) {
+      auto w = counter.sample_uint32x4(uint32_t(i >> 6),
+                                       uint32_t((i >> 2) & 15), 0);
+      for (size_t j = 0; j < 4; ++j)
+        out[i + j] = math::detail::u32_to_float32(w[j]);
+    }
+    consume(out.data());
+  });
+  double t_packet = time_per_item(Count, [&] {
+    math::Array<uint32_t, Width> pixel, sample;
+    for (size_t i = 0; i < Count; i += Width) {
+      for (size_t j = 0; j < Width; ++j) {
+        pixel.coeff(j) = uint32_t((i + j) >> 4);
+        sample.coeff(j) = uint32_t((i + j) & 15);
+      }
+      auto v = counter.sample_float32(pixel, sample, 0);
+      std::memcpy(out.data() + i, v.data(), Width * sizeof(float));
+    }
+    consume(out.data());
+  });
+  std::printf("  PCG32::next_float32: %.2f ns per value\n", t_pcg);
+  std::printf("  PCG32::fill_float32: %.2f ns per value\n", t_fill);
+  std::printf("  CounterRNG::sample_float32: %.2f ns per value\n", t_counter);
+  std::printf("  CounterRNG::sample_uint32x4: %.2f ns per value\n",
+              t_counter4);
+  std::printf("  CounterRNG::sample_float32<%zu>: %.2f ns per value\n", Width,
+              t_packet);
+  return ok;
+}
+
+}  // namespace misaki::bench
\ No newline at end of file
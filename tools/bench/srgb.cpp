@@ -0,0 +1,102 @@
+// Batch sRGB conversions of srgb.hpp against the scalar TColor3 transfer
+// functions they replace: error bounds and throughput.
+#include <misaki/utils/math/color3.hpp>
+#include <misaki/utils/math/random.hpp>
+#include <misaki/utils/math/srgb.hpp>
+
+#include <vector>
+
+#include "bench.h"
+
+namespace misaki::bench {
+
+namespace {
+
+constexpr size_t Count = 1 << 21;
+
+float scalar_to_srgb(float v) { return math::Color3f(v).to_srgb().r; }
+float scalar_to_linear(float v) { return math::Color3f(v).to_linear().r; }
+
+}  // namespace
+
+bool srgb() {
+  math::PCG32 rng;
+  std::vector<float> in(Count), out(Count), ref(Count);
+  std::vector<uint8_t> bytes(Count);
+  for (float &v : in) v = rng.next_float32();
+  bool ok = true;
+
+  // Per channel, as Color3f does it for one pixel
+  auto scalar_time = [&](float (*f)(float)) {
+    return time_per_item(Count, [&] {
+      for (size_t i = 0; i < Count; ++i) ref[i] = f(in[i]);
+      consume(ref.data());
+    });
+  };
+
+  // Float to float, within 10 ulp of TColor3
+  struct FloatCase {
+    const char *name;
+    void (*batch)(const float *, float *, size_t, bool);
+    float (*scalar)(float);
+  };
+  const FloatCase cases[] = {
+      {"linear_to_srgb", math::linear_to_srgb, scalar_to_srgb},
+      {"srgb_to_linear", math::srgb_to_linear, scalar_to_linear},
+  };
+  for (const FloatCase &c : cases) {
+    double t_batch = time_per_item(Count, [&] {
+      c.batch(in.data(), out.data(), Count, false);
+      consume(out.data());
+    });
+    double t_scalar = scalar_time(c.scalar);
+    int64_t ulp = 0;
+    for (size_t i = 0; i < Count; ++i)
+      ulp = std::max(ulp, ulp_distance(out[i], c.scalar(in[i])));
+    std::printf("  %s: %.2f ns batch, %.2f ns TColor3 per value, max %lld "
+                "ulp\n",
+                c.name, t_batch, t_scalar, (long long)ulp);
+    char what[64];
+    std::snprintf(what, sizeof(what), "%s within 10 ulp", c.name);
+    ok &= check(ulp <= 10, what);
+  }
+
+  // Linear to 8 bits: exact rounding except next to a rounding boundary
+  double t_batch = time_per_item(Count, [&] {
+    math::linear_to_srgb8(in.data(), bytes.data(), Count);
+    consume(bytes.data());
+  });
+  size_t off_boundary = 0, near_boundary = 0;
+  for (size_t i = 0; i < Count; ++i) {
+    float exact = scalar_to_srgb(in[i]) * 255.f + .5f;
+    if (bytes[i] == uint8_t(exact))
+      continue;
+    if (std::abs(exact - std::round(exact)) < 255e-5f &&
+        std::abs(int(bytes[i]) - int(exact)) == 1)
+      ++near_boundary;
+    else
+      ++off_boundary;
+  }
+  std::printf("  linear_to_srgb8: %.2f ns per value, %zu of %zu rounded the "
+              "other way within 1e-5 of a boundary\n",
+              t_batch, near_boundary, Count);
+  ok &= check(off_boundary == 0, "linear_to_srgb8 rounds like TColor3");
+
+  // 8 bits to linear: the table is exact in double, TColor3 is float
+  for (size_t i = 0; i < Count; ++i) bytes[i] = uint8_t(rng.next_uint32());
+  t_batch = time_per_item(Count, [&] {
+    math::srgb8_to_linear(bytes.data(), out.data(), Count);
+    consume(out.data());
+  });
+  int64_t ulp = 0;
+  for (int i = 0; i < 256; ++i)
+    ulp = std::max(ulp, ulp_distance(math::srgb8_to_linear_table()[i],
+                                     scalar_to_linear(i / 255.f)));
+  std::printf("  srgb8_to_linear: %.2f ns per value, table within %lld ulp "
+              "of TColor3\n",
+              t_batch, (long long)ulp);
+  ok &= check(ulp <= 10, "srgb8_to_linear within 10 ulp");
+  return ok;
+}
+
+}  // namespace misaki::bench
\ No newline at end of file
@@ -0,0 +1,37 @@
+// Writes precomputed sample tables for SampleTable to load at runtime:
+//   msk-sample-tables pmj02 <sets> <count> <output> [seed]
+//   msk-sample-tables blue-noise <sets> <resolution> <output> [seed]
+#include <misaki/utils/math/sample_tables.hpp>
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+using namespace misaki::math;
+
+int main(int argc, char **argv) {
+  if (argc < 5 || argc > 6) {
+    std::cerr << "Usage: " << argv[0]
+              << " pmj02|blue-noise <sets> <count|resolution> <output> [seed]"
+              << std::endl;
+    return 1;
+  }
+  std::string kind = argv[1];
+  uint32_t sets = uint32_t(std::strtoul(argv[2], nullptr, 10)),
+           size = uint32_t(std::strtoul(argv[3], nullptr, 10)),
+           seed = argc > 5 ? uint32_t(std::strtoul(argv[5], nullptr, 10)) : 0;
+  try {
+    if (kind == "pmj02")
+      generate_pmj02_table(sets, size, seed).write(argv[4]);
+    else if (kind == "blue-noise")
+      generate_blue_noise_table(sets, size, seed).write(argv[4]);
+    else {
+      std::cerr << "Unknown table type \"" << kind << "\"" << std::endl;
+      return 1;
+    }
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
\ No newline at end of file